@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    BatchUtilities.h
+    Project13Batch: the console and parameter helpers the test and benchmark modes share.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <random>
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+
+/*
+ the modes print from one thread, so unlike Main.cpp's printLine this one doesn't lock the console.
+ */
+inline void printLine(const juce::String& line)
+{
+    std::cout << line << std::endl;
+}
+
+inline juce::String getOption(const juce::ArgumentList& args, const juce::String& option, const juce::String& defaultValue)
+{
+    return args.containsOption(option) ? args.getValueForOption(option) : defaultValue;
+}
+
+//right-aligned in a column 'width' characters wide
+inline juce::String column(const juce::String& text, int width)
+{
+    return text.paddedLeft(' ', width);
+}
+
+//bypasses every stage but the one named 'stage'.  returns false if no stage has that name
+inline bool soloStage(juce::AudioProcessor& processor, const juce::String& stage)
+{
+    auto found = false;
+    for (auto* param : processor.getParameters())
+    {
+        auto* bypass = dynamic_cast<juce::AudioParameterBool*>(param);
+        if (bypass == nullptr)
+            continue;
+
+        auto name = bypass->getName(100);
+        if (!name.endsWith(" Bypass"))
+            continue;
+
+        const auto isSolo = name.upToLastOccurrenceOf(" Bypass", false, false).equalsIgnoreCase(stage);
+        found = found || isSolo;
+        *bypass = !isSolo;
+    }
+
+    return found;
+}
+
+//every stage once, shuffled by 'random'
+inline Project13AudioProcessor::DSP_Order makeRandomOrder(juce::Random& random)
+{
+    Project13AudioProcessor::DSP_Order order;
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = static_cast<Project13AudioProcessor::DSP_Option>(i);
+
+    for (auto i = order.size() - 1; i > 0; --i)
+        std::swap(order[i], order[static_cast<size_t>(random.nextInt(static_cast<int>(i) + 1))]);
+
+    return order;
+}
+
+inline Project13AudioProcessor::DSP_Order makeRandomOrder(std::mt19937& random)
+{
+    Project13AudioProcessor::DSP_Order order;
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = static_cast<Project13AudioProcessor::DSP_Option>(i);
+
+    std::shuffle(order.begin(), order.end(), random);
+    return order;
+}
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    LadderBenchmark.cpp
+    Project13Batch --bench-ladder: times ZdfLadder against juce::dsp::LadderFilter.
+
+  ==============================================================================
+*/
+
+#include "LadderBenchmark.h"
+#include "BatchUtilities.h"
+#include "../Source/DSP/ZdfLadder.h"
+
+/*
+ usage:
+    Project13Batch --bench-ladder [--sample-rate 48000] [--block-size 64] [--seconds 10]
+
+ both ladders run the same stereo noise at -12 dBFS, at 50% resonance and a drive of 2, in each of the six modes:
+    fixed       the cutoff stays at 1 kHz
+    swept       the cutoff sweeps 200 Hz - 5 kHz at 0.5 Hz.  ZdfLadder gets a cutoff for every sample, the way the
+                stage could feed it; juce::dsp::LadderFilter gets a new one every block, the way the plugin used to,
+                so its column includes the coefficient updates.
+ the default block size is the plugin's sub-block.  only the process() calls, and the JUCE ladder's cutoff updates,
+ are timed; the blocks are filled outside the timed region.
+ */
+
+namespace
+{
+constexpr int numChannels = 2;
+
+const std::array<std::pair<juce::dsp::LadderFilterMode, const char*>, 6> modes
+{{
+    { juce::dsp::LadderFilterMode::LPF12, "LPF12" },
+    { juce::dsp::LadderFilterMode::HPF12, "HPF12" },
+    { juce::dsp::LadderFilterMode::BPF12, "BPF12" },
+    { juce::dsp::LadderFilterMode::LPF24, "LPF24" },
+    { juce::dsp::LadderFilterMode::HPF24, "HPF24" },
+    { juce::dsp::LadderFilterMode::BPF24, "BPF24" },
+}};
+
+struct Signal
+{
+    Signal(double sampleRate, int blockSize)
+        : noise(numChannels, static_cast<int>(sampleRate) * 2)
+    {
+        juce::Random random(0x13);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample(ch, i, (random.nextFloat() * 2.f - 1.f) * 0.25f);
+        }
+
+        //whole blocks only, so every block can be copied in one go
+        numBlocks = noise.getNumSamples() / blockSize;
+    }
+
+    juce::AudioBuffer<float> noise;
+    int numBlocks = 0;
+};
+
+//the cutoff 'sample' samples in, for the swept case
+float getSweptCutoff(juce::int64 sample, double sampleRate)
+{
+    const auto phase = std::sin(juce::MathConstants<double>::twoPi * 0.5 * static_cast<double>(sample) / sampleRate);
+    return static_cast<float>(200.0 * std::pow(25.0, 0.5 + 0.5 * phase));
+}
+
+/*
+ runs 'numSamples' through 'process', one block at a time, and returns the ns per stereo sample.
+ prepareBlock(block, position) fills the block and whatever process needs for it, outside the timed region.
+ */
+template<typename PrepareBlock, typename Process>
+double measure(const Signal& signal, int blockSize, juce::int64 numSamples, PrepareBlock&& prepareBlock, Process&& process)
+{
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+    juce::int64 ticks = 0;
+    for (juce::int64 position = 0; position < numSamples; position += blockSize)
+    {
+        const auto start = static_cast<int>((position / blockSize) % signal.numBlocks) * blockSize;
+        for (int ch = 0; ch < numChannels; ++ch)
+            buffer.copyFrom(ch, 0, signal.noise, ch, start, blockSize);
+        prepareBlock(position);
+
+        juce::dsp::AudioBlock<float> block(buffer);
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        process(block, position);
+        ticks += juce::Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 / static_cast<double>(numSamples);
+}
+
+void printUsage()
+{
+    printLine("usage: Project13Batch --bench-ladder [--sample-rate 48000] [--block-size 64] [--seconds 10]");
+}
+}
+
+int runLadderBenchmark(const juce::ArgumentList& args)
+{
+    auto sampleRate = getOption(args, "--sample-rate", "48000").getDoubleValue();
+    auto blockSize = getOption(args, "--block-size", "64").getIntValue();
+    auto seconds = getOption(args, "--seconds", "10").getDoubleValue();
+
+    if (sampleRate <= 0.0 || blockSize < 1 || blockSize > static_cast<int>(sampleRate) || seconds <= 0.0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const Signal signal(sampleRate, blockSize);
+    const auto numSamples = static_cast<juce::int64>(seconds * sampleRate);
+    juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(blockSize), static_cast<juce::uint32>(numChannels) };
+
+    printLine(column("mode", 6) + column("cutoff", 8) + column("JUCE ns/sample", 16) + column("ZDF ns/sample", 15) + column("JUCE / ZDF", 12));
+
+    for (const auto& [mode, modeName] : modes)
+    {
+        for (auto swept : { false, true })
+        {
+            juce::dsp::LadderFilter<float> juceLadder;
+            juceLadder.prepare(spec);
+            juceLadder.setMode(mode);
+            juceLadder.setCutoffFrequencyHz(1000.f);
+            juceLadder.setResonance(0.5f);
+            juceLadder.setDrive(2.f);
+
+            Arena arena;
+            arena.reserve(ZdfLadder<float>::getArenaBytes(spec));
+            ZdfLadder<float> zdfLadder;
+            zdfLadder.prepare(spec, arena);
+            zdfLadder.setMode(mode);
+            zdfLadder.setCutoffFrequencyHz(1000.f);
+            zdfLadder.setResonance(0.5f);
+            zdfLadder.setDrive(2.f);
+
+            const auto juceNs = measure(signal, blockSize, numSamples, [](juce::int64) {},
+                                        [&](juce::dsp::AudioBlock<float>& block, juce::int64 position)
+            {
+                if (swept)
+                    juceLadder.setCutoffFrequencyHz(getSweptCutoff(position, sampleRate));
+
+                juceLadder.process(juce::dsp::ProcessContextReplacing<float>(block));
+            });
+
+            std::vector<float> cutoffs(static_cast<size_t>(blockSize), 1000.f);
+            const auto zdfNs = measure(signal, blockSize, numSamples, [&](juce::int64 position)
+            {
+                if (swept)
+                {
+                    for (size_t i = 0; i < cutoffs.size(); ++i)
+                        cutoffs[i] = getSweptCutoff(position + static_cast<juce::int64>(i), sampleRate);
+                }
+            },
+            [&](juce::dsp::AudioBlock<float>& block, juce::int64)
+            {
+                zdfLadder.process(juce::dsp::ProcessContextReplacing<float>(block), cutoffs.data());
+            });
+
+            printLine(column(modeName, 6)
+                      + column(swept ? "swept" : "fixed", 8)
+                      + column(juce::String(juceNs, 2), 16)
+                      + column(juce::String(zdfNs, 2), 15)
+                      + column("x" + juce::String(juceNs / zdfNs, 2), 12));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+/*
+  ==============================================================================
+
+    LadderBenchmark.h
+    Project13Batch --bench-ladder: times ZdfLadder against juce::dsp::LadderFilter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ runs stereo noise through both ladders in every mode, with a fixed cutoff and with a swept one,
+ and prints each one's ns per stereo sample.  returns the process exit code.
+ */
+int runLadderBenchmark(const juce::ArgumentList& args);
@@ -0,0 +1,349 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Project13Batch: renders directories of audio files through Project13AudioProcessor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+#include "ScalingHarness.h"
+#include "SoakTest.h"
+#include "Regression.h"
+#include "StateTest.h"
+#include "LadderBenchmark.h"
+
+/*
+ usage:
+    Project13Batch <state file> <input dir> <output dir> [--threads N] [--block-size N]
+    Project13Batch --scale [options], see ScalingHarness.cpp
+    Project13Batch --soak [options], see SoakTest.cpp
+    Project13Batch --regress [options], see Regression.cpp
+    Project13Batch --bench-state [options] | --fuzz-state [options], see StateTest.cpp
+    Project13Batch --bench-ladder [options], see LadderBenchmark.cpp
+
+ the state file is what the plugin's getStateInformation() writes (the binary session state, or the legacy xml).
+ every .wav/.aif/.aiff in the input dir is rendered to a file of the same name and format in the output dir.
+
+ files are handed out to a fixed set of workers.  each worker owns one Project13AudioProcessor and one block buffer,
+ and readers only map a window of the file at a time, so memory stays bounded no matter how many or how long the files are.
+ */
+
+namespace
+{
+constexpr int defaultBlockSize = 512;
+//how much of a file is mapped into memory at once, in samples
+constexpr juce::int64 mapWindowSamples = 1 << 18;
+
+juce::CriticalSection consoleLock;
+
+void printLine(const juce::String& line)
+{
+    const juce::ScopedLock sl(consoleLock);
+    std::cout << line << std::endl;
+}
+
+struct FileResult
+{
+    bool succeeded = false;
+    double audioSeconds = 0.0;
+    double processingSeconds = 0.0;
+};
+
+juce::String formatRealtime(double audioSeconds, double processingSeconds)
+{
+    if (processingSeconds <= 0.0)
+        return "-";
+
+    return juce::String(audioSeconds / processingSeconds, 1) + "x realtime";
+}
+
+struct BatchWorker : juce::Thread
+{
+    BatchWorker(int index,
+                const juce::Array<juce::File>& filesToProcess,
+                std::atomic<int>& nextFileIndex,
+                const juce::MemoryBlock& stateToLoad,
+                const juce::File& outputDirectory,
+                int maxBlockSize)
+        : juce::Thread("Project13Batch worker " + juce::String(index)),
+          files(filesToProcess),
+          nextFile(nextFileIndex),
+          state(stateToLoad),
+          outputDir(outputDirectory),
+          blockSize(maxBlockSize),
+          buffer(2, maxBlockSize)
+    {
+        formatManager.registerBasicFormats();
+        processor.setNonRealtime(true);
+    }
+
+    void run() override
+    {
+        for (auto i = nextFile.fetch_add(1); i < files.size() && !threadShouldExit(); i = nextFile.fetch_add(1))
+        {
+            auto result = processFile(files.getReference(i));
+            if (result.succeeded)
+            {
+                totalAudioSeconds += result.audioSeconds;
+                ++numSucceeded;
+            }
+            else
+            {
+                ++numFailed;
+            }
+        }
+    }
+
+    double totalAudioSeconds = 0.0;
+    int numSucceeded = 0;
+    int numFailed = 0;
+
+private:
+    FileResult processFile(const juce::File& input)
+    {
+        FileResult result;
+        auto fail = [&input, &result](const juce::String& reason)
+        {
+            printLine("FAILED " + input.getFileName() + ": " + reason);
+            return result;
+        };
+
+        auto* format = formatManager.findFormatForFileExtension(input.getFileExtension());
+        if (format == nullptr)
+            return fail("unsupported format");
+
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(input));
+        if (reader == nullptr)
+            return fail("can't be memory-mapped");
+
+        const auto numChannels = static_cast<int>(reader->numChannels);
+        if (numChannels < 1 || numChannels > 2)
+            return fail("only mono and stereo files are supported");
+
+        juce::TemporaryFile tempOutput(outputDir.getChildFile(input.getFileName()));
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        {
+            auto stream = std::make_unique<juce::FileOutputStream>(tempOutput.getFile());
+            if (stream->failedToOpen())
+                return fail("can't write to " + tempOutput.getFile().getFullPathName());
+
+            writer.reset(format->createWriterFor(stream.get(),
+                                                 reader->sampleRate,
+                                                 static_cast<unsigned int>(numChannels),
+                                                 static_cast<int>(reader->bitsPerSample),
+                                                 reader->metadataValues,
+                                                 0));
+            if (writer == nullptr)
+                return fail("no writer for " + juce::String(reader->bitsPerSample) + " bit " + format->getFormatName());
+
+            //the writer owns the stream now
+            stream.release();
+        }
+
+        const auto sampleRate = reader->sampleRate;
+        auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+        /*
+         every file starts from the same state, and the processor is re-prepared for the file's sample rate.
+         */
+        processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        /*
+         latency is compensated by dropping the first latencySamples of output and flushing the same amount at the end.
+         the tail is rendered after that, so effects ring out instead of being cut off.
+         */
+        const auto latencySamples = static_cast<juce::int64>(processor.getLatencySamples());
+        const auto tailSamples = static_cast<juce::int64>(std::ceil(processor.getTailLengthSeconds() * sampleRate));
+        const auto inputLength = reader->lengthInSamples;
+        const auto renderLength = inputLength + latencySamples + tailSamples;
+
+        juce::MidiBuffer midi;
+        juce::int64 samplesToSkip = latencySamples;
+        bool ok = true;
+
+        for (juce::int64 windowStart = 0; ok && windowStart < renderLength; windowStart += mapWindowSamples)
+        {
+            auto windowEnd = juce::jmin(windowStart + mapWindowSamples, renderLength);
+            auto inputWindow = juce::Range<juce::int64>(windowStart, juce::jmin(windowEnd, inputLength));
+            if (!inputWindow.isEmpty() && !reader->mapSectionOfFile(inputWindow))
+                return fail("can't map samples " + juce::String(inputWindow.getStart()) + " - " + juce::String(inputWindow.getEnd()));
+
+            for (auto pos = windowStart; ok && pos < windowEnd; pos += blockSize)
+            {
+                auto numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), windowEnd - pos));
+                buffer.setSize(2, numSamples, false, false, true);
+                buffer.clear();
+
+                //past the end of the input the processor is fed silence
+                auto numToRead = static_cast<int>(juce::jlimit(juce::int64(0), static_cast<juce::int64>(numSamples), inputLength - pos));
+                if (numToRead > 0)
+                    reader->read(&buffer, 0, numToRead, pos, true, true);
+
+                processor.processBlock(buffer, midi);
+
+                auto skip = static_cast<int>(juce::jmin(samplesToSkip, static_cast<juce::int64>(numSamples)));
+                samplesToSkip -= skip;
+
+                if (skip < numSamples)
+                    ok = writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip);
+            }
+        }
+
+        processor.releaseResources();
+
+        //closes the file before it is moved into place
+        writer.reset();
+        reader.reset();
+
+        if (!ok)
+            return fail("error while writing");
+
+        if (!tempOutput.overwriteTargetFileWithTemporary())
+            return fail("can't replace " + tempOutput.getTargetFile().getFullPathName());
+
+        result.succeeded = true;
+        result.audioSeconds = static_cast<double>(inputLength) / sampleRate;
+        result.processingSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+        printLine(input.getFileName() + ": "
+                  + juce::String(result.audioSeconds, 2) + " s in "
+                  + juce::String(result.processingSeconds, 2) + " s, "
+                  + formatRealtime(result.audioSeconds, result.processingSeconds));
+        return result;
+    }
+
+    const juce::Array<juce::File>& files;
+    std::atomic<int>& nextFile;
+    const juce::MemoryBlock& state;
+    juce::File outputDir;
+    int blockSize;
+
+    juce::AudioFormatManager formatManager;
+    Project13AudioProcessor processor;
+    juce::AudioBuffer<float> buffer;
+};
+
+void printUsage()
+{
+    printLine("usage: Project13Batch <state file> <input dir> <output dir> [--threads N] [--block-size N]");
+    printLine("       Project13Batch --scale [options], see ScalingHarness.cpp");
+    printLine("       Project13Batch --soak [options], see SoakTest.cpp");
+    printLine("       Project13Batch --regress [options], see Regression.cpp");
+    printLine("       Project13Batch --bench-state [options] | --fuzz-state [options], see StateTest.cpp");
+    printLine("       Project13Batch --bench-ladder [options], see LadderBenchmark.cpp");
+}
+}
+
+int main(int argc, char* argv[])
+{
+    //the processors use timers and parameter listeners, which need a message manager
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args(argc, argv);
+    if (args.containsOption("--scale"))
+        return runScalingHarness(args);
+    if (args.containsOption("--soak"))
+        return runSoakTest(args);
+    if (args.containsOption("--regress"))
+        return runRegression(args);
+    if (args.containsOption("--bench-state"))
+        return runStateBenchmark(args);
+    if (args.containsOption("--fuzz-state"))
+        return runStateFuzz(args);
+    if (args.containsOption("--bench-ladder"))
+        return runLadderBenchmark(args);
+
+    if (args.size() < 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    auto stateFile = args[0].resolveAsExistingFile();
+    auto inputDir = args[1].resolveAsExistingFolder();
+    auto outputDir = args[2].resolveAsFile();
+
+    auto numThreads = juce::SystemStats::getNumCpus();
+    if (args.containsOption("--threads"))
+        numThreads = args.getValueForOption("--threads").getIntValue();
+
+    auto blockSize = defaultBlockSize;
+    if (args.containsOption("--block-size"))
+        blockSize = args.getValueForOption("--block-size").getIntValue();
+
+    if (numThreads < 1 || blockSize < 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (outputDir == inputDir)
+    {
+        printLine("the output dir must differ from the input dir, the inputs are mapped while the outputs are written");
+        return 1;
+    }
+
+    if (!outputDir.createDirectory())
+    {
+        printLine("can't create " + outputDir.getFullPathName());
+        return 1;
+    }
+
+    juce::MemoryBlock state;
+    if (!stateFile.loadFileAsData(state))
+    {
+        printLine("can't read " + stateFile.getFullPathName());
+        return 1;
+    }
+
+    auto files = inputDir.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff");
+    files.sort();
+    if (files.isEmpty())
+    {
+        printLine("no .wav/.aif/.aiff files in " + inputDir.getFullPathName());
+        return 1;
+    }
+
+    numThreads = juce::jmin(numThreads, files.size());
+    printLine("rendering " + juce::String(files.size()) + " files on " + juce::String(numThreads) + " threads");
+
+    std::atomic<int> nextFileIndex { 0 };
+    std::vector<std::unique_ptr<BatchWorker>> workers;
+    for (int i = 0; i < numThreads; ++i)
+        workers.push_back(std::make_unique<BatchWorker>(i, files, nextFileIndex, state, outputDir, blockSize));
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    for (auto& worker : workers)
+        worker->startThread();
+
+    //keep the message loop running so the processors' timers can prepare any stage that gets enabled mid-file
+    auto isRunning = [&workers]()
+    {
+        return std::any_of(workers.begin(), workers.end(), [](const auto& w) { return w->isThreadRunning(); });
+    };
+
+    while (isRunning())
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(20);
+
+    auto wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    double audioSeconds = 0.0;
+    int numSucceeded = 0, numFailed = 0;
+    for (const auto& worker : workers)
+    {
+        audioSeconds += worker->totalAudioSeconds;
+        numSucceeded += worker->numSucceeded;
+        numFailed += worker->numFailed;
+    }
+
+    printLine(juce::String(numSucceeded) + " rendered, " + juce::String(numFailed) + " failed. "
+              + juce::String(audioSeconds, 1) + " s of audio in " + juce::String(wallSeconds, 1) + " s, "
+              + formatRealtime(audioSeconds, wallSeconds));
+
+    return numFailed == 0 ? 0 : 2;
+}
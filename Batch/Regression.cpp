@@ -0,0 +1,384 @@
+/*
+  ==============================================================================
+
+    Regression.cpp
+    Project13Batch --regress: renders fixed signals and compares them, and their speed, with stored ones.
+
+  ==============================================================================
+*/
+
+#include <map>
+
+#include "Regression.h"
+#include "BatchUtilities.h"
+
+/*
+ usage:
+    Project13Batch --regress [--dir Batch/Regression] [--record] [--tolerance 0.0001] [--max-regression 10] [--repeats 3]
+
+ every configuration is a chain, a sample rate and a block size:
+    chains          each stage alone ("solo-<stage>", every other "... Bypass" on), and every stage in each of
+                    the orders in orderDigits ("order-<digits>", the digits being DSP_Option values)
+    sample rates    44.1 kHz, 96 kHz and 192 kHz, so the stages behind Internal Rate Cap are resampled in the last one
+    block sizes     32, 500 and 2048: below the 64-sample sub-block, not a multiple of it, and many of them
+
+ the input at each rate is made here, the same every run: an impulse, a sine sweep, then decorrelated noise
+ from a fixed seed.  the directory holds
+    references/<configuration>.wav      the output, 32-bit float, latency included
+    baselines.txt                       ns per stereo sample of every configuration, the fastest of --repeats renders
+
+ a configuration fails if any output sample is further than --tolerance from its reference, or if it is more than
+ --max-regression % slower than its baseline.  one without a reference or without a baseline fails too,
+ so a check against an empty or partial directory can't pass.
+ ns/sample depends on the machine, so the baselines should be recorded on the machine that checks them.
+
+ --record writes both from the current build.
+ */
+
+namespace
+{
+constexpr double signalSeconds = 0.5;
+//the tails ring out into this much silence, and it is part of the reference
+constexpr double tailSeconds = 0.25;
+//silent blocks run before the signal while the message loop turns, so the coefficient worker has delivered
+constexpr int numSettleBlocks = 50;
+
+const juce::StringArray stageNames { "Phaser", "Chorus", "Overdrive", "Ladder Filter", "General Filter",
+                                     "Convolution", "Lin EQ", "Dynamics", "Reverb" };
+//the forward and backward orders, and four that move every stage somewhere else
+const juce::StringArray orderDigits { "012345678", "876543210", "836105472", "578240316", "401628735", "265873140" };
+const std::array<double, 3> sampleRates { 44100.0, 96000.0, 192000.0 };
+const std::array<int, 3> blockSizes { 32, 500, 2048 };
+
+struct Chain
+{
+    juce::String name;
+    //empty to run every stage
+    juce::String soloStage;
+    Project13AudioProcessor::DSP_Order order {};
+};
+
+Project13AudioProcessor::DSP_Order makeOrder(const juce::String& digits)
+{
+    Project13AudioProcessor::DSP_Order order;
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = static_cast<Project13AudioProcessor::DSP_Option>(digits[static_cast<int>(i)] - '0');
+
+    jassert(Project13AudioProcessor::isValidDspOrder(order));
+    return order;
+}
+
+std::vector<Chain> makeChains()
+{
+    std::vector<Chain> chains;
+    for (const auto& stage : stageNames)
+        chains.push_back({ "solo-" + stage.removeCharacters(" "), stage, makeOrder(orderDigits[0]) });
+    for (const auto& digits : orderDigits)
+        chains.push_back({ "order-" + digits, {}, makeOrder(digits) });
+
+    return chains;
+}
+
+juce::AudioBuffer<float> makeSignal(double sampleRate)
+{
+    const auto numSamples = static_cast<int>(signalSeconds * sampleRate);
+    juce::AudioBuffer<float> signal(2, numSamples);
+    signal.clear();
+
+    //an impulse, then a 20 Hz - 20 kHz exponential sweep at -6 dBFS, the same on both sides, then -12 dBFS noise, different on each
+    const auto sweepStart = numSamples / 10;
+    const auto noiseStart = numSamples * 6 / 10;
+    signal.setSample(0, 0, 0.5f);
+    signal.setSample(1, 0, 0.5f);
+
+    const auto sweepLength = noiseStart - sweepStart;
+    const auto sweepRate = std::log(20000.0 / 20.0);
+    const auto sweepSeconds = sweepLength / sampleRate;
+    for (int i = 0; i < sweepLength; ++i)
+    {
+        const auto t = i / sampleRate;
+        const auto phase = juce::MathConstants<double>::twoPi * 20.0 * sweepSeconds / sweepRate * (std::exp(t / sweepSeconds * sweepRate) - 1.0);
+        const auto sample = static_cast<float>(0.5 * std::sin(phase));
+        signal.setSample(0, sweepStart + i, sample);
+        signal.setSample(1, sweepStart + i, sample);
+    }
+
+    juce::Random random(0x13);
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        for (int i = noiseStart; i < numSamples; ++i)
+            signal.setSample(ch, i, (random.nextFloat() * 2.f - 1.f) * 0.25f);
+    }
+
+    return signal;
+}
+
+bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    if (!file.getParentDirectory().createDirectory())
+        return false;
+
+    file.deleteFile();
+    auto stream = std::make_unique<juce::FileOutputStream>(file);
+    if (stream->failedToOpen())
+        return false;
+
+    juce::WavAudioFormat format;
+    std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate,
+                                                                           static_cast<unsigned int>(buffer.getNumChannels()), 32, {}, 0));
+    if (writer == nullptr)
+        return false;
+
+    //the writer owns the stream now
+    stream.release();
+    return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+}
+
+bool readWav(const juce::File& file, juce::AudioBuffer<float>& buffer)
+{
+    if (!file.existsAsFile())
+        return false;
+
+    juce::WavAudioFormat format;
+    std::unique_ptr<juce::AudioFormatReader> reader(format.createReaderFor(file.createInputStream().release(), true));
+    if (reader == nullptr)
+        return false;
+
+    buffer.setSize(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+    return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+}
+
+struct Render
+{
+    juce::AudioBuffer<float> output;
+    double nsPerSample = 0.0;
+};
+
+Render render(const Chain& chain, const juce::AudioBuffer<float>& signal, double sampleRate, int blockSize, int repeats)
+{
+    Render result;
+    const auto numSamples = signal.getNumSamples() + static_cast<int>(tailSeconds * sampleRate);
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+
+    for (int repeat = 0; repeat < repeats; ++repeat)
+    {
+        Project13AudioProcessor processor;
+        processor.setNonRealtime(true);
+        if (chain.soloStage.isNotEmpty())
+            soloStage(processor, chain.soloStage);
+        processor.setDspOrder(chain.order);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        for (int i = 0; i < numSettleBlocks; ++i)
+        {
+            buffer.clear();
+            processor.processBlock(buffer, midi);
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(2);
+        }
+
+        //every repeat renders the same output; the first one is kept
+        juce::AudioBuffer<float> output(2, numSamples);
+        juce::int64 ticks = 0;
+        for (int pos = 0; pos < numSamples; pos += blockSize)
+        {
+            const auto numToProcess = juce::jmin(blockSize, numSamples - pos);
+            buffer.setSize(2, numToProcess, false, false, true);
+            buffer.clear();
+
+            //past the end of the signal the processor is fed silence
+            const auto numToCopy = juce::jlimit(0, numToProcess, signal.getNumSamples() - pos);
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                if (numToCopy > 0)
+                    buffer.copyFrom(ch, 0, signal, ch, pos, numToCopy);
+            }
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            ticks += juce::Time::getHighResolutionTicks() - start;
+
+            for (int ch = 0; ch < 2; ++ch)
+                output.copyFrom(ch, pos, buffer, ch, 0, numToProcess);
+        }
+
+        processor.releaseResources();
+
+        const auto nsPerSample = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9 / numSamples;
+        if (repeat == 0)
+        {
+            result.output = std::move(output);
+            result.nsPerSample = nsPerSample;
+        }
+        else
+        {
+            result.nsPerSample = juce::jmin(result.nsPerSample, nsPerSample);
+        }
+    }
+
+    return result;
+}
+
+//the largest difference between any two samples, or infinity if the buffers aren't the same size or there is a NaN
+float getMaxDifference(const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& reference)
+{
+    if (output.getNumChannels() != reference.getNumChannels() || output.getNumSamples() != reference.getNumSamples())
+        return std::numeric_limits<float>::infinity();
+
+    auto maxDifference = 0.f;
+    for (int ch = 0; ch < output.getNumChannels(); ++ch)
+    {
+        const auto* out = output.getReadPointer(ch);
+        const auto* ref = reference.getReadPointer(ch);
+        for (int i = 0; i < output.getNumSamples(); ++i)
+        {
+            const auto difference = std::abs(out[i] - ref[i]);
+            if (std::isnan(difference))
+                return std::numeric_limits<float>::infinity();
+
+            maxDifference = juce::jmax(maxDifference, difference);
+        }
+    }
+
+    return maxDifference;
+}
+
+//one "<configuration> <ns/sample>" per line.  lines starting with # are comments
+std::map<juce::String, double> readBaselines(const juce::File& file)
+{
+    std::map<juce::String, double> baselines;
+    for (const auto& line : juce::StringArray::fromLines(file.loadFileAsString()))
+    {
+        auto trimmed = line.trim();
+        if (trimmed.isEmpty() || trimmed.startsWithChar('#'))
+            continue;
+
+        baselines[trimmed.upToFirstOccurrenceOf(" ", false, false)] = trimmed.fromFirstOccurrenceOf(" ", false, false).getDoubleValue();
+    }
+
+    return baselines;
+}
+
+bool writeBaselines(const juce::File& file, const std::map<juce::String, double>& baselines)
+{
+    juce::String text;
+    text << "# Project13Batch --regress baselines: <configuration> <ns per stereo sample>\n"
+         << "# recorded with --record on " << juce::SystemStats::getCpuModel() << ", " << juce::Time::getCurrentTime().toISO8601(false) << "\n";
+    for (const auto& [name, nsPerSample] : baselines)
+        text << name << " " << juce::String(nsPerSample, 3) << "\n";
+
+    return file.replaceWithText(text);
+}
+
+void printUsage()
+{
+    printLine("usage: Project13Batch --regress [--dir Batch/Regression] [--record] [--tolerance 0.0001] [--max-regression 10] [--repeats 3]");
+}
+}
+
+int runRegression(const juce::ArgumentList& args)
+{
+    auto dir = juce::File::getCurrentWorkingDirectory().getChildFile(getOption(args, "--dir", "Batch/Regression"));
+    auto tolerance = getOption(args, "--tolerance", "0.0001").getFloatValue();
+    auto maxRegressionPercent = getOption(args, "--max-regression", "10").getDoubleValue();
+    auto repeats = getOption(args, "--repeats", "3").getIntValue();
+    const auto record = args.containsOption("--record");
+
+    if (tolerance < 0.f || maxRegressionPercent < 0.0 || repeats < 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto baselinesFile = dir.getChildFile("baselines.txt");
+    auto baselines = readBaselines(baselinesFile);
+    const auto chains = makeChains();
+
+    printLine((record ? "recording " : "checking ") + dir.getFullPathName());
+    printLine(column("configuration", 32) + column("max diff", 12) + column("ns/sample", 12) + column("baseline", 12) + column("change", 9) + "  result");
+
+    int numConfigurations = 0, numMismatches = 0, numRegressions = 0;
+    for (auto sampleRate : sampleRates)
+    {
+        const auto rateName = juce::String(juce::roundToInt(sampleRate));
+        const auto signal = makeSignal(sampleRate);
+
+        for (auto blockSize : blockSizes)
+        {
+            for (const auto& chain : chains)
+            {
+                const auto name = chain.name + "_" + rateName + "_" + juce::String(blockSize);
+                const auto referenceFile = dir.getChildFile("references").getChildFile(name + ".wav");
+                auto result = render(chain, signal, sampleRate, blockSize, repeats);
+                ++numConfigurations;
+
+                juce::String line = column(name, 32);
+                if (record)
+                {
+                    if (!writeWav(referenceFile, result.output, sampleRate))
+                    {
+                        printLine("can't write " + referenceFile.getFullPathName());
+                        return 1;
+                    }
+
+                    baselines[name] = result.nsPerSample;
+                    printLine(line + column("-", 12) + column(juce::String(result.nsPerSample, 2), 12) + column("-", 12) + column("-", 9) + "  recorded");
+                    continue;
+                }
+
+                juce::StringArray failures;
+                juce::AudioBuffer<float> reference;
+                const auto hasReference = readWav(referenceFile, reference);
+                const auto maxDifference = hasReference ? getMaxDifference(result.output, reference) : std::numeric_limits<float>::infinity();
+                if (maxDifference > tolerance)
+                {
+                    failures.add(hasReference ? "output differs" : "no reference");
+                    ++numMismatches;
+                }
+
+                auto baseline = baselines.find(name);
+                juce::String change = "-";
+                if (baseline == baselines.end() || baseline->second <= 0.0)
+                {
+                    failures.add("no baseline");
+                    ++numRegressions;
+                }
+                else
+                {
+                    const auto percent = 100.0 * (result.nsPerSample / baseline->second - 1.0);
+                    change = (percent >= 0.0 ? "+" : "") + juce::String(percent, 1) + "%";
+                    if (percent > maxRegressionPercent)
+                    {
+                        failures.add("slower");
+                        ++numRegressions;
+                    }
+                }
+
+                printLine(line
+                          + column(std::isfinite(maxDifference) ? juce::String(maxDifference, 7) : "-", 12)
+                          + column(juce::String(result.nsPerSample, 2), 12)
+                          + column(baseline != baselines.end() ? juce::String(baseline->second, 2) : "-", 12)
+                          + column(change, 9)
+                          + "  " + (failures.isEmpty() ? "ok" : failures.joinIntoString(", ")));
+            }
+        }
+    }
+
+    if (record)
+    {
+        if (!writeBaselines(baselinesFile, baselines))
+        {
+            printLine("can't write " + baselinesFile.getFullPathName());
+            return 1;
+        }
+
+        printLine(juce::String(numConfigurations) + " configurations recorded");
+        return 0;
+    }
+
+    printLine(juce::String(numConfigurations) + " configurations, " + juce::String(numMismatches) + " outputs differ, "
+              + juce::String(numRegressions) + " without a baseline or more than " + juce::String(maxRegressionPercent, 1) + "% slower than it");
+
+    return numMismatches == 0 && numRegressions == 0 ? 0 : 2;
+}
@@ -0,0 +1,21 @@
+/*
+  ==============================================================================
+
+    Regression.h
+    Project13Batch --regress: renders fixed signals and compares them, and their speed, with stored ones.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ renders fixed test signals through each stage alone and through a set of stage orders, at several sample rates
+ and block sizes, and compares every output with its stored reference and every ns/sample with its stored baseline.
+ with --record it writes the references and baselines instead.
+ returns the process exit code: 0 if every configuration had a reference and a baseline, every output matched
+ and nothing got slower than allowed.
+ */
+int runRegression(const juce::ArgumentList& args);
@@ -0,0 +1,621 @@
+/*
+  ==============================================================================
+
+    ScalingHarness.cpp
+    Project13Batch --scale: measures many Project13AudioProcessor instances in one AudioProcessorGraph.
+
+  ==============================================================================
+*/
+
+#ifdef _WIN32
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment(lib, "psapi.lib")
+#else
+ #include <sys/resource.h>
+ #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+ #include <sched.h>
+#endif
+
+#if defined(__APPLE__)
+ #include <mach/mach.h>
+#endif
+
+#include <numeric>
+
+#include "ScalingHarness.h"
+#include "BatchUtilities.h"
+
+/*
+ usage:
+    Project13Batch --scale [--instances 1,10,100] [--block-sizes 64,256,1024] [--topology serial|parallel|both]
+                           [--sample-rate 48000] [--seconds 5] [--state <state file>] [--solo <stage>]
+                           [--set "<parameter>=<value>;..."] [--one-core] [--precision float,double,float-double-filters]
+                           [--rate-caps "Off,48 kHz,96 kHz"]
+
+ like Project13.filtergraph, but headless and without a file player: the simulated device feeds decorrelated noise
+ to the graph's input node, the way a real device callback would, as fast as the graph can take it.
+ every run is a fresh graph, prepared and warmed up before it is measured.
+
+    load %          mean callback time / block duration.  the audio thread's share, what a host's meter shows.
+    process CPU %   CPU time of the whole process / audio duration.  adds the coefficient worker and the message thread.
+    us/instance     mean callback time / instances
+    scaling         us/instance relative to the first instance count of the same topology, block size and variant
+    vs first        us/instance relative to the first variant, for the same topology, instances and block size
+    KB/instance     growth of the resident set while building and warming up the graph, / instances.
+                    approximate: the allocator keeps pages freed by earlier runs and hands them out again.
+
+ --solo <stage> turns on every "... Bypass" parameter except "<stage> Bypass", e.g. --solo Reverb or --solo "Lin EQ",
+ after the state file is loaded, so us/instance is what one instance of that stage costs on top of the empty chain.
+ --set sets parameters by name, after --solo, with the value as the parameter shows it, e.g. --set "Lin EQ FFT Size=8192".
+ the variants are every combination of --precision and --rate-caps, and every measurement runs once for each.
+ --precision lists the precisions, float by default:
+    float                   the graph and the plugin run in float
+    double                  the graph runs in double, as in a 64-bit mix engine, so the plugin runs its double chain
+    float-double-filters    float, with Double Precision Filters on
+ --rate-caps lists Internal Rate Cap choices, after --set.  without it the cap is left as the state and --set have it.
+ --one-core pins the process to its first CPU before anything starts, so the coefficient, kernel and convolution threads
+ share the core with the callbacks and process CPU % is what one core can give.  Linux and Windows only.
+
+ e.g. the linear-phase EQ at each FFT size, as 8 stereo instances at 1024-sample blocks on one core:
+    Project13Batch --scale --instances 8 --block-sizes 1024 --topology parallel --solo "Lin EQ" --one-core --set "Lin EQ FFT Size=1024"
+ and again with 2048, 4096 and 8192.
+ and the dynamics stage at its longest lookahead against the chorus, at 64-sample blocks:
+    Project13Batch --scale --instances 1,8 --block-sizes 64 --solo Dynamics --set "Dynamics Lookahead ms=10"
+    Project13Batch --scale --instances 1,8 --block-sizes 64 --solo Chorus
+ and the three precisions, with only the general filter running:
+    Project13Batch --scale --instances 1,8 --solo "General Filter" --precision float,double,float-double-filters
+ and the decimated stages at 192 kHz, without and with the cap:
+    Project13Batch --scale --instances 1,8 --sample-rate 192000 --solo Phaser --rate-caps "Off,48 kHz"
+ and the same with --solo Chorus and --solo "General Filter".
+ */
+
+namespace
+{
+constexpr double warmUpSeconds = 0.5;
+
+enum class Topology
+{
+    Serial,
+    Parallel
+};
+
+juce::String getTopologyName(Topology topology)
+{
+    return topology == Topology::Serial ? "serial" : "parallel";
+}
+
+enum class Precision
+{
+    Float,
+    Double,
+    FloatDoubleFilters
+};
+
+const juce::StringArray precisionNames { "float", "double", "float-double-filters" };
+
+struct Variant
+{
+    Variant variant;
+    //an Internal Rate Cap choice, or empty to leave it alone
+    juce::String rateCap;
+
+    juce::String getName() const
+    {
+        return precisionNames[static_cast<int>(precision)] + (rateCap.isNotEmpty() ? ", cap " + rateCap : juce::String());
+    }
+};
+
+juce::int64 getResidentBytes()
+{
+#if JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<juce::int64>(counters.WorkingSetSize);
+#elif JUCE_MAC
+    mach_task_basic_info_data_t info {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        return static_cast<juce::int64>(info.resident_size);
+#elif JUCE_LINUX
+    //the second field of statm is the resident set, in pages
+    auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), " ", "");
+    if (fields.size() > 1)
+        return fields[1].getLargeIntValue() * static_cast<juce::int64>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+double getProcessCpuSeconds()
+{
+#if JUCE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        auto toSeconds = [](const FILETIME& t)
+        {
+            return static_cast<double>((static_cast<juce::uint64>(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 1.0e-7;
+        };
+        return toSeconds(kernel) + toSeconds(user);
+    }
+    return 0.0;
+#else
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+         + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6;
+#endif
+}
+
+/*
+ a stereo device that calls its callback only when told to, from whichever thread calls runCallback().
+ the input is two seconds of noise that loops.
+ */
+struct SimulatedDevice : juce::AudioIODevice
+{
+    SimulatedDevice(double rate, int blockSize)
+        : juce::AudioIODevice("Simulated Device", "Project13Batch"),
+          sampleRate(rate),
+          bufferSize(blockSize),
+          noise(numChannels, static_cast<int>(rate) * 2),
+          output(numChannels, blockSize)
+    {
+        //-12 dBFS, different on each side so nothing takes the dual mono path
+        juce::Random random(0x13);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample(ch, i, (random.nextFloat() * 2.f - 1.f) * 0.25f);
+        }
+    }
+
+    juce::StringArray getOutputChannelNames() override { return { "Left", "Right" }; }
+    juce::StringArray getInputChannelNames() override { return { "Left", "Right" }; }
+    juce::Array<double> getAvailableSampleRates() override { return { sampleRate }; }
+    juce::Array<int> getAvailableBufferSizes() override { return { bufferSize }; }
+    int getDefaultBufferSize() override { return bufferSize; }
+
+    juce::String open(const juce::BigInteger&, const juce::BigInteger&, double, int) override { return {}; }
+    void close() override {}
+    bool isOpen() override { return true; }
+
+    void start(juce::AudioIODeviceCallback* newCallback) override
+    {
+        callback = newCallback;
+        if (callback != nullptr)
+            callback->audioDeviceAboutToStart(this);
+    }
+
+    void stop() override
+    {
+        if (callback != nullptr)
+            callback->audioDeviceStopped();
+        callback = nullptr;
+    }
+
+    bool isPlaying() override { return callback != nullptr; }
+    juce::String getLastError() override { return {}; }
+    int getCurrentBufferSizeSamples() override { return bufferSize; }
+    double getCurrentSampleRate() override { return sampleRate; }
+    int getCurrentBitDepth() override { return 32; }
+    juce::BigInteger getActiveOutputChannels() const override { return juce::BigInteger(3); }
+    juce::BigInteger getActiveInputChannels() const override { return juce::BigInteger(3); }
+    int getOutputLatencyInSamples() override { return 0; }
+    int getInputLatencyInSamples() override { return 0; }
+
+    void runCallback()
+    {
+        //a block that would run past the end of the noise starts again from the top
+        if (readPosition + bufferSize > noise.getNumSamples())
+            readPosition = 0;
+
+        std::array<const float*, numChannels> inputs { noise.getReadPointer(0, readPosition), noise.getReadPointer(1, readPosition) };
+        std::array<float*, numChannels> outputs { output.getWritePointer(0), output.getWritePointer(1) };
+        callback->audioDeviceIOCallbackWithContext(inputs.data(), numChannels, outputs.data(), numChannels, bufferSize, {});
+
+        readPosition += bufferSize;
+    }
+
+private:
+    static constexpr int numChannels = 2;
+
+    double sampleRate;
+    int bufferSize;
+    juce::AudioBuffer<float> noise, output;
+    int readPosition = 0;
+    juce::AudioIODeviceCallback* callback = nullptr;
+};
+
+//the device's audio thread.  times every callback.
+struct CallbackThread : juce::Thread
+{
+    CallbackThread(SimulatedDevice& deviceToRun, int callbacksToRun)
+        : juce::Thread("Project13Batch simulated device"),
+          device(deviceToRun),
+          numCallbacks(callbacksToRun)
+    {
+        callbackSeconds.reserve(static_cast<size_t>(numCallbacks));
+    }
+
+    void run() override
+    {
+        for (int i = 0; i < numCallbacks && !threadShouldExit(); ++i)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            device.runCallback();
+            callbackSeconds.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+        }
+    }
+
+    SimulatedDevice& device;
+    int numCallbacks;
+    std::vector<double> callbackSeconds;
+};
+
+//runs the callbacks on their own thread while this one keeps the message loop going for the processors' timers
+std::vector<double> runCallbacks(SimulatedDevice& device, int numCallbacks)
+{
+    CallbackThread thread(device, numCallbacks);
+    thread.startThread();
+    while (thread.isThreadRunning())
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(20);
+
+    return std::move(thread.callbackSeconds);
+}
+
+struct RunSettings
+{
+    Topology topology = Topology::Serial;
+    int numInstances = 1;
+    int blockSize = 512;
+    double sampleRate = 48000.0;
+    double seconds = 5.0;
+    //a stage name, or empty to run the state as it is
+    juce::String soloStage;
+    //see setParameters()
+    juce::String parameters;
+    Precision precision = Precision::Float;
+};
+
+struct RunResult
+{
+    double meanSeconds = 0.0, p99Seconds = 0.0, maxSeconds = 0.0;
+    double processCpuSeconds = 0.0, audioSeconds = 0.0;
+    juce::int64 residentBytes = 0;
+};
+
+//sets each "<parameter>=<value>" in 'assignments', separated by ';'.  returns the first one that names no parameter, or an empty string
+juce::String setParameters(juce::AudioProcessor& processor, const juce::String& assignments)
+{
+    for (const auto& assignment : juce::StringArray::fromTokens(assignments, ";", "\""))
+    {
+        auto name = assignment.upToFirstOccurrenceOf("=", false, false).trim();
+        auto value = assignment.fromFirstOccurrenceOf("=", false, false).trim();
+        if (name.isEmpty())
+            continue;
+
+        auto found = false;
+        for (auto* param : processor.getParameters())
+        {
+            if (param->getName(100) != name)
+                continue;
+
+            param->setValueNotifyingHost(param->getValueForText(value));
+            found = true;
+            break;
+        }
+
+        if (!found)
+            return name;
+    }
+
+    return {};
+}
+
+//every thread started afterwards inherits the affinity
+bool pinToOneCore()
+{
+#if JUCE_WINDOWS
+    return SetProcessAffinityMask(GetCurrentProcess(), 1) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0)
+        return false;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &cpus))
+            continue;
+
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+    }
+
+    return false;
+#else
+    return false;
+#endif
+}
+
+RunResult measure(const RunSettings& settings, const juce::MemoryBlock& state)
+{
+    using Node = juce::AudioProcessorGraph::Node;
+    using IOProcessor = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+    constexpr int numChannels = 2;
+
+    RunResult result;
+    const auto residentBefore = getResidentBytes();
+
+    juce::AudioProcessorGraph graph;
+    auto input = graph.addNode(std::make_unique<IOProcessor>(IOProcessor::audioInputNode));
+    auto output = graph.addNode(std::make_unique<IOProcessor>(IOProcessor::audioOutputNode));
+
+    auto connect = [&graph](const Node::Ptr& source, const Node::Ptr& destination)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            graph.addConnection({ { source->nodeID, ch }, { destination->nodeID, ch } });
+    };
+
+    auto previous = input;
+    for (int i = 0; i < settings.numInstances; ++i)
+    {
+        auto processor = std::make_unique<Project13AudioProcessor>();
+        if (state.getSize() > 0)
+            processor->setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+        if (settings.soloStage.isNotEmpty())
+            soloStage(*processor, settings.soloStage);
+        setParameters(*processor, settings.parameters);
+        if (settings.variant.precision == Precision::FloatDoubleFilters)
+            setParameters(*processor, "Double Precision Filters=On");
+        if (settings.variant.rateCap.isNotEmpty())
+            setParameters(*processor, "Internal Rate Cap=" + settings.variant.rateCap);
+
+        auto node = graph.addNode(std::move(processor));
+        if (settings.topology == Topology::Serial)
+        {
+            connect(previous, node);
+            previous = node;
+        }
+        else
+        {
+            //the graph sums everything that arrives at the output node
+            connect(input, node);
+            connect(node, output);
+        }
+    }
+
+    if (settings.topology == Topology::Serial)
+        connect(previous, output);
+
+    //the player hands the graph double buffers, and the graph its nodes, once it is asked for double precision
+    juce::AudioProcessorPlayer player(settings.variant.precision == Precision::Double);
+    player.setProcessor(&graph);
+    SimulatedDevice device(settings.sampleRate, settings.blockSize);
+    device.start(&player);
+
+    const auto blockSeconds = settings.blockSize / settings.sampleRate;
+    runCallbacks(device, juce::jmax(1, static_cast<int>(std::ceil(warmUpSeconds / blockSeconds))));
+    result.residentBytes = getResidentBytes() - residentBefore;
+
+    const auto numCallbacks = juce::jmax(1, static_cast<int>(std::ceil(settings.seconds / blockSeconds)));
+    const auto cpuBefore = getProcessCpuSeconds();
+    auto times = runCallbacks(device, numCallbacks);
+    result.processCpuSeconds = getProcessCpuSeconds() - cpuBefore;
+    result.audioSeconds = numCallbacks * blockSeconds;
+
+    device.stop();
+    player.setProcessor(nullptr);
+
+    if (!times.empty())
+    {
+        result.meanSeconds = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+        result.maxSeconds = *std::max_element(times.begin(), times.end());
+        auto p99 = times.begin() + static_cast<std::ptrdiff_t>((times.size() - 1) * 99 / 100);
+        std::nth_element(times.begin(), p99, times.end());
+        result.p99Seconds = *p99;
+    }
+
+    return result;
+}
+
+juce::Array<int> parseList(const juce::String& text)
+{
+    juce::Array<int> values;
+    for (const auto& token : juce::StringArray::fromTokens(text, ",", ""))
+    {
+        auto value = token.trim().getIntValue();
+        if (value > 0)
+            values.addIfNotAlreadyThere(value);
+    }
+
+    values.sort();
+    return values;
+}
+
+void printUsage()
+{
+    printLine("usage: Project13Batch --scale [--instances 1,10,100] [--block-sizes 64,256,1024] [--topology serial|parallel|both]");
+    printLine("                              [--sample-rate 48000] [--seconds 5] [--state <state file>] [--solo <stage>]");
+    printLine("                              [--set \"<parameter>=<value>;...\"] [--one-core] [--precision float,double,float-double-filters]");
+    printLine("                              [--rate-caps \"Off,48 kHz,96 kHz\"]");
+}
+}
+
+int runScalingHarness(const juce::ArgumentList& args)
+{
+    auto instanceCounts = parseList(getOption(args, "--instances", "1,10,100,250,500,1000"));
+    auto blockSizes = parseList(getOption(args, "--block-sizes", "64,256,1024"));
+    auto sampleRate = getOption(args, "--sample-rate", "48000").getDoubleValue();
+    auto seconds = getOption(args, "--seconds", "5").getDoubleValue();
+    auto topologyName = getOption(args, "--topology", "both");
+    auto solo = getOption(args, "--solo", {});
+    auto parameters = getOption(args, "--set", {});
+
+    std::vector<Precision> precisions;
+    for (const auto& name : juce::StringArray::fromTokens(getOption(args, "--precision", "float"), ",", ""))
+    {
+        auto index = precisionNames.indexOf(name.trim());
+        if (index < 0)
+        {
+            printUsage();
+            return 1;
+        }
+
+        precisions.push_back(static_cast<Precision>(index));
+    }
+
+    juce::StringArray rateCaps;
+    if (args.containsOption("--rate-caps"))
+    {
+        rateCaps = juce::StringArray::fromTokens(args.getValueForOption("--rate-caps"), ",", "");
+        rateCaps.trim();
+        rateCaps.removeEmptyStrings();
+    }
+    else
+    {
+        rateCaps.add({});
+    }
+
+    std::vector<Variant> variants;
+    for (auto precision : precisions)
+    {
+        for (const auto& rateCap : rateCaps)
+            variants.push_back({ precision, rateCap });
+    }
+
+    std::vector<Topology> topologies;
+    if (topologyName == "serial" || topologyName == "both")
+        topologies.push_back(Topology::Serial);
+    if (topologyName == "parallel" || topologyName == "both")
+        topologies.push_back(Topology::Parallel);
+
+    if (instanceCounts.isEmpty() || blockSizes.isEmpty() || sampleRate <= 0.0 || seconds <= 0.0 || topologies.empty() || variants.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    //without a state file every instance runs the default state
+    juce::MemoryBlock state;
+    if (args.containsOption("--state"))
+    {
+        auto stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--state"));
+        if (!stateFile.loadFileAsData(state))
+        {
+            printLine("can't read " + stateFile.getFullPathName());
+            return 1;
+        }
+    }
+
+    //before the first processor, so its threads are pinned too
+    if (args.containsOption("--one-core") && !pinToOneCore())
+    {
+        printLine("can't pin the process to one core here");
+        return 1;
+    }
+
+    if (solo.isNotEmpty())
+    {
+        Project13AudioProcessor probe;
+        if (!soloStage(probe, solo))
+        {
+            printLine("no stage called " + solo);
+            return 1;
+        }
+    }
+
+    //an unknown choice would quietly select the first one
+    if (rateCaps[0].isNotEmpty())
+    {
+        Project13AudioProcessor probe;
+        for (const auto& rateCap : rateCaps)
+        {
+            auto found = false;
+            for (auto* param : probe.getParameters())
+            {
+                if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(param); choice != nullptr && choice->getName(100) == "Internal Rate Cap")
+                    found = choice->choices.contains(rateCap);
+            }
+
+            if (!found)
+            {
+                printLine("no Internal Rate Cap choice called " + rateCap);
+                return 1;
+            }
+        }
+    }
+
+    if (parameters.isNotEmpty())
+    {
+        Project13AudioProcessor probe;
+        auto unknown = setParameters(probe, parameters);
+        if (unknown.isNotEmpty())
+        {
+            printLine("no parameter called " + unknown);
+            return 1;
+        }
+    }
+
+    printLine(column("topology", 10) + column("variant", 30) + column("instances", 11) + column("block", 7)
+              + column("load %", 10) + column("process CPU %", 15)
+              + column("mean us", 11) + column("p99 us", 11) + column("max us", 11)
+              + column("us/instance", 13) + column("scaling", 9) + column("vs first", 10) + column("KB/instance", 13));
+
+    for (auto topology : topologies)
+    {
+        for (auto blockSize : blockSizes)
+        {
+            //per variant
+            std::vector<double> firstCostPerInstance(variants.size(), 0.0);
+            for (auto numInstances : instanceCounts)
+            {
+                double firstVariantCost = 0.0;
+                for (size_t v = 0; v < variants.size(); ++v)
+                {
+                    RunSettings settings;
+                    settings.topology = topology;
+                    settings.numInstances = numInstances;
+                    settings.blockSize = blockSize;
+                    settings.sampleRate = sampleRate;
+                    settings.seconds = seconds;
+                    settings.soloStage = solo;
+                    settings.parameters = parameters;
+                    settings.variant = variants[v];
+
+                    auto result = measure(settings, state);
+
+                    const auto blockSeconds = blockSize / sampleRate;
+                    const auto costPerInstance = result.meanSeconds / numInstances;
+                    if (firstCostPerInstance[v] <= 0.0)
+                        firstCostPerInstance[v] = costPerInstance;
+                    if (v == 0)
+                        firstVariantCost = costPerInstance;
+
+                    printLine(column(getTopologyName(topology), 10)
+                              + column(variants[v].getName(), 30)
+                              + column(juce::String(numInstances), 11)
+                              + column(juce::String(blockSize), 7)
+                              + column(juce::String(100.0 * result.meanSeconds / blockSeconds, 1), 10)
+                              + column(juce::String(100.0 * result.processCpuSeconds / result.audioSeconds, 1), 15)
+                              + column(juce::String(result.meanSeconds * 1.0e6, 1), 11)
+                              + column(juce::String(result.p99Seconds * 1.0e6, 1), 11)
+                              + column(juce::String(result.maxSeconds * 1.0e6, 1), 11)
+                              + column(juce::String(costPerInstance * 1.0e6, 2), 13)
+                              + column("x" + juce::String(costPerInstance / firstCostPerInstance[v], 2), 9)
+                              + column("x" + juce::String(costPerInstance / firstVariantCost, 2), 10)
+                              + column(juce::String(static_cast<double>(result.residentBytes) / 1024.0 / numInstances, 1), 13));
+                }
+            }
+        }
+    }
+
+    return 0;
+}
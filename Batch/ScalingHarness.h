@@ -0,0 +1,19 @@
+/*
+  ==============================================================================
+
+    ScalingHarness.h
+    Project13Batch --scale: measures many Project13AudioProcessor instances in one AudioProcessorGraph.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ builds graphs of N instances in series and in parallel, drives each one from a simulated audio device,
+ and prints the CPU load, per-instance cost and memory for every instance count and block size.
+ returns the process exit code.
+ */
+int runScalingHarness(const juce::ArgumentList& args);
@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    SoakTest.cpp
+    Project13Batch --soak: changes one Project13AudioProcessor from several threads while it runs.
+
+  ==============================================================================
+*/
+
+#include <random>
+
+#include "SoakTest.h"
+#include "BatchUtilities.h"
+
+/*
+ usage:
+    Project13Batch --soak [--seconds 30] [--producers 4] [--block-size 256] [--sample-rate 48000] [--stall-ms 50]
+
+ one processor runs blocks of noise on its own audio thread, in realtime mode, as fast as it can.
+ meanwhile:
+    --producers threads     call setDspOrder() with random orders, all at once, through the chain request mailbox
+    the message thread      stores morph snapshots A and B, changes programs when the preset bank has any,
+                            and runs the processor's timer, which syncs programs and sends the commands that didn't fit
+ about once a second the audio thread stalls for --stall-ms, so the 32-command queue fills up behind it.
+
+ at the end the producers stop and a last order and snapshot are sent, and the audio thread runs on for a while
+ so everything still waiting is delivered.  the run fails if any block has a NaN or an infinity in it.
+ */
+
+namespace
+{
+struct SoakAudioThread : juce::Thread
+{
+    SoakAudioThread(Project13AudioProcessor& processorToRun, int blockSize, int stallMilliseconds)
+        : juce::Thread("Project13Batch soak audio"),
+          processor(processorToRun),
+          buffer(2, blockSize),
+          stallMs(stallMilliseconds)
+    {
+    }
+
+    void run() override
+    {
+        juce::Random random(0x13);
+        juce::MidiBuffer midi;
+        auto nextStall = juce::Time::getMillisecondCounterHiRes() + 1000.0;
+
+        while (!threadShouldExit())
+        {
+            //different on each side, so nothing takes the dual mono path
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            {
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    buffer.setSample(ch, i, (random.nextFloat() * 2.f - 1.f) * 0.25f);
+            }
+
+            auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock(buffer, midi);
+            maxBlockSeconds = juce::jmax(maxBlockSeconds, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+            ++numBlocks;
+
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            {
+                const auto* samples = buffer.getReadPointer(ch);
+                if (!std::all_of(samples, samples + buffer.getNumSamples(), [](float x) { return std::isfinite(x); }))
+                {
+                    ++numBadBlocks;
+                    break;
+                }
+            }
+
+            if (stallMs > 0 && juce::Time::getMillisecondCounterHiRes() >= nextStall)
+            {
+                sleep(stallMs);
+                ++numStalls;
+                nextStall = juce::Time::getMillisecondCounterHiRes() + 1000.0;
+            }
+        }
+    }
+
+    Project13AudioProcessor& processor;
+    juce::AudioBuffer<float> buffer;
+    int stallMs;
+
+    std::atomic<juce::int64> numBlocks { 0 };
+    std::atomic<int> numBadBlocks { 0 }, numStalls { 0 };
+    double maxBlockSeconds = 0.0;
+};
+
+struct OrderProducer : juce::Thread
+{
+    OrderProducer(Project13AudioProcessor& processorToFeed, int index)
+        : juce::Thread("Project13Batch soak producer " + juce::String(index)),
+          processor(processorToFeed),
+          random(static_cast<std::mt19937::result_type>(0x13 + index))
+    {
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            processor.setDspOrder(makeRandomOrder(random));
+            ++numRequests;
+
+            //bursts, so requests arrive both faster and slower than blocks
+            if ((numRequests % 64) == 0)
+                sleep(1);
+        }
+    }
+
+    Project13AudioProcessor& processor;
+    std::mt19937 random;
+    std::atomic<juce::int64> numRequests { 0 };
+};
+
+void printUsage()
+{
+    printLine("usage: Project13Batch --soak [--seconds 30] [--producers 4] [--block-size 256] [--sample-rate 48000] [--stall-ms 50]");
+}
+}
+
+int runSoakTest(const juce::ArgumentList& args)
+{
+    auto seconds = getOption(args, "--seconds", "30").getDoubleValue();
+    auto numProducers = getOption(args, "--producers", "4").getIntValue();
+    auto blockSize = getOption(args, "--block-size", "256").getIntValue();
+    auto sampleRate = getOption(args, "--sample-rate", "48000").getDoubleValue();
+    auto stallMs = getOption(args, "--stall-ms", "50").getIntValue();
+
+    if (seconds <= 0.0 || numProducers < 1 || blockSize < 1 || sampleRate <= 0.0 || stallMs < 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    Project13AudioProcessor processor;
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    SoakAudioThread audioThread(processor, blockSize, stallMs);
+    std::vector<std::unique_ptr<OrderProducer>> producers;
+    for (int i = 0; i < numProducers; ++i)
+        producers.push_back(std::make_unique<OrderProducer>(processor, i));
+
+    const auto droppedBefore = ConvolutionScheduler::get().getNumDroppedBlocks();
+    audioThread.startThread();
+    for (auto& producer : producers)
+        producer->startThread();
+
+    printLine("soaking for " + juce::String(seconds, 1) + " s with " + juce::String(numProducers) + " order producers");
+
+    //the message thread's share: morph snapshots and program changes, between turns of the timer
+    std::mt19937 random(0x13);
+    juce::int64 numMorphStores = 0, numProgramChanges = 0;
+    const auto numPrograms = processor.getPresetNames().size();
+    const auto endTime = juce::Time::getMillisecondCounterHiRes() + seconds * 1000.0;
+    while (juce::Time::getMillisecondCounterHiRes() < endTime)
+    {
+        processor.storeMorphSnapshot((numMorphStores % 2) == 0 ? Project13AudioProcessor::MorphSlot::A : Project13AudioProcessor::MorphSlot::B);
+        ++numMorphStores;
+
+        if (numPrograms > 0 && (numMorphStores % 8) == 0)
+        {
+            processor.setCurrentProgram(static_cast<int>(random() % static_cast<unsigned>(numPrograms)));
+            ++numProgramChanges;
+        }
+
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(1);
+    }
+
+    juce::int64 numOrderRequests = 0;
+    for (auto& producer : producers)
+    {
+        producer->stopThread(1000);
+        numOrderRequests += producer->numRequests.load();
+    }
+
+    //the last requests, then long enough for a stall and a few timer ticks to deliver them
+    processor.setDspOrder(makeRandomOrder(random));
+    processor.storeMorphSnapshot(Project13AudioProcessor::MorphSlot::A);
+    const auto settleEnd = juce::Time::getMillisecondCounterHiRes() + 2000.0;
+    while (juce::Time::getMillisecondCounterHiRes() < settleEnd)
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(20);
+
+    audioThread.stopThread(1000);
+    processor.releaseResources();
+
+    printLine(juce::String(audioThread.numBlocks.load()) + " blocks, " + juce::String(audioThread.numStalls.load()) + " stalls, "
+              + "longest block " + juce::String(audioThread.maxBlockSeconds * 1.0e6, 1) + " us");
+    printLine(juce::String(numOrderRequests) + " order requests, " + juce::String(numMorphStores) + " morph snapshots, "
+              + juce::String(numProgramChanges) + " program changes");
+    printLine(juce::String(static_cast<juce::int64>(ConvolutionScheduler::get().getNumDroppedBlocks() - droppedBefore)) + " convolution tail blocks dropped");
+
+    if (audioThread.numBadBlocks.load() > 0)
+    {
+        printLine("FAILED: " + juce::String(audioThread.numBadBlocks.load()) + " blocks with NaN or infinite samples");
+        return 2;
+    }
+
+    printLine("passed");
+    return 0;
+}
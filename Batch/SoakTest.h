@@ -0,0 +1,19 @@
+/*
+  ==============================================================================
+
+    SoakTest.h
+    Project13Batch --soak: changes one Project13AudioProcessor from several threads while it runs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ runs a processor on its own audio thread while order producers, the message thread and the processor's timer
+ all feed it changes, stalling the audio thread now and then so the command queue overflows.
+ returns the process exit code: 0 if every block came out finite.
+ */
+int runSoakTest(const juce::ArgumentList& args);
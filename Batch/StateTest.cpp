@@ -0,0 +1,282 @@
+/*
+  ==============================================================================
+
+    StateTest.cpp
+    Project13Batch --bench-state and --fuzz-state: times and attacks Project13AudioProcessor's session state.
+
+  ==============================================================================
+*/
+
+#include <numeric>
+
+#include "StateTest.h"
+#include "BatchUtilities.h"
+
+/*
+ usage:
+    Project13Batch --bench-state [--count 1000]
+    Project13Batch --fuzz-state [--iterations 20000] [--seed 19] [--state <state file>]
+
+ --bench-state makes --count states with every parameter, the order and morph snapshot A randomised, like the
+ instances of a large session, then loads each of them into one processor, and the same states as legacy ValueTrees.
+ it prints the mean, p99 and max time of each kind of load, and of getStateInformation().
+
+ --fuzz-state starts from two valid states: the state file, or a randomised one, and the same as a legacy ValueTree.
+ every iteration damages a copy of one of them, by truncating it, flipping bits, overwriting a run of bytes,
+ corrupting a count in the header, or replacing it with random bytes, and loads it into a prepared processor.
+ a block of noise runs after every load, and the run fails if it comes out with a NaN or an infinity in it.
+ a crash is a failure too.  a Debug build also hits the jasserts that flag bad data, so run it on a Release build.
+ */
+
+namespace
+{
+constexpr double sampleRate = 48000.0;
+constexpr int blockSize = 256;
+
+//every parameter, the order and morph snapshot A randomised
+void randomiseState(Project13AudioProcessor& processor, juce::Random& random)
+{
+    for (auto* param : processor.getParameters())
+        param->setValueNotifyingHost(random.nextFloat());
+
+    processor.setDspOrder(makeRandomOrder(random));
+    processor.storeMorphSnapshot(Project13AudioProcessor::MorphSlot::A);
+}
+
+//the version 1 format, see getStateInformation(): the APVTS tree, with the order as a binary property of ints
+juce::MemoryBlock makeLegacyState(Project13AudioProcessor& processor, const Project13AudioProcessor::DSP_Order& order)
+{
+    juce::MemoryBlock orderData;
+    {
+        juce::MemoryOutputStream mos(orderData, false);
+        for (auto option : order)
+            mos.writeInt(static_cast<int>(option));
+    }
+
+    auto tree = processor.apvts.copyState();
+    tree.setProperty("dspOrder", juce::var(orderData), nullptr);
+
+    //the stream trims the block to what was written when it goes out of scope
+    juce::MemoryBlock state;
+    {
+        juce::MemoryOutputStream mos(state, false);
+        tree.writeToStream(mos);
+    }
+    return state;
+}
+
+struct Timings
+{
+    void add(double seconds) { times.push_back(seconds); }
+
+    juce::String describe()
+    {
+        if (times.empty())
+            return "-";
+
+        const auto mean = std::accumulate(times.begin(), times.end(), 0.0) / static_cast<double>(times.size());
+        const auto max = *std::max_element(times.begin(), times.end());
+        auto p99 = times.begin() + static_cast<std::ptrdiff_t>((times.size() - 1) * 99 / 100);
+        std::nth_element(times.begin(), p99, times.end());
+
+        return "mean " + juce::String(mean * 1.0e6, 1) + " us, p99 " + juce::String(*p99 * 1.0e6, 1)
+             + " us, max " + juce::String(max * 1.0e6, 1) + " us, total " + juce::String(mean * 1.0e3 * static_cast<double>(times.size()), 1) + " ms";
+    }
+
+    std::vector<double> times;
+};
+
+template<typename Function>
+double timeSeconds(Function&& function)
+{
+    const auto start = juce::Time::getHighResolutionTicks();
+    function();
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+}
+
+juce::MemoryBlock damage(const juce::MemoryBlock& state, juce::Random& random)
+{
+    auto damaged = state;
+    auto* bytes = static_cast<juce::uint8*>(damaged.getData());
+    const auto size = static_cast<int>(damaged.getSize());
+
+    switch (random.nextInt(5))
+    {
+    case 0:
+        //cut short anywhere, including inside the header
+        damaged.setSize(static_cast<size_t>(random.nextInt(size + 1)));
+        break;
+    case 1:
+        for (int i = random.nextInt(8) + 1; i > 0 && size > 0; --i)
+            bytes[random.nextInt(size)] ^= static_cast<juce::uint8>(1 << random.nextInt(8));
+        break;
+    case 2:
+        if (size > 0)
+        {
+            const auto start = random.nextInt(size);
+            const auto length = juce::jmin(size - start, random.nextInt(64) + 1);
+            for (int i = 0; i < length; ++i)
+                bytes[start + i] = static_cast<juce::uint8>(random.nextInt(256));
+        }
+        break;
+    case 3:
+        //version, parameter count or order size, see getStateInformation(), with anything from 0 to huge
+        if (size >= 16)
+        {
+            const auto value = random.nextBool() ? random.nextInt() : random.nextInt(64);
+            std::memcpy(bytes + 4 * (random.nextInt(3) + 1), &value, sizeof(value));
+        }
+        break;
+    default:
+        damaged.setSize(static_cast<size_t>(random.nextInt(4096)));
+        random.fillBitsRandomly(damaged.getData(), damaged.getSize());
+        break;
+    }
+
+    return damaged;
+}
+
+bool isFinite(const juce::AudioBuffer<float>& buffer)
+{
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+        const auto* samples = buffer.getReadPointer(ch);
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            if (!std::isfinite(samples[i]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void printUsage()
+{
+    printLine("usage: Project13Batch --bench-state [--count 1000]");
+    printLine("       Project13Batch --fuzz-state [--iterations 20000] [--seed 19] [--state <state file>]");
+}
+}
+
+int runStateBenchmark(const juce::ArgumentList& args)
+{
+    auto count = getOption(args, "--count", "1000").getIntValue();
+    if (count < 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    //the states are made by one processor and loaded into another, the way a host opens a saved session
+    std::vector<juce::MemoryBlock> states, legacyStates;
+    {
+        Project13AudioProcessor source;
+        juce::Random random(0x13);
+        for (int i = 0; i < count; ++i)
+        {
+            randomiseState(source, random);
+            states.emplace_back();
+            source.getStateInformation(states.back());
+            legacyStates.push_back(makeLegacyState(source, makeRandomOrder(random)));
+        }
+    }
+
+    Project13AudioProcessor processor;
+    Timings loads, legacyLoads, saves;
+    for (int i = 0; i < count; ++i)
+    {
+        const auto& state = states[static_cast<size_t>(i)];
+        loads.add(timeSeconds([&] { processor.setStateInformation(state.getData(), static_cast<int>(state.getSize())); }));
+
+        juce::MemoryBlock saved;
+        saves.add(timeSeconds([&] { processor.getStateInformation(saved); }));
+
+        //the load queues commands for the timer and notifies the parameters' listeners; let them run as a host would
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(1);
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const auto& state = legacyStates[static_cast<size_t>(i)];
+        legacyLoads.add(timeSeconds([&] { processor.setStateInformation(state.getData(), static_cast<int>(state.getSize())); }));
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(1);
+    }
+
+    printLine(juce::String(count) + " states, " + juce::String(states.front().getSize()) + " bytes each, "
+              + juce::String(legacyStates.front().getSize()) + " as legacy ValueTrees");
+    printLine("setStateInformation:          " + loads.describe());
+    printLine("setStateInformation, legacy:  " + legacyLoads.describe());
+    printLine("getStateInformation:          " + saves.describe());
+    return 0;
+}
+
+int runStateFuzz(const juce::ArgumentList& args)
+{
+    auto iterations = getOption(args, "--iterations", "20000").getIntValue();
+    auto seed = getOption(args, "--seed", "19").getLargeIntValue();
+    if (iterations < 1)
+    {
+        printUsage();
+        return 1;
+    }
+
+    Project13AudioProcessor processor;
+    juce::Random random(seed);
+
+    std::array<juce::MemoryBlock, 2> validStates;
+    if (args.containsOption("--state"))
+    {
+        auto stateFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--state"));
+        if (!stateFile.loadFileAsData(validStates[0]))
+        {
+            printLine("can't read " + stateFile.getFullPathName());
+            return 1;
+        }
+
+        processor.setStateInformation(validStates[0].getData(), static_cast<int>(validStates[0].getSize()));
+    }
+    else
+    {
+        randomiseState(processor, random);
+        processor.getStateInformation(validStates[0]);
+    }
+    validStates[1] = makeLegacyState(processor, makeRandomOrder(random));
+
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    int numNonFinite = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto state = damage(validStates[static_cast<size_t>(random.nextInt(2))], random);
+        processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            for (int s = 0; s < blockSize; ++s)
+                buffer.setSample(ch, s, (random.nextFloat() * 2.f - 1.f) * 0.25f);
+        }
+
+        processor.processBlock(buffer, midi);
+        if (!isFinite(buffer))
+        {
+            printLine("non-finite output after iteration " + juce::String(i) + ", a " + juce::String(state.getSize()) + " byte state");
+            ++numNonFinite;
+            //start the chains over, so one bad state doesn't fail every iteration after it
+            processor.releaseResources();
+            processor.setStateInformation(validStates[0].getData(), static_cast<int>(validStates[0].getSize()));
+            processor.prepareToPlay(sampleRate, blockSize);
+        }
+
+        //the timer delivers what the loads queued and prepares the stages they enabled
+        if ((i % 64) == 0)
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(1);
+    }
+
+    processor.releaseResources();
+
+    printLine(juce::String(iterations) + " damaged states loaded, " + juce::String(numNonFinite) + " produced non-finite output");
+    return numNonFinite == 0 ? 0 : 2;
+}
@@ -0,0 +1,25 @@
+/*
+  ==============================================================================
+
+    StateTest.h
+    Project13Batch --bench-state and --fuzz-state: times and attacks Project13AudioProcessor's session state.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ loads many different session states into one processor, in the current format and in the legacy ValueTree format,
+ and prints how long setStateInformation() and getStateInformation() take.
+ returns the process exit code.
+ */
+int runStateBenchmark(const juce::ArgumentList& args);
+
+/*
+ feeds truncated, bit-flipped, overwritten and random states to setStateInformation() while the processor is prepared,
+ running a block after each one.  returns the process exit code: 0 if nothing crashed and every block came out finite.
+ */
+int runStateFuzz(const juce::ArgumentList& args);
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    Arena.h
+    A single cache-line aligned block that DSP stages carve their state from.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ The Arena is reserved once, off the audio thread, with the total size every stage asked for.
+ Stages then carve their buffers out of it in the order they are prepared, so state that is processed together sits together in memory.
+ Carving never allocates.  Releasing the arena frees everything at once.
+ */
+struct Arena
+{
+    static constexpr size_t alignment = 64;
+
+    static constexpr size_t align(size_t bytes)
+    {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    template<typename T>
+    static constexpr size_t bytesFor(size_t count)
+    {
+        return align(count * sizeof(T));
+    }
+
+    void reserve(size_t bytes)
+    {
+        release();
+        if (bytes == 0)
+            return;
+
+        storage.calloc(bytes + alignment);
+        auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+        base = storage.get() + (align(address) - address);
+        capacity = bytes;
+    }
+
+    void release()
+    {
+        storage.free();
+        base = nullptr;
+        capacity = 0;
+        used = 0;
+    }
+
+    /*
+     returns zeroed, cache-line aligned storage for count objects.
+     the arena must have been reserved large enough; use bytesFor() when computing the size.
+     */
+    template<typename T>
+    T* allocate(size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "the arena never runs destructors");
+
+        auto bytes = bytesFor<T>(count);
+        jassert(used + bytes <= capacity);
+        if (used + bytes > capacity)
+            return nullptr;
+
+        auto* ptr = base + used;
+        used += bytes;
+        return reinterpret_cast<T*>(ptr);
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getBytesUsed() const { return used; }
+    //what this arena actually holds on the heap, including the alignment slack
+    size_t getFootprint() const { return capacity > 0 ? capacity + alignment : 0; }
+
+private:
+    juce::HeapBlock<char> storage;
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+};
+
+/*
+ a processor that takes its memory from an Arena instead of allocating in prepare().
+ 'Args' are whatever else its size depends on besides the spec, e.g. an FFT order.
+ */
+template<typename Processor, typename... Args>
+concept ArenaProcessor = requires(Processor p, const juce::dsp::ProcessSpec& spec, Arena& arena, Args... args)
+{
+    { Processor::getArenaBytes(spec, args...) } -> std::convertible_to<size_t>;
+    p.prepare(spec, arena, args...);
+};
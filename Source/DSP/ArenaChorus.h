@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    ArenaChorus.h
+    juce::dsp::Chorus, with its delay line carved from an Arena.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+#include "SharedTables.h"
+
+/*
+ Same controls and algorithm as juce::dsp::Chorus:
+ a linearly interpolated delay line modulated by a sine LFO around the centre delay, with feedback and a linear dry/wet mix.
+ The delay line is a power-of-two ring buffer so the read/write positions wrap with a mask.
+ The LFO's sine comes from SharedTables.
+ */
+template<typename SampleType>
+struct ArenaChorus
+{
+    static constexpr SampleType maxDepth = 1;
+    static constexpr SampleType maxCentreDelayMs = 100;
+    static constexpr SampleType oscVolumeMultiplier = static_cast<SampleType>(0.5);
+    static constexpr SampleType maximumDelayModulation = 20;
+
+    static size_t getDelayBufferSize(double sampleRate)
+    {
+        auto maxPossibleDelay = std::ceil((maximumDelayModulation * maxDepth * oscVolumeMultiplier + maxCentreDelayMs) * sampleRate / 1000.0);
+        //+2 for the interpolation neighbour and the sample being written
+        return static_cast<size_t>(juce::nextPowerOfTwo(static_cast<int>(maxPossibleDelay) + 2));
+    }
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        auto numChannels = static_cast<size_t>(spec.numChannels);
+        auto blockSize = static_cast<size_t>(spec.maximumBlockSize);
+
+        return Arena::bytesFor<SampleType>(numChannels * getDelayBufferSize(spec.sampleRate)) //delay line
+             + Arena::bytesFor<SampleType>(numChannels)                                       //feedback
+             + Arena::bytesFor<SampleType>(blockSize)                                         //delay times
+             + Arena::bytesFor<SampleType>(numChannels * blockSize);                          //dry copy
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels > 0);
+
+        sampleRate = spec.sampleRate;
+        numChannels = static_cast<size_t>(spec.numChannels);
+        maxBlockSize = static_cast<size_t>(spec.maximumBlockSize);
+        delaySize = getDelayBufferSize(sampleRate);
+        tables = &SharedTables::get();
+
+        delayBuffer = arena.allocate<SampleType>(numChannels * delaySize);
+        lastOutput = arena.allocate<SampleType>(numChannels);
+        delayTimes = arena.allocate<SampleType>(maxBlockSize);
+        dry = arena.allocate<SampleType>(numChannels * maxBlockSize);
+
+        for (auto* smoother : { &oscVolume, &feedbackVolume, &mix })
+            smoother->reset(sampleRate, 0.05);
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (delayBuffer == nullptr)
+            return;
+
+        std::fill(delayBuffer, delayBuffer + numChannels * delaySize, SampleType(0));
+        std::fill(lastOutput, lastOutput + numChannels, SampleType(0));
+
+        for (auto* smoother : { &oscVolume, &feedbackVolume, &mix })
+            smoother->setCurrentAndTargetValue(smoother->getTargetValue());
+
+        phase = 0;
+        writePosition = 0;
+    }
+
+    //'other' must have been prepared with the same spec
+    void copyStateFrom(const ArenaChorus& other)
+    {
+        jassert(numChannels == other.numChannels && delaySize == other.delaySize && delayBuffer != nullptr && other.delayBuffer != nullptr);
+
+        std::copy(other.delayBuffer, other.delayBuffer + numChannels * delaySize, delayBuffer);
+        std::copy(other.lastOutput, other.lastOutput + numChannels, lastOutput);
+        oscVolume = other.oscVolume;
+        feedbackVolume = other.feedbackVolume;
+        mix = other.mix;
+        phase = other.phase;
+        writePosition = other.writePosition;
+    }
+
+    void setRate(SampleType newRateHz)
+    {
+        jassert(juce::isPositiveAndBelow(newRateHz, static_cast<SampleType>(100.0)));
+        rate = newRateHz;
+    }
+
+    void setDepth(SampleType newDepth)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newDepth, maxDepth));
+        oscVolume.setTargetValue(newDepth * oscVolumeMultiplier);
+    }
+
+    void setCentreDelay(SampleType newDelayMs)
+    {
+        jassert(juce::isPositiveAndBelow(newDelayMs, maxCentreDelayMs));
+        centreDelay = newDelayMs;
+    }
+
+    void setFeedback(SampleType newFeedback)
+    {
+        jassert(newFeedback >= static_cast<SampleType>(-1.0) && newFeedback <= static_cast<SampleType>(1.0));
+        feedbackVolume.setTargetValue(newFeedback);
+    }
+
+    void setMix(SampleType newMix)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newMix, static_cast<SampleType>(1.0)));
+        mix.setTargetValue(newMix);
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            std::copy_n(inputBlock.getChannelPointer(ch), numSamples, dry + ch * maxBlockSize);
+
+        const auto increment = juce::MathConstants<double>::twoPi * static_cast<double>(rate) / sampleRate;
+        const auto msToSamples = static_cast<SampleType>(sampleRate / 1000.0);
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            //sin(phase - pi)
+            auto lfo = -tables->sine<SampleType>(phase) * oscVolume.getNextValue();
+            delayTimes[i] = juce::jmax(SampleType(1), maximumDelayModulation * lfo + centreDelay) * msToSamples;
+
+            phase += increment;
+            if (phase >= juce::MathConstants<double>::twoPi)
+                phase -= juce::MathConstants<double>::twoPi;
+        }
+
+        const auto mask = delaySize - 1;
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto feedback = feedbackVolume.getNextValue();
+            auto delayInt = static_cast<size_t>(delayTimes[i]);
+            auto frac = delayTimes[i] - static_cast<SampleType>(delayInt);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                auto* line = delayBuffer + ch * delaySize;
+                line[writePosition] = inputBlock.getSample(static_cast<int>(ch), static_cast<int>(i)) + feedback * lastOutput[ch];
+
+                auto newer = line[(writePosition - delayInt) & mask];
+                auto older = line[(writePosition - delayInt - 1) & mask];
+                auto output = newer + frac * (older - newer);
+
+                outputBlock.setSample(static_cast<int>(ch), static_cast<int>(i), output);
+                lastOutput[ch] = output;
+            }
+
+            writePosition = (writePosition + 1) & mask;
+        }
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto wet = mix.getNextValue();
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                auto* out = outputBlock.getChannelPointer(ch);
+                out[i] = dry[ch * maxBlockSize + i] * (1 - wet) + out[i] * wet;
+            }
+        }
+    }
+
+private:
+    double sampleRate = 44100.0;
+    size_t numChannels = 0, maxBlockSize = 0, delaySize = 0, writePosition = 0;
+    const SharedTables* tables = nullptr;
+
+    SampleType* delayBuffer = nullptr;
+    SampleType* lastOutput = nullptr;
+    SampleType* delayTimes = nullptr;
+    SampleType* dry = nullptr;
+
+    SampleType rate = 1, centreDelay = 7;
+    juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Linear> oscVolume, feedbackVolume, mix;
+    double phase = 0;
+};
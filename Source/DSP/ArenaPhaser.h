@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    ArenaPhaser.h
+    juce::dsp::Phaser, with its state carved from an Arena.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+#include "SharedTables.h"
+
+/*
+ Same controls and algorithm as juce::dsp::Phaser:
+ 6 first-order TPT allpass stages, swept by a sine LFO that is evaluated every 4 samples, with feedback and a linear dry/wet mix.
+ The allpass states, feedback samples, LFO frequencies and dry copy live in the Arena.
+ The LFO's sine and the cutoff warping come from SharedTables instead of std::sin and std::tan.
+ */
+template<typename SampleType>
+struct ArenaPhaser
+{
+    static constexpr size_t numStages = 6;
+    static constexpr int maxUpdateCounter = 4;
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        auto numChannels = static_cast<size_t>(spec.numChannels);
+        auto blockSize = static_cast<size_t>(spec.maximumBlockSize);
+
+        return Arena::bytesFor<SampleType>(numStages * numChannels)         //allpass states
+             + Arena::bytesFor<SampleType>(numChannels)                     //feedback
+             + Arena::bytesFor<SampleType>(blockSize / maxUpdateCounter + 1) //LFO frequencies
+             + Arena::bytesFor<SampleType>(numChannels * blockSize);        //dry copy
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels > 0);
+
+        sampleRate = spec.sampleRate;
+        numChannels = static_cast<size_t>(spec.numChannels);
+        maxBlockSize = static_cast<size_t>(spec.maximumBlockSize);
+        tables = &SharedTables::get();
+
+        filterState = arena.allocate<SampleType>(numStages * numChannels);
+        lastOutput = arena.allocate<SampleType>(numChannels);
+        frequencies = arena.allocate<SampleType>(maxBlockSize / maxUpdateCounter + 1);
+        dry = arena.allocate<SampleType>(numChannels * maxBlockSize);
+
+        for (auto* smoother : { &oscVolume, &feedbackVolume, &mix })
+            smoother->reset(sampleRate, 0.05);
+
+        setCentreFrequency(centreFrequency);
+        reset();
+    }
+
+    void reset()
+    {
+        if (filterState == nullptr)
+            return;
+
+        std::fill(filterState, filterState + numStages * numChannels, SampleType(0));
+        std::fill(lastOutput, lastOutput + numChannels, SampleType(0));
+
+        for (auto* smoother : { &oscVolume, &feedbackVolume, &mix })
+            smoother->setCurrentAndTargetValue(smoother->getTargetValue());
+
+        phase = 0;
+        updateCounter = 0;
+        G = cutoffToG(centreFrequency);
+    }
+
+    //'other' must have been prepared with the same spec
+    void copyStateFrom(const ArenaPhaser& other)
+    {
+        jassert(numChannels == other.numChannels && filterState != nullptr && other.filterState != nullptr);
+
+        std::copy(other.filterState, other.filterState + numStages * numChannels, filterState);
+        std::copy(other.lastOutput, other.lastOutput + numChannels, lastOutput);
+        oscVolume = other.oscVolume;
+        feedbackVolume = other.feedbackVolume;
+        mix = other.mix;
+        phase = other.phase;
+        updateCounter = other.updateCounter;
+        G = other.G;
+    }
+
+    void setRate(SampleType newRateHz)
+    {
+        jassert(juce::isPositiveAndBelow(newRateHz, static_cast<SampleType>(100.0)));
+        rate = newRateHz;
+    }
+
+    void setDepth(SampleType newDepth)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newDepth, static_cast<SampleType>(1.0)));
+        oscVolume.setTargetValue(newDepth * static_cast<SampleType>(0.5));
+    }
+
+    void setCentreFrequency(SampleType newCentreHz)
+    {
+        jassert(juce::isPositiveAndBelow(newCentreHz, static_cast<SampleType>(sampleRate * 0.5)));
+        centreFrequency = newCentreHz;
+        normCentreFrequency = juce::mapFromLog10(centreFrequency, static_cast<SampleType>(20.0), getMaxFrequency());
+    }
+
+    void setFeedback(SampleType newFeedback)
+    {
+        jassert(newFeedback >= static_cast<SampleType>(-1.0) && newFeedback <= static_cast<SampleType>(1.0));
+        feedbackVolume.setTargetValue(newFeedback);
+    }
+
+    void setMix(SampleType newMix)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newMix, static_cast<SampleType>(1.0)));
+        mix.setTargetValue(newMix);
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            std::copy_n(inputBlock.getChannelPointer(ch), numSamples, dry + ch * maxBlockSize);
+
+        //the LFO runs at a quarter of the sample rate
+        size_t numSamplesDown = 0;
+        for (auto counter = updateCounter, i = 0; i < static_cast<int>(numSamples); ++i)
+        {
+            if (counter == 0)
+                ++numSamplesDown;
+
+            counter = (counter + 1) % maxUpdateCounter;
+        }
+
+        const auto maxFrequency = getMaxFrequency();
+        const auto increment = juce::MathConstants<double>::twoPi * static_cast<double>(rate) * maxUpdateCounter / sampleRate;
+        for (size_t k = 0; k < numSamplesDown; ++k)
+        {
+            //sin(phase - pi)
+            auto lfo = -tables->sine<SampleType>(phase) * oscVolume.getNextValue();
+            frequencies[k] = juce::mapToLog10(juce::jlimit(SampleType(0), SampleType(1), lfo + normCentreFrequency),
+                                              static_cast<SampleType>(20.0), maxFrequency);
+
+            phase += increment;
+            if (phase >= juce::MathConstants<double>::twoPi)
+                phase -= juce::MathConstants<double>::twoPi;
+        }
+
+        auto counter = updateCounter;
+        size_t k = 0;
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            if (counter == 0)
+                G = cutoffToG(frequencies[k++]);
+
+            auto feedback = feedbackVolume.getNextValue();
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                auto* s = filterState + ch * numStages;
+                auto output = inputBlock.getSample(static_cast<int>(ch), static_cast<int>(i)) - lastOutput[ch];
+
+                for (size_t n = 0; n < numStages; ++n)
+                {
+                    //first-order TPT allpass
+                    auto v = G * (output - s[n]);
+                    auto y = v + s[n];
+                    s[n] = y + v;
+                    output = 2 * y - output;
+                }
+
+                outputBlock.setSample(static_cast<int>(ch), static_cast<int>(i), output);
+                lastOutput[ch] = output * feedback;
+            }
+
+            counter = (counter + 1) % maxUpdateCounter;
+        }
+
+        updateCounter = static_cast<int>((static_cast<size_t>(updateCounter) + numSamples) % maxUpdateCounter);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto wet = mix.getNextValue();
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                auto* out = outputBlock.getChannelPointer(ch);
+                out[i] = dry[ch * maxBlockSize + i] * (1 - wet) + out[i] * wet;
+            }
+        }
+    }
+
+private:
+    SampleType getMaxFrequency() const
+    {
+        return juce::jmin(static_cast<SampleType>(20000.0), static_cast<SampleType>(sampleRate * 0.49));
+    }
+
+    SampleType cutoffToG(SampleType cutoffHz) const
+    {
+        auto g = tables->tanPi(static_cast<SampleType>(cutoffHz / sampleRate));
+        return g / (1 + g);
+    }
+
+    double sampleRate = 44100.0;
+    size_t numChannels = 0, maxBlockSize = 0;
+    const SharedTables* tables = nullptr;
+
+    SampleType* filterState = nullptr;
+    SampleType* lastOutput = nullptr;
+    SampleType* frequencies = nullptr;
+    SampleType* dry = nullptr;
+
+    SampleType rate = 1, centreFrequency = 1300, normCentreFrequency = static_cast<SampleType>(0.5), G = 0;
+    juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Linear> oscVolume, feedbackVolume, mix;
+    double phase = 0;
+    int updateCounter = 0;
+};
@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    Biquad.h
+    A transposed direct form II biquad whose coefficients can change without resetting it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+
+/*
+ normalised so that a0 == 1.
+ always computed in double; the filter keeps them at its own precision.
+ */
+struct BiquadCoefficients
+{
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+
+    //takes the coefficients of a 2nd order juce::dsp::IIR::Coefficients, which are already normalised
+    static BiquadCoefficients fromJuce(const juce::dsp::IIR::Coefficients<double>& coefficients)
+    {
+        jassert(coefficients.getFilterOrder() == 2);
+        const auto* raw = coefficients.getRawCoefficients();
+        return { raw[0], raw[1], raw[2], raw[3], raw[4] };
+    }
+};
+
+/*
+ Unlike juce::dsp::IIR::Filter, setting new coefficients copies 5 numbers and keeps the filter state,
+ so a sweep doesn't click and nothing is allocated on the audio thread.
+ The state lives in the Arena.
+ */
+template<typename SampleType>
+struct Biquad
+{
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        return Arena::bytesFor<SampleType>(2 * static_cast<size_t>(spec.numChannels));
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        numChannels = static_cast<size_t>(spec.numChannels);
+        state = arena.allocate<SampleType>(2 * numChannels);
+        reset();
+    }
+
+    void reset()
+    {
+        if (state != nullptr)
+            std::fill(state, state + 2 * numChannels, SampleType(0));
+    }
+
+    //both must have been prepared with the same spec
+    void copyStateFrom(const Biquad& other)
+    {
+        jassert(numChannels == other.numChannels && state != nullptr && other.state != nullptr);
+        std::copy(other.state, other.state + 2 * numChannels, state);
+    }
+
+    void setCoefficients(const BiquadCoefficients& c)
+    {
+        b0 = static_cast<SampleType>(c.b0);
+        b1 = static_cast<SampleType>(c.b1);
+        b2 = static_cast<SampleType>(c.b2);
+        a1 = static_cast<SampleType>(c.a1);
+        a2 = static_cast<SampleType>(c.a2);
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = inputBlock.getChannelPointer(ch);
+            auto* out = outputBlock.getChannelPointer(ch);
+            auto s1 = state[2 * ch];
+            auto s2 = state[2 * ch + 1];
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto x = in[i];
+                auto y = b0 * x + s1;
+                s1 = b1 * x - a1 * y + s2;
+                s2 = b2 * x - a2 * y;
+                out[i] = y;
+            }
+
+            state[2 * ch] = s1;
+            state[2 * ch + 1] = s2;
+        }
+    }
+
+private:
+    size_t numChannels = 0;
+    SampleType* state = nullptr;
+    SampleType b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+};
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    BiquadCascade.h
+    A stereo chain of transposed direct form II biquads, processed both channels at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Biquad.h"
+
+/*
+ up to maxSections 2nd order sections, e.g. a 48 dB/oct high-pass followed by a 48 dB/oct low-pass.
+ trivially copyable, so it can travel through a TripleBuffer.
+ */
+struct BiquadCascadeCoefficients
+{
+    static constexpr size_t maxSections = 8;
+
+    std::array<BiquadCoefficients, maxSections> sections {};
+    size_t numSections = 0;
+
+    void add(const BiquadCoefficients& c)
+    {
+        jassert(numSections < maxSections);
+        if (numSections < maxSections)
+            sections[numSections++] = c;
+    }
+};
+
+/*
+ Both channels run through the same coefficients, so the state is laid out channel-innermost
+ and every line of the inner loop is the same operation on the two channels:
+ the compiler turns it into one vector instruction per step instead of running the channels one after the other.
+ Each section makes one pass over the block, which is at most a 64 sample sub-block and stays in L1.
+ Like Biquad, new coefficients are copied in without touching the state.
+ */
+template<typename SampleType>
+struct BiquadCascade
+{
+    static constexpr size_t numChannels = 2;
+
+    void reset()
+    {
+        for (auto& s : state)
+            s = {};
+    }
+
+    void setCoefficients(const BiquadCascadeCoefficients& c)
+    {
+        //sections that just became active start from silence
+        for (auto i = numSections; i < c.numSections; ++i)
+            state[i] = {};
+
+        numSections = c.numSections;
+        for (size_t i = 0; i < numSections; ++i)
+        {
+            const auto& section = c.sections[i];
+            auto& k = coefficients[i];
+            k.b0 = static_cast<SampleType>(section.b0);
+            k.b1 = static_cast<SampleType>(section.b1);
+            k.b2 = static_cast<SampleType>(section.b2);
+            k.a1 = static_cast<SampleType>(section.a1);
+            k.a2 = static_cast<SampleType>(section.a2);
+        }
+    }
+
+    bool isActive() const { return numSections > 0; }
+
+    void process(juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        jassert(block.getNumChannels() == numChannels);
+        const auto numSamples = block.getNumSamples();
+        std::array<SampleType*, numChannels> channels { block.getChannelPointer(0), block.getChannelPointer(1) };
+
+        for (size_t s = 0; s < numSections; ++s)
+        {
+            const auto k = coefficients[s];
+            alignas(16) std::array<SampleType, numChannels> s1 = state[s].s1;
+            alignas(16) std::array<SampleType, numChannels> s2 = state[s].s2;
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                alignas(16) std::array<SampleType, numChannels> x, y;
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    x[ch] = channels[ch][i];
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    y[ch] = k.b0 * x[ch] + s1[ch];
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    s1[ch] = k.b1 * x[ch] - k.a1 * y[ch] + s2[ch];
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    s2[ch] = k.b2 * x[ch] - k.a2 * y[ch];
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    channels[ch][i] = y[ch];
+            }
+
+            state[s].s1 = s1;
+            state[s].s2 = s2;
+        }
+    }
+
+private:
+    struct Section
+    {
+        SampleType b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+
+    struct State
+    {
+        std::array<SampleType, numChannels> s1 {}, s2 {};
+    };
+
+    std::array<Section, BiquadCascadeCoefficients::maxSections> coefficients {};
+    std::array<State, BiquadCascadeCoefficients::maxSections> state {};
+    size_t numSections = 0;
+};
@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    CoefficientWorker.h
+    Computes every instance's filter coefficients away from the audio thread, on one thread shared by the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+/*
+ One thread, shared by every instance in the process, that turns the settings the audio threads post into coefficients.
+
+ Each kind of coefficients in each instance is a Client with its own TripleBuffers, see CoefficientRequests.
+ The thread starts when the first client is added and stops when the last one is removed, like ConvolutionScheduler's.
+ Clients are added and removed off the audio thread; remove() waits for a computation that is running on the client,
+ so it can be destroyed right after.  The audio thread only calls notify(), which sets an atomic:
+ signalling an event takes a lock, so the thread polls the flag, often while settings are changing and rarely once
+ they have settled.
+ */
+struct CoefficientWorker
+{
+    struct Client
+    {
+        virtual ~Client() = default;
+        //worker thread.  computes the latest settings, if there are new ones, and returns whether there were
+        virtual bool computePending() = 0;
+    };
+
+    static CoefficientWorker& get()
+    {
+        static CoefficientWorker worker;
+        return worker;
+    }
+
+    void add(Client& client)
+    {
+        const juce::ScopedLock sl(threadLock);
+        {
+            const juce::ScopedWriteLock wl(lock);
+            clients.push_back(&client);
+        }
+
+        //settings posted before the client was added are still waiting
+        notify();
+        if (thread == nullptr)
+        {
+            thread = std::make_unique<WorkerThread>(*this);
+            thread->startThread();
+        }
+    }
+
+    void remove(Client& client)
+    {
+        const juce::ScopedLock sl(threadLock);
+        bool isEmpty = false;
+        {
+            const juce::ScopedWriteLock wl(lock);
+            clients.erase(std::remove(clients.begin(), clients.end(), &client), clients.end());
+            isEmpty = clients.empty();
+        }
+
+        if (isEmpty)
+            thread.reset();
+    }
+
+    //audio thread, after posting settings
+    void notify()
+    {
+        settingsPosted.store(true, std::memory_order_release);
+    }
+
+private:
+    CoefficientWorker() = default;
+
+    struct WorkerThread : juce::Thread
+    {
+        explicit WorkerThread(CoefficientWorker& owner)
+            : juce::Thread("Project13 coefficients"), worker(owner)
+        {
+        }
+
+        ~WorkerThread() override
+        {
+            stopThread(2000);
+        }
+
+        void run() override
+        {
+            int idlePolls = 0;
+            while (!threadShouldExit())
+            {
+                if (worker.computePending())
+                {
+                    idlePolls = 0;
+                }
+                else
+                {
+                    //stopThread() still wakes the thread at once, so the idle interval only delays the first change after a pause
+                    wait(idlePolls < pollsBeforeIdle ? activePollMs : idlePollMs);
+                    idlePolls = juce::jmin(idlePolls + 1, pollsBeforeIdle);
+                }
+            }
+        }
+
+        static constexpr int activePollMs = 1;
+        static constexpr int idlePollMs = 10;
+        //about 100 ms of no new settings before the thread slows down
+        static constexpr int pollsBeforeIdle = 100;
+
+        CoefficientWorker& worker;
+    };
+
+    //returns false when no client had anything new
+    bool computePending()
+    {
+        //an idle thread only looks at the flag, it doesn't take the lock
+        if (!settingsPosted.exchange(false, std::memory_order_acquire))
+            return false;
+
+        const juce::ScopedReadLock sl(lock);
+        auto computed = false;
+        for (auto* client : clients)
+            computed = client->computePending() || computed;
+
+        return computed;
+    }
+
+    //threadLock orders add() and remove(); lock keeps the thread off the list while it changes
+    juce::CriticalSection threadLock;
+    juce::ReadWriteLock lock;
+    std::vector<Client*> clients;
+    std::unique_ptr<WorkerThread> thread;
+    std::atomic<bool> settingsPosted { false };
+};
+
+/*
+ The audio thread posts the filter settings it wants, the CoefficientWorker turns them into coefficients and
+ publishes them back.  Both directions go through a TripleBuffer, so the audio thread never waits on the worker;
+ when settings change faster than they can be computed, the intermediate ones are skipped.
+ Settings are only computed between start() and stop(), which are called off the audio thread.
+ */
+template<typename Settings, typename Coefficients>
+struct CoefficientRequests : CoefficientWorker::Client
+{
+    using ComputeFunction = Coefficients (*)(const Settings&);
+
+    explicit CoefficientRequests(ComputeFunction computeFunction)
+        : compute(computeFunction)
+    {
+    }
+
+    ~CoefficientRequests() override
+    {
+        stop();
+    }
+
+    void start()
+    {
+        if (!started)
+            CoefficientWorker::get().add(*this);
+
+        started = true;
+    }
+
+    void stop()
+    {
+        if (started)
+            CoefficientWorker::get().remove(*this);
+
+        started = false;
+    }
+
+    //audio thread.  only call this when the settings actually changed; the worker picks them up on its next poll.
+    void request(const Settings& settings)
+    {
+        requests.write(settings);
+        CoefficientWorker::get().notify();
+    }
+
+    //audio thread.  returns true when newer coefficients were published since the last call.
+    bool pull(Coefficients& coefficients)
+    {
+        return published.read(coefficients);
+    }
+
+private:
+    bool computePending() override
+    {
+        Settings settings;
+        if (!requests.read(settings))
+            return false;
+
+        published.write(compute(settings));
+        return true;
+    }
+
+    ComputeFunction compute;
+    TripleBuffer<Settings> requests;
+    TripleBuffer<Coefficients> published;
+    bool started = false;
+};
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    CommandQueue.h
+    Bounded lock-free multi-producer / single-consumer queue of typed commands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ For discrete actions that must all arrive, in the order they were made, unlike TripleBuffer's latest value.
+ Storage is a fixed ring of cells allocated with the queue; nothing allocates afterwards.
+
+ Every cell carries a sequence number that says whose turn it is (Vyukov's bounded queue):
+ producers claim a cell by advancing the shared write position with a compare-and-swap, then copy the command in
+ and publish it by bumping the cell's sequence.  Any number of threads can push at once and none of them blocks another.
+ The single consumer never loops: pop() reads one sequence and either takes the command or returns false.
+ A command whose producer is still copying it holds back the ones behind it until the next pop().
+ */
+template<typename Command, size_t capacity>
+struct CommandQueue
+{
+    static_assert(std::is_trivially_copyable_v<Command>, "commands are copied between threads without allocating");
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "capacity must be a power of 2");
+
+    CommandQueue()
+    {
+        for (size_t i = 0; i < capacity; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    //any thread.  returns false, and drops the command, if the queue is full
+    bool push(const Command& command)
+    {
+        auto position = writePosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = cells[position & mask];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+            if (difference == 0)
+            {
+                //the cell is free.  claim it, unless another producer got there first
+                if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.command = command;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                //the consumer hasn't taken this cell's previous command yet
+                return false;
+            }
+            else
+            {
+                position = writePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //consumer thread only.  returns false if there's nothing (complete) to take
+    bool pop(Command& command)
+    {
+        auto& cell = cells[readPosition & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != readPosition + 1)
+            return false;
+
+        command = cell.command;
+        //hands the cell back to the producers, one lap later
+        cell.sequence.store(readPosition + capacity, std::memory_order_release);
+        ++readPosition;
+        return true;
+    }
+
+private:
+    static constexpr size_t mask = capacity - 1;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence { 0 };
+        Command command {};
+    };
+
+    std::array<Cell, capacity> cells;
+    //producers and consumer update these constantly, so they get a cache line each
+    alignas(64) std::atomic<size_t> writePosition { 0 };
+    alignas(64) size_t readPosition = 0;
+};
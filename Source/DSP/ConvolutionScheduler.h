@@ -0,0 +1,370 @@
+/*
+  ==============================================================================
+
+    ConvolutionScheduler.h
+    Runs the tail partitions of every PartitionedConvolver in the process on a few shared threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ImpulseResponse.h"
+
+/*
+ The tail of one channel's convolution: its spectrum history and the jobs the audio thread hands it.
+
+ Every tailPartitionSize input samples the audio thread posts a job: the last two blocks of input.
+ Running a job transforms them, pushes the spectrum into the history and multiplies the history with the
+ impulse response's tail spectra, which gives the next tailPartitionSize samples of tail output.
+ The job's output is collected the impulse response's tail lead of blocks later, at its deadline.
+
+ Jobs are run by the scheduler threads.  When rendering offline the audio thread also runs any job still pending
+ at its deadline, instead of losing the block; in realtime it never runs one, a late job's block is dropped.
+ 'busy' makes sure only one executor touches the history at a time, and jobs always run in the order they were posted.
+
+ Job states go idle -> pending (audio thread) -> running -> done (executor) -> idle (audio thread).
+ A slot's buffers are only written while it is idle or done, so no executor is reading them.
+ */
+struct ConvolutionTail
+{
+    static constexpr int blockSize = ImpulseResponse::tailPartitionSize;
+
+    ConvolutionTail(ImpulseResponse::Ptr ir, int irChannel)
+        : impulseResponse(std::move(ir)), channel(irChannel), fft(ImpulseResponse::tailFFTOrder),
+          //every job in flight, plus room for the one being posted and one being taken back
+          jobs(static_cast<size_t>(impulseResponse->getTailLead()) + 2)
+    {
+        jassert(impulseResponse != nullptr && juce::isPositiveAndBelow(channel, impulseResponse->getNumChannels()));
+
+        numPartitions = impulseResponse->getNumTailPartitions();
+        history.assign(static_cast<size_t>(numPartitions) * ImpulseResponse::tailSpectrumSize, 0.f);
+        scratch.assign(4 * blockSize, 0.f);
+        for (auto& job : jobs)
+        {
+            job.input.assign(2 * blockSize, 0.f);
+            job.output.assign(blockSize, 0.f);
+        }
+    }
+
+    const ImpulseResponse& getImpulseResponse() const { return *impulseResponse; }
+
+    size_t getSizeInBytes() const
+    {
+        return sizeof(*this) + (history.size() + scratch.size() + jobs.size() * 3 * blockSize) * sizeof(float);
+    }
+
+    /*
+     audio thread.  'input' is 2 blockSize samples, the block before the new one and the new one.
+     'clearHistory' starts the tail from silence, after the convolver was reset.
+     returns false if the slot is still in use by a job a thread hasn't finished, in which case the block is dropped,
+     and its input never reaches the history: the caller has to clear it with the next job it posts.
+     */
+    bool post(juce::int64 sequence, const float* input, juce::int64 deadlineTicks, bool clearHistory)
+    {
+        auto& job = getJob(sequence);
+        auto state = job.state.load(std::memory_order_acquire);
+
+        if (state == pending)
+        {
+            //a job nobody ran in all the blocks since.  take the slot back unless an executor claims it first
+            auto expected = pending;
+            if (!job.state.compare_exchange_strong(expected, idle, std::memory_order_acq_rel))
+                return false;
+
+            //its input never reached the history, so every block after it would be out of alignment
+            clearHistory = true;
+        }
+        else if (state == running)
+        {
+            return false;
+        }
+
+        job.sequence.store(sequence, std::memory_order_relaxed);
+        job.deadlineTicks.store(deadlineTicks, std::memory_order_relaxed);
+        job.clearHistory = clearHistory;
+        std::copy_n(input, 2 * blockSize, job.input.data());
+        job.state.store(pending, std::memory_order_release);
+        return true;
+    }
+
+    /*
+     audio thread.  copies job 'sequence''s output into 'output' and returns true.
+     if 'waitForRunningJob', as when rendering offline, a job that hasn't started yet is run here and now,
+     and one a thread is still running is waited for.  otherwise a job that isn't done returns false and that
+     block of the tail is lost; a pending one is left for the threads, since the history still needs its input.
+     */
+    bool collect(juce::int64 sequence, float* output, bool waitForRunningJob)
+    {
+        auto& job = getJob(sequence);
+        if (job.sequence.load(std::memory_order_relaxed) != sequence)
+            return false;
+
+        if (waitForRunningJob)
+        {
+            while (job.state.load(std::memory_order_acquire) != done)
+            {
+                if (!tryRunNextJob())
+                    std::this_thread::yield();
+            }
+        }
+
+        if (job.state.load(std::memory_order_acquire) != done)
+            return false;
+
+        std::copy_n(job.output.data(), blockSize, output);
+        job.state.store(idle, std::memory_order_release);
+        return true;
+    }
+
+    //any executor.  the deadline of the job that would run next, or false if there is none or the tail is busy
+    bool getNextDeadline(juce::int64& deadlineTicks) const
+    {
+        if (busy.load(std::memory_order_relaxed))
+            return false;
+
+        const auto* job = findNextJob();
+        if (job == nullptr)
+            return false;
+
+        deadlineTicks = job->deadlineTicks.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    //any executor.  runs the oldest pending job, or returns false if there is none or another executor holds the tail
+    bool tryRunNextJob()
+    {
+        auto expected = false;
+        if (!busy.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return false;
+
+        auto* job = findNextJob();
+        auto expectedState = pending;
+        auto claimed = job != nullptr && job->state.compare_exchange_strong(expectedState, running, std::memory_order_acq_rel);
+        if (claimed)
+        {
+            run(*job);
+            job->state.store(done, std::memory_order_release);
+        }
+
+        busy.store(false, std::memory_order_release);
+        return claimed;
+    }
+
+private:
+    static constexpr int idle = 0, pending = 1, running = 2, done = 3;
+
+    struct Job
+    {
+        std::atomic<int> state { idle };
+        //atomic because executors scan them while the audio thread may be taking back a stale pending slot
+        std::atomic<juce::int64> sequence { -1 }, deadlineTicks { 0 };
+        bool clearHistory = false;
+        std::vector<float> input, output;
+    };
+
+    Job& getJob(juce::int64 sequence) { return jobs[static_cast<size_t>(sequence) % jobs.size()]; }
+
+    const Job* findNextJob() const
+    {
+        const Job* next = nullptr;
+        for (const auto& job : jobs)
+        {
+            if (job.state.load(std::memory_order_acquire) == pending && (next == nullptr || job.sequence.load(std::memory_order_relaxed) < next->sequence.load(std::memory_order_relaxed)))
+                next = &job;
+        }
+
+        return next;
+    }
+
+    Job* findNextJob() { return const_cast<Job*>(std::as_const(*this).findNextJob()); }
+
+    //overlap-save: the last blockSize samples of the circular convolution are the linear one
+    void run(Job& job)
+    {
+        juce::ScopedNoDenormals noDenormals;
+        constexpr int spectrumSize = ImpulseResponse::tailSpectrumSize;
+
+        if (job.clearHistory)
+        {
+            std::fill(history.begin(), history.end(), 0.f);
+            historyPosition = 0;
+        }
+
+        std::copy_n(job.input.data(), 2 * blockSize, scratch.data());
+        std::fill(scratch.begin() + 2 * blockSize, scratch.end(), 0.f);
+        fft.performRealOnlyForwardTransform(scratch.data(), true);
+
+        //the newest spectrum goes in front of the others, so history[historyPosition + k] meets partition k
+        historyPosition = (historyPosition == 0 ? numPartitions : historyPosition) - 1;
+        std::copy_n(scratch.data(), spectrumSize, history.data() + static_cast<size_t>(historyPosition) * spectrumSize);
+
+        std::fill(scratch.begin(), scratch.end(), 0.f);
+        for (int k = 0; k < numPartitions; ++k)
+        {
+            const auto* x = history.data() + static_cast<size_t>((historyPosition + k) % numPartitions) * spectrumSize;
+            const auto* h = impulseResponse->getTailSpectrum(channel, k);
+            ImpulseResponse::multiplyAdd(x, h, scratch.data(), blockSize + 1);
+        }
+
+        fft.performRealOnlyInverseTransform(scratch.data());
+        std::copy_n(scratch.data() + blockSize, blockSize, job.output.data());
+    }
+
+    ImpulseResponse::Ptr impulseResponse;
+    int channel = 0;
+    int numPartitions = 0;
+    juce::dsp::FFT fft;
+
+    //never resized, so the atomics never move
+    std::vector<Job> jobs;
+    std::atomic<bool> busy { false };
+
+    //only touched by whoever holds 'busy'
+    std::vector<float> history, scratch;
+    int historyPosition = 0;
+};
+
+/*
+ A few threads, shared by every instance in the process, that run posted tail jobs earliest deadline first.
+
+ The threads start when the first tail is added and stop when the last one is removed,
+ so nothing is left running while the plugin is unloaded.  Tails are added and removed on the message thread;
+ remove() waits for a job that is running on the tail, so it can be destroyed right after.
+ The audio thread only calls notify() and countDroppedBlock(), which just set atomics:
+ signalling an event takes a lock, so the threads poll a flag instead of being woken.
+ */
+struct ConvolutionScheduler
+{
+    static ConvolutionScheduler& get()
+    {
+        static ConvolutionScheduler scheduler;
+        return scheduler;
+    }
+
+    void add(ConvolutionTail& tail)
+    {
+        {
+            const juce::ScopedWriteLock sl(lock);
+            tails.push_back(&tail);
+        }
+
+        if (workers.empty())
+        {
+            const auto numWorkers = juce::jlimit(1, 4, juce::SystemStats::getNumCpus() / 2);
+            for (int i = 0; i < numWorkers; ++i)
+            {
+                workers.push_back(std::make_unique<Worker>(*this, i));
+                workers.back()->startThread();
+            }
+        }
+    }
+
+    void remove(ConvolutionTail& tail)
+    {
+        bool isEmpty = false;
+        {
+            const juce::ScopedWriteLock sl(lock);
+            tails.erase(std::remove(tails.begin(), tails.end(), &tail), tails.end());
+            isEmpty = tails.empty();
+        }
+
+        if (isEmpty)
+        {
+            for (auto& worker : workers)
+                worker->signalThreadShouldExit();
+            workers.clear();
+        }
+    }
+
+    //audio thread, after posting a job
+    void notify()
+    {
+        jobPosted.store(true, std::memory_order_release);
+    }
+
+    //audio thread, when a tail block wasn't ready at its deadline
+    void countDroppedBlock()
+    {
+        numDroppedBlocks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //any thread.  tail blocks lost by every instance in the process since it started
+    juce::uint64 getNumDroppedBlocks() const
+    {
+        return numDroppedBlocks.load(std::memory_order_relaxed);
+    }
+
+private:
+    ConvolutionScheduler() = default;
+
+    struct Worker : juce::Thread
+    {
+        Worker(ConvolutionScheduler& owner, int index)
+            : juce::Thread("Project13 convolution " + juce::String(index + 1)), scheduler(owner)
+        {
+        }
+
+        ~Worker() override
+        {
+            stopThread(2000);
+        }
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                if (!scheduler.runEarliestJob())
+                    wait(pollMs);
+            }
+        }
+
+        //a tail block is at least about 5 ms long (1024 samples at 192 kHz), so a job waits at most a fifth of it to start
+        static constexpr int pollMs = 1;
+        ConvolutionScheduler& scheduler;
+    };
+
+    //returns false when there was nothing to run
+    bool runEarliestJob()
+    {
+        //idle workers only look at the flag, they don't take the lock
+        if (!jobPosted.exchange(false, std::memory_order_acquire))
+            return false;
+
+        const juce::ScopedReadLock sl(lock);
+
+        ConvolutionTail* earliest = nullptr;
+        auto earliestDeadline = std::numeric_limits<juce::int64>::max();
+        for (auto* tail : tails)
+        {
+            juce::int64 deadline = 0;
+            if (!tail->getNextDeadline(deadline))
+                continue;
+
+            if (deadline < earliestDeadline)
+            {
+                earliest = tail;
+                earliestDeadline = deadline;
+            }
+        }
+
+        if (earliest == nullptr)
+            return false;
+
+        /*
+         leave the flag up so another worker takes the next job, and raise it again afterwards:
+         a job on this tail that was skipped while it was busy is only found by looking again.
+         */
+        jobPosted.store(true, std::memory_order_release);
+        earliest->tryRunNextJob();
+        jobPosted.store(true, std::memory_order_release);
+        return true;
+    }
+
+    juce::ReadWriteLock lock;
+    std::vector<ConvolutionTail*> tails;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> jobPosted { false };
+    std::atomic<juce::uint64> numDroppedBlocks { 0 };
+};
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    FdnReverb.h
+    An 8-line feedback delay network reverb, its lines interleaved in one ring buffer and mixed with a Hadamard matrix.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+
+/*
+ Every sample, each line is read at its own delay, low-passed for damping, mixed with every other line by an
+ orthonormal 8x8 Hadamard matrix, scaled by its share of the decay, and written back together with the input.
+ The output is a signed sum of the lines; the left and right instances use orthogonal signs, so a mono input still
+ comes out wide.
+
+ The lines are interleaved: the buffer is one power-of-two ring of frames, a frame being one sample of every line,
+ so all lines share one write position and every write is a single 8-lane store.  The state is laid out line-innermost,
+ like BiquadCascade's channels, and apart from the eight interpolated reads every step is a loop over the lanes that
+ the compiler turns into vector instructions.  The Hadamard matrix is applied as three butterfly passes, 24 adds
+ instead of 64 multiply-adds.
+
+ The read delays move with the modulation the processor hands in once per sub-block, usually an LFO shared by the
+ whole instance, and with the size.  They ramp there over the block, so neither ever jumps.
+ The network is float in every chain; the audio stays SampleType.
+ */
+template<typename SampleType>
+struct FdnReverb
+{
+    static constexpr size_t numLines = 8;
+    static constexpr float maxModulationMs = 1.f;
+    //at 100% size.  no two share a factor, and they spread over more than an octave, so the modes don't bunch up
+    static constexpr std::array<float, numLines> lineLengthsMs { 31.3f, 37.9f, 43.1f, 47.9f, 53.3f, 59.1f, 67.3f, 73.7f };
+    static constexpr float minSize = 0.25f;
+
+    static size_t getLineSize(double sampleRate)
+    {
+        auto maxDelay = std::ceil((lineLengthsMs.back() + maxModulationMs) * sampleRate / 1000.0);
+        //+2 for the interpolation neighbour and the sample being written
+        return static_cast<size_t>(juce::nextPowerOfTwo(static_cast<int>(maxDelay) + 2));
+    }
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        return Arena::bytesFor<float>(numLines * getLineSize(spec.sampleRate)); //delay lines
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels == 1);
+
+        sampleRate = spec.sampleRate;
+        lineSize = getLineSize(sampleRate);
+        buffer = arena.allocate<float>(numLines * lineSize);
+
+        mix.reset(sampleRate, 0.05);
+        updateFeedbackGains();
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (buffer == nullptr)
+            return;
+
+        std::fill(buffer, buffer + numLines * lineSize, 0.f);
+        lowpass.fill(0.f);
+        delays = getTargetDelays();
+        mix.setCurrentAndTargetValue(mix.getTargetValue());
+
+        writePosition = 0;
+        wasBypassed = false;
+    }
+
+    //'other' must have been prepared with the same spec.  the output signs stay this channel's
+    void copyStateFrom(const FdnReverb& other)
+    {
+        jassert(buffer != nullptr && other.buffer != nullptr && lineSize == other.lineSize);
+
+        std::copy_n(other.buffer, numLines * lineSize, buffer);
+        lowpass = other.lowpass;
+        delays = other.delays;
+        mix = other.mix;
+        writePosition = other.writePosition;
+        wasBypassed = other.wasBypassed;
+    }
+
+    //0 = left / mid, 1 = right / side.  picks the signs the lines are summed with
+    void setChannel(int channel)
+    {
+        for (size_t line = 0; line < numLines; ++line)
+        {
+            const auto bit = channel == 0 ? (line & 1) : (line & 2);
+            outputGains[line] = (bit != 0 ? -1.f : 1.f) / std::sqrt(static_cast<float>(numLines));
+        }
+    }
+
+    //0.25 to 1, of lineLengthsMs
+    void setSize(float newSize)
+    {
+        jassert(newSize >= minSize && newSize <= 1.f);
+        if (newSize == size)
+            return;
+
+        size = newSize;
+        updateFeedbackGains();
+    }
+
+    //seconds to fall by 60 dB, at low frequencies
+    void setDecay(float newDecaySeconds)
+    {
+        jassert(newDecaySeconds > 0.f);
+        if (newDecaySeconds == decaySeconds)
+            return;
+
+        decaySeconds = newDecaySeconds;
+        updateFeedbackGains();
+    }
+
+    //0 to 1: how much faster the highs die away than the lows
+    void setDamping(float newDamping)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newDamping, 1.f));
+        damping = newDamping * maxDamping;
+    }
+
+    //'value' is the modulator's output, -1 to 1, for the end of the next block; 'depth' 0 to 1 scales it to maxModulationMs
+    void setModulation(float value, float depth)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(depth, 1.f));
+        modulation = juce::jlimit(-1.f, 1.f, value) * depth;
+    }
+
+    void setMix(float newMix)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newMix, 1.f));
+        mix.setTargetValue(newMix);
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == 1);
+
+        if (context.isBypassed)
+        {
+            wasBypassed = true;
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        //the lines hold whatever was in them when the stage was switched off
+        if (wasBypassed)
+            reset();
+
+        if (numSamples == 0)
+            return;
+
+        const auto* in = inputBlock.getChannelPointer(0);
+        auto* out = outputBlock.getChannelPointer(0);
+        const auto mask = lineSize - 1;
+
+        alignas(32) Lanes steps;
+        const auto targets = getTargetDelays();
+        for (size_t line = 0; line < numLines; ++line)
+            steps[line] = (targets[line] - delays[line]) / static_cast<float>(numSamples);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            for (size_t line = 0; line < numLines; ++line)
+                delays[line] += steps[line];
+
+            //the only step that isn't lane by lane: every line reads from a different frame
+            alignas(32) Lanes y;
+            for (size_t line = 0; line < numLines; ++line)
+            {
+                const auto whole = static_cast<size_t>(delays[line]);
+                const auto frac = delays[line] - static_cast<float>(whole);
+                const auto newer = buffer[((writePosition - whole) & mask) * numLines + line];
+                const auto older = buffer[((writePosition - whole - 1) & mask) * numLines + line];
+                y[line] = newer + frac * (older - newer);
+            }
+
+            for (size_t line = 0; line < numLines; ++line)
+                lowpass[line] = y[line] + damping * (lowpass[line] - y[line]);
+
+            auto wet = 0.f;
+            for (size_t line = 0; line < numLines; ++line)
+                wet += outputGains[line] * lowpass[line];
+
+            alignas(32) Lanes mixed = lowpass;
+            hadamard(mixed);
+
+            const auto x = in[i];
+            const auto input = static_cast<float>(x);
+            auto* frame = buffer + writePosition * numLines;
+            for (size_t line = 0; line < numLines; ++line)
+                frame[line] = mixed[line] * feedbackGains[line] + input * inputGains[line];
+            writePosition = (writePosition + 1) & mask;
+
+            const auto wetAmount = static_cast<SampleType>(mix.getNextValue());
+            out[i] = x * (1 - wetAmount) + static_cast<SampleType>(wet) * wetAmount;
+        }
+    }
+
+private:
+    using Lanes = std::array<float, numLines>;
+
+    //keeps the loop gain below 1 at the top of the spectrum, whatever the damping
+    static constexpr float maxDamping = 0.9f;
+    //each line moves with the modulation by its own amount, half of them the other way, so the pitch wobble averages out
+    static constexpr Lanes modulationWeights { 1.f, -0.9f, 0.8f, -0.7f, 0.65f, -0.75f, 0.85f, -0.95f };
+    static constexpr Lanes inputGains { 0.35355339f, -0.35355339f, 0.35355339f, -0.35355339f, 0.35355339f, -0.35355339f, 0.35355339f, -0.35355339f };
+
+    /*
+     the unnormalised 8x8 Hadamard matrix, in place: in pass h every lane meets the one h lanes away, the lower of the
+     two becoming their sum and the upper their difference.  each pass is a lane swap and an add, for all lanes at once.
+     its 1 / sqrt(8) is folded into the feedback gains.
+     */
+    static void hadamard(Lanes& v) noexcept
+    {
+        for (size_t h = 1; h < numLines; h *= 2)
+        {
+            alignas(32) Lanes partners;
+            for (size_t line = 0; line < numLines; ++line)
+                partners[line] = v[line ^ h];
+            for (size_t line = 0; line < numLines; ++line)
+                v[line] = partners[line] + ((line & h) != 0 ? -v[line] : v[line]);
+        }
+    }
+
+    Lanes getTargetDelays() const
+    {
+        const auto msToSamples = static_cast<float>(sampleRate / 1000.0);
+        alignas(32) Lanes targets;
+        for (size_t line = 0; line < numLines; ++line)
+            targets[line] = juce::jmax(1.f, (lineLengthsMs[line] * size + modulationWeights[line] * modulation * maxModulationMs) * msToSamples);
+        return targets;
+    }
+
+    //a line of length d loses 60 dB every decaySeconds: 10^(-3 d / decaySeconds) per pass
+    void updateFeedbackGains()
+    {
+        const auto normalisation = 1.f / std::sqrt(static_cast<float>(numLines));
+        for (size_t line = 0; line < numLines; ++line)
+        {
+            const auto lengthSeconds = lineLengthsMs[line] * size * 0.001f;
+            feedbackGains[line] = normalisation * std::pow(10.f, -3.f * lengthSeconds / decaySeconds);
+        }
+    }
+
+    double sampleRate = 44100.0;
+    size_t lineSize = 0, writePosition = 0;
+    float* buffer = nullptr;
+
+    alignas(32) Lanes lowpass {};
+    alignas(32) Lanes delays {};
+    alignas(32) Lanes feedbackGains {};
+    alignas(32) Lanes outputGains { 0.35355339f, -0.35355339f, 0.35355339f, -0.35355339f, 0.35355339f, -0.35355339f, 0.35355339f, -0.35355339f };
+
+    float size = 0.7f, decaySeconds = 2.f, damping = 0.45f, modulation = 0.f;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> mix;
+    bool wasBypassed = false;
+};
@@ -0,0 +1,263 @@
+/*
+  ==============================================================================
+
+    HalfBandResampler.h
+    Streaming polyphase half-band decimation and interpolation by powers of 2.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+#include "SharedTables.h"
+
+/*
+ Runs a stage at 1/2, 1/4 or 1/8 of the host rate:
+    auto low = resampler.decimate(block);
+    stage.process(low);
+    resampler.interpolate(low, block);
+
+ Each factor of 2 is a linear-phase half-band FIR of numTaps taps.  Every other tap of a half-band is zero,
+ so the decimator only computes the low-rate samples, and the interpolator splits into a 24 tap phase and a pure delay.
+
+ Blocks of any length work: a level that has seen half a pair of samples finishes it in the next block.
+ The output is the input delayed by exactly getLatencySamples(factor), with no extra buffering on top of the filters.
+ Channel states, histories and the intermediate rate buffers live in the Arena; the taps are in SharedTables.
+ */
+template<typename SampleType>
+struct HalfBandResampler
+{
+    static constexpr int numTaps = SharedTables::halfBandNumTaps;
+    static constexpr int centreTap = SharedTables::halfBandCentreTap;
+    static constexpr int numPhaseTaps = SharedTables::halfBandNumPhaseTaps;
+    static constexpr int maxLevels = 3;
+
+    //each level delays by numTaps - 1 samples at its own input rate, on the way down and up combined
+    static int getLatencySamples(int factor)
+    {
+        return (numTaps - 1) * (factor - 1);
+    }
+
+    static int getNumLevels(int factor)
+    {
+        jassert(juce::isPowerOfTwo(factor) && factor <= (1 << maxLevels));
+        int levels = 0;
+        while ((1 << levels) < factor)
+            ++levels;
+        return levels;
+    }
+
+    //the most low-rate samples one call to decimate() can produce
+    static size_t getMaxLowRateBlockSize(size_t maxBlockSize, int factor)
+    {
+        return (maxBlockSize >> getNumLevels(factor)) + 2;
+    }
+
+    static size_t getArenaBytes(size_t numChannels, size_t maxBlockSize, int factor)
+    {
+        auto levels = static_cast<size_t>(getNumLevels(factor));
+        size_t bytes = Arena::bytesFor<LevelState>(levels * numChannels)
+                     + Arena::bytesFor<SampleType*>(numChannels);
+
+        for (size_t l = 0; l < levels; ++l)
+        {
+            bytes += numChannels * (Arena::bytesFor<SampleType>(2 * numTaps)        //input history
+                                  + Arena::bytesFor<SampleType>(2 * numPhaseTaps)   //low-rate history
+                                  + Arena::bytesFor<SampleType>((maxBlockSize >> (l + 1)) + 2)); //output of this level
+        }
+
+        return bytes;
+    }
+
+    void prepare(size_t channels, size_t maxBlockSize, int factor, Arena& arena)
+    {
+        numChannels = channels;
+        numLevels = static_cast<size_t>(getNumLevels(factor));
+
+        phaseTaps = SharedTables::get().getHalfBandTaps<SampleType>();
+
+        levels = arena.allocate<LevelState>(numLevels * numChannels);
+        lowChannels = arena.allocate<SampleType*>(numChannels);
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            for (size_t l = 0; l < numLevels; ++l)
+            {
+                auto& level = getLevel(ch, l);
+                level = {};
+                level.inputHistory = arena.allocate<SampleType>(2 * numTaps);
+                level.lowHistory = arena.allocate<SampleType>(2 * numPhaseTaps);
+                level.output = arena.allocate<SampleType>((maxBlockSize >> (l + 1)) + 2);
+            }
+        }
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (levels == nullptr)
+            return;
+
+        for (size_t i = 0; i < numLevels * numChannels; ++i)
+        {
+            auto& level = levels[i];
+            std::fill(level.inputHistory, level.inputHistory + 2 * numTaps, SampleType(0));
+            std::fill(level.lowHistory, level.lowHistory + 2 * numPhaseTaps, SampleType(0));
+            level.inputPosition = 0;
+            level.lowPosition = 0;
+            level.odd = false;
+        }
+    }
+
+    //both must have been prepared for the same channels and factor
+    void copyStateFrom(const HalfBandResampler& other)
+    {
+        jassert(numChannels == other.numChannels && numLevels == other.numLevels);
+        for (size_t i = 0; i < numLevels * numChannels; ++i)
+        {
+            auto& level = levels[i];
+            const auto& source = other.levels[i];
+            std::copy(source.inputHistory, source.inputHistory + 2 * numTaps, level.inputHistory);
+            std::copy(source.lowHistory, source.lowHistory + 2 * numPhaseTaps, level.lowHistory);
+            level.inputPosition = source.inputPosition;
+            level.lowPosition = source.lowPosition;
+            level.odd = source.odd;
+        }
+    }
+
+    bool isActive() const { return numLevels > 0; }
+
+    /*
+     filters the block down by the factor.  the returned block points into the arena and stays valid until the next call.
+     */
+    juce::dsp::AudioBlock<SampleType> decimate(const juce::dsp::AudioBlock<SampleType>& input)
+    {
+        jassert(input.getNumChannels() == numChannels);
+        size_t numLowSamples = 0;
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = input.getChannelPointer(ch);
+            auto count = input.getNumSamples();
+
+            for (size_t l = 0; l < numLevels; ++l)
+            {
+                auto& level = getLevel(ch, l);
+                level.startsOdd = level.odd;
+                level.numInputSamples = count;
+                count = decimateLevel(level, in, count);
+                in = level.output;
+            }
+
+            lowChannels[ch] = getLevel(ch, numLevels - 1).output;
+            numLowSamples = count;
+        }
+
+        return juce::dsp::AudioBlock<SampleType>(lowChannels, numChannels, numLowSamples);
+    }
+
+    /*
+     filters the processed low-rate block back up into 'output', which must be the block passed to decimate().
+     */
+    void interpolate(const juce::dsp::AudioBlock<SampleType>& low, const juce::dsp::AudioBlock<SampleType>& output)
+    {
+        jassert(low.getNumChannels() == numChannels && output.getNumChannels() == numChannels);
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = low.getChannelPointer(ch);
+            for (size_t l = numLevels; l-- > 0;)
+            {
+                auto& level = getLevel(ch, l);
+                //each level writes the rate above it: the previous level's buffer, or the output at the top
+                auto* out = l == 0 ? output.getChannelPointer(ch) : getLevel(ch, l - 1).output;
+                interpolateLevel(level, in, out);
+                in = out;
+            }
+        }
+    }
+
+private:
+    struct LevelState
+    {
+        SampleType* inputHistory = nullptr; //doubled, so the last numTaps inputs are always contiguous
+        SampleType* lowHistory = nullptr;   //doubled, the last numPhaseTaps low-rate samples
+        SampleType* output = nullptr;
+        int inputPosition = 0, lowPosition = 0;
+        bool odd = false, startsOdd = false;
+        size_t numInputSamples = 0;
+    };
+
+    LevelState& getLevel(size_t channel, size_t level) { return levels[channel * numLevels + level]; }
+
+    /*
+     d[m] = sum h[k] x[2m + 1 - k].  with the centre tap at an odd index, the even taps see the odd inputs
+     and the only odd tap is the centre one, which is 0.5.
+     */
+    size_t decimateLevel(LevelState& level, const SampleType* in, size_t numSamples)
+    {
+        size_t numOut = 0;
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            level.inputPosition = (level.inputPosition == 0 ? numTaps : level.inputPosition) - 1;
+            level.inputHistory[level.inputPosition] = in[i];
+            level.inputHistory[level.inputPosition + numTaps] = in[i];
+
+            level.odd = !level.odd;
+            if (level.odd)
+                continue;
+
+            //history[inputPosition + k] is x[n - k]
+            const auto* x = level.inputHistory + level.inputPosition;
+            SampleType sum = SampleType(0.5) * x[centreTap];
+            for (int j = 0; j < numPhaseTaps; ++j)
+                sum += phaseTaps[j] * x[2 * j];
+
+            level.output[numOut++] = sum;
+        }
+
+        return numOut;
+    }
+
+    /*
+     y[2m + 1] = 2 sum h[2j] d[m - j], y[2m] = d[m - (centreTap + 1) / 2].
+     walks the same sequence of odd and even inputs that decimateLevel() saw.
+     */
+    void interpolateLevel(LevelState& level, const SampleType* low, SampleType* out)
+    {
+        constexpr int pureDelay = (centreTap + 1) / 2;
+        static_assert(pureDelay < numPhaseTaps);
+
+        bool odd = level.startsOdd;
+        size_t lowIndex = 0;
+        for (size_t i = 0; i < level.numInputSamples; ++i)
+        {
+            odd = !odd;
+            if (odd)
+            {
+                //history[lowPosition + j] is d[m - 1 - j]
+                out[i] = level.lowHistory[level.lowPosition + pureDelay - 1];
+                continue;
+            }
+
+            level.lowPosition = (level.lowPosition == 0 ? numPhaseTaps : level.lowPosition) - 1;
+            level.lowHistory[level.lowPosition] = low[lowIndex];
+            level.lowHistory[level.lowPosition + numPhaseTaps] = low[lowIndex];
+            ++lowIndex;
+
+            const auto* d = level.lowHistory + level.lowPosition;
+            SampleType sum = 0;
+            for (int j = 0; j < numPhaseTaps; ++j)
+                sum += phaseTaps[j] * d[j];
+
+            out[i] = SampleType(2) * sum;
+        }
+    }
+
+    size_t numChannels = 0, numLevels = 0;
+    LevelState* levels = nullptr;
+    SampleType** lowChannels = nullptr;
+    const SampleType* phaseTaps = nullptr;
+};
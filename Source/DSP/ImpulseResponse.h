@@ -0,0 +1,364 @@
+/*
+  ==============================================================================
+
+    ImpulseResponse.h
+    Impulse responses split into the partitions PartitionedConvolver works with, and the process-wide cache that loads them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ The response is split non-uniformly, so the head costs no latency and the long tail costs little CPU:
+    [0, headSize)                       the head, convolved directly, sample by sample
+    [headSize, tailStart)               the mid partitions, of headSize, by FFT every headSize samples
+    [tailStart, length)                 partitions of tailPartitionSize, by FFT on the ConvolutionScheduler's threads
+
+ The tail starts (1 + tailLead) of its partitions in, so a tail job has tailLead partitions of time to run.
+ That has to cover a whole host block, since the audio thread may process one in a burst, see getTailLead();
+ the response is split for one lead, and only a convolver prepared for the same block size can use it.
+
+ Every partition's spectrum is computed once, here, off the audio thread.  Spectra are stored as the
+ getSize() / 2 + 1 interleaved (re, im) bins juce::dsp::FFT's real-only transforms work with.
+ The object never changes after it is created, so any number of convolvers and threads can read it at once.
+ Each of them brings its own juce::dsp::FFT: the fallback engine locks around every transform.
+ */
+struct ImpulseResponse : juce::ReferenceCountedObject
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<ImpulseResponse>;
+
+    static constexpr int headSize = 64;
+    static constexpr int tailPartitionSize = 1024;
+    static constexpr int midSpectrumSize = 2 * (headSize + 1);
+    static constexpr int tailSpectrumSize = 2 * (tailPartitionSize + 1);
+    //overlap-save transforms twice the partition size
+    static constexpr int midFFTOrder = 7;
+    static constexpr int tailFFTOrder = 11;
+    static_assert((1 << midFFTOrder) == 2 * headSize && (1 << tailFFTOrder) == 2 * tailPartitionSize);
+    //about 5.5 s at 48 kHz: cabinets and short rooms, not cathedrals
+    static constexpr int maxLengthSamples = 1 << 18;
+
+    //tail partitions between posting a tail job and collecting it, for hosts that call with up to 'maximumBlockSize' samples
+    static constexpr int getTailLead(int maximumBlockSize)
+    {
+        return (juce::jmax(tailPartitionSize, maximumBlockSize) + tailPartitionSize - 1) / tailPartitionSize;
+    }
+
+    static constexpr int getTailStart(int tailLead) { return tailPartitionSize * (1 + tailLead); }
+    static constexpr int getNumMidPartitions(int tailLead) { return getTailStart(tailLead) / headSize - 1; }
+
+    //'samples' must already be at 'sampleRate', the rate it will be convolved at.  at most two channels are used.
+    static Ptr create(const juce::AudioBuffer<float>& samples, double sampleRate, int tailLead)
+    {
+        return new ImpulseResponse(samples, sampleRate, tailLead);
+    }
+
+    int getNumChannels() const { return numChannels; }
+    int getLengthSamples() const { return lengthSamples; }
+    double getSampleRate() const { return sampleRate; }
+    double getLengthSeconds() const { return lengthSamples / sampleRate; }
+    int getTailLead() const { return tailLead; }
+    int getNumMidPartitions() const { return numMidPartitions; }
+    int getNumTailPartitions() const { return numTailPartitions; }
+
+    const float* getHead(int channel) const
+    {
+        return head.data() + static_cast<size_t>(channel) * headSize;
+    }
+
+    //partition k covers [headSize (k + 1), headSize (k + 2))
+    const float* getMidSpectrum(int channel, int k) const
+    {
+        return midSpectra.data() + getMidIndex(channel, k);
+    }
+
+    //partition k covers [tailStart + tailPartitionSize k, tailStart + tailPartitionSize (k + 1))
+    const float* getTailSpectrum(int channel, int k) const
+    {
+        return tailSpectra.data() + getTailIndex(channel, k);
+    }
+
+    //sum += x * h, bin by bin, for spectra in the layout above
+    static void multiplyAdd(const float* x, const float* h, float* sum, int numBins)
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto xr = x[2 * bin], xi = x[2 * bin + 1];
+            const auto hr = h[2 * bin], hi = h[2 * bin + 1];
+            sum[2 * bin] += xr * hr - xi * hi;
+            sum[2 * bin + 1] += xr * hi + xi * hr;
+        }
+    }
+
+    size_t getSizeInBytes() const
+    {
+        return sizeof(*this) + (head.size() + midSpectra.size() + tailSpectra.size()) * sizeof(float);
+    }
+
+private:
+    ImpulseResponse(const juce::AudioBuffer<float>& samples, double rate, int lead)
+        : numChannels(juce::jlimit(1, 2, samples.getNumChannels())),
+          lengthSamples(juce::jmin(samples.getNumSamples(), maxLengthSamples)),
+          sampleRate(rate),
+          tailLead(lead),
+          numMidPartitions(getNumMidPartitions(lead)),
+          numTailPartitions(juce::jmax(0, (lengthSamples - getTailStart(lead) + tailPartitionSize - 1) / tailPartitionSize))
+    {
+        jassert(sampleRate > 0 && samples.getNumChannels() > 0 && tailLead > 0);
+
+        head.assign(static_cast<size_t>(numChannels) * headSize, 0.f);
+        midSpectra.assign(static_cast<size_t>(numChannels * numMidPartitions) * midSpectrumSize, 0.f);
+        tailSpectra.assign(static_cast<size_t>(numChannels * numTailPartitions) * tailSpectrumSize, 0.f);
+
+        juce::dsp::FFT midFFT(midFFTOrder), tailFFT(tailFFTOrder);
+        std::vector<float> scratch(4 * tailPartitionSize);
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* h = samples.getReadPointer(ch);
+            std::copy_n(h, juce::jmin(headSize, lengthSamples), head.data() + static_cast<size_t>(ch) * headSize);
+
+            for (int k = 0; k < numMidPartitions; ++k)
+                transformPartition(h, headSize * (k + 1), headSize, midFFT, scratch.data(), midSpectra.data() + getMidIndex(ch, k));
+
+            for (int k = 0; k < numTailPartitions; ++k)
+                transformPartition(h, getTailStart(tailLead) + tailPartitionSize * k, tailPartitionSize, tailFFT, scratch.data(), tailSpectra.data() + getTailIndex(ch, k));
+        }
+    }
+
+    size_t getMidIndex(int channel, int k) const
+    {
+        return (static_cast<size_t>(channel) * static_cast<size_t>(numMidPartitions) + static_cast<size_t>(k)) * midSpectrumSize;
+    }
+
+    size_t getTailIndex(int channel, int k) const
+    {
+        return (static_cast<size_t>(channel) * static_cast<size_t>(numTailPartitions) + static_cast<size_t>(k)) * tailSpectrumSize;
+    }
+
+    //the partition, zero-padded to twice its size for overlap-save
+    void transformPartition(const float* h, int start, int size, const juce::dsp::FFT& fft, float* scratch, float* spectrum) const
+    {
+        std::fill(scratch, scratch + 4 * size, 0.f);
+        if (start < lengthSamples)
+            std::copy_n(h + start, juce::jmin(size, lengthSamples - start), scratch);
+
+        fft.performRealOnlyForwardTransform(scratch, true);
+        std::copy_n(scratch, 2 * (size + 1), spectrum);
+    }
+
+    int numChannels = 1;
+    int lengthSamples = 0;
+    double sampleRate = 44100.0;
+    int tailLead = 1, numMidPartitions = 0, numTailPartitions = 0;
+
+    std::vector<float> head, midSpectra, tailSpectra;
+};
+
+/*
+ Loads impulse responses from disk, once per file, sample rate and tail lead for the whole process,
+ so every instance that uses the same IR shares one copy of its spectra.
+
+ WAV and AIFF files are read through a memory-mapped reader: the samples are converted straight out of the mapping,
+ and nothing but the finished spectra stays in memory.  Other formats go through a normal reader.
+ The file is resampled to the processing rate with a windowed sinc, band-limited to the lower of the two rates.
+
+ load() reads and transforms on the calling thread, so call it from a background thread.
+ Entries no instance holds any more are dropped the next time anything is loaded.
+ */
+struct ImpulseResponseLibrary
+{
+    static ImpulseResponseLibrary& get()
+    {
+        static ImpulseResponseLibrary library;
+        return library;
+    }
+
+    //returns nullptr, with a reason in 'error', if the file can't be read
+    ImpulseResponse::Ptr load(const juce::File& file, double sampleRate, int tailLead, juce::String& error)
+    {
+        Entry key { file.getFullPathName(), file.getLastModificationTime(), sampleRate, tailLead, nullptr };
+
+        {
+            const juce::ScopedLock sl(lock);
+            entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                         [](const Entry& e) { return e.impulseResponse->getReferenceCount() == 1; }),
+                          entries.end());
+
+            if (auto* entry = find(key))
+                return entry->impulseResponse;
+        }
+
+        //read outside the lock, so instances loading different files don't wait on each other
+        auto impulseResponse = read(file, sampleRate, tailLead, error);
+        if (impulseResponse == nullptr)
+            return nullptr;
+
+        const juce::ScopedLock sl(lock);
+        //another instance may have loaded the same file meanwhile; keep one copy
+        if (auto* entry = find(key))
+            return entry->impulseResponse;
+
+        key.impulseResponse = impulseResponse;
+        entries.push_back(key);
+        return impulseResponse;
+    }
+
+private:
+    ImpulseResponseLibrary() = default;
+
+    struct Entry
+    {
+        juce::String path;
+        juce::Time modificationTime;
+        double sampleRate = 0.0;
+        int tailLead = 0;
+        ImpulseResponse::Ptr impulseResponse;
+    };
+
+    Entry* find(const Entry& key)
+    {
+        for (auto& entry : entries)
+        {
+            if (entry.path == key.path && entry.modificationTime == key.modificationTime && entry.sampleRate == key.sampleRate
+                && entry.tailLead == key.tailLead)
+                return &entry;
+        }
+
+        return nullptr;
+    }
+
+    static ImpulseResponse::Ptr read(const juce::File& file, double sampleRate, int tailLead, juce::String& error)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        if (auto* format = formats.findFormatForFileExtension(file.getFileExtension()))
+        {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+            if (mapped != nullptr && mapped->mapEntireFile())
+                reader = std::move(mapped);
+        }
+
+        if (reader == nullptr)
+            reader.reset(formats.createReaderFor(file));
+
+        if (reader == nullptr || reader->sampleRate <= 0 || reader->lengthInSamples <= 0)
+        {
+            error = "can't read " + file.getFileName();
+            return nullptr;
+        }
+
+        //only as much of the file as fits in maxLengthSamples once resampled
+        const auto numChannels = static_cast<int>(juce::jmin(2u, reader->numChannels));
+        const auto maxSourceLength = static_cast<juce::int64>(std::ceil(ImpulseResponse::maxLengthSamples * reader->sampleRate / sampleRate));
+        const auto length = static_cast<int>(juce::jmin(reader->lengthInSamples, maxSourceLength));
+
+        juce::AudioBuffer<float> source(numChannels, length);
+        reader->read(&source, 0, length, 0, true, numChannels > 1);
+
+        return ImpulseResponse::create(resample(source, reader->sampleRate, sampleRate), sampleRate, tailLead);
+    }
+
+    /*
+     Hann-windowed sinc, 32 zero crossings either side at the output's cutoff.
+     the result is scaled by the rate ratio as well, since a sampled response's gain grows with the rate it is sampled at.
+     */
+    static juce::AudioBuffer<float> resample(const juce::AudioBuffer<float>& source, double sourceRate, double targetRate)
+    {
+        if (std::abs(sourceRate - targetRate) < 0.5)
+            return source;
+
+        const auto ratio = sourceRate / targetRate;
+        const auto cutoff = juce::jmin(1.0, 1.0 / ratio);
+        const auto halfWidth = 32.0 / cutoff;
+        const auto sourceLength = source.getNumSamples();
+        const auto length = juce::jmin(ImpulseResponse::maxLengthSamples, static_cast<int>(std::ceil(sourceLength / ratio)));
+
+        juce::AudioBuffer<float> result(source.getNumChannels(), length);
+        for (int ch = 0; ch < source.getNumChannels(); ++ch)
+        {
+            const auto* in = source.getReadPointer(ch);
+            auto* out = result.getWritePointer(ch);
+
+            for (int n = 0; n < length; ++n)
+            {
+                const auto centre = n * ratio;
+                const auto first = juce::jmax(0, static_cast<int>(std::ceil(centre - halfWidth)));
+                const auto last = juce::jmin(sourceLength - 1, static_cast<int>(std::floor(centre + halfWidth)));
+
+                double sum = 0;
+                for (int k = first; k <= last; ++k)
+                {
+                    const auto t = k - centre;
+                    const auto x = juce::MathConstants<double>::pi * t * cutoff;
+                    const auto sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(x) / x;
+                    const auto window = 0.5 + 0.5 * std::cos(juce::MathConstants<double>::pi * t / halfWidth);
+                    sum += in[k] * sinc * window;
+                }
+
+                out[n] = static_cast<float>(sum * cutoff * ratio);
+            }
+        }
+
+        return result;
+    }
+
+    juce::CriticalSection lock;
+    std::vector<Entry> entries;
+};
+
+/*
+ The one background thread every instance loads its impulse responses on.  Instances hold it through a
+ juce::SharedResourcePointer, so it exists while any of them does, and not before or after.
+ Jobs are tagged with the instance that added them, so an instance going away only removes its own.
+ */
+struct ImpulseResponseLoader
+{
+    void addJob(const void* owner, std::function<void()> function)
+    {
+        pool.addJob(new Job(owner, std::move(function)), true);
+    }
+
+    //removes 'owner''s jobs that haven't started, and waits for the one that is running
+    bool removeJobs(const void* owner, int timeoutMs)
+    {
+        OwnerSelector selector(owner);
+        return pool.removeAllJobs(true, timeoutMs, &selector);
+    }
+
+private:
+    struct Job : juce::ThreadPoolJob
+    {
+        Job(const void* jobOwner, std::function<void()> jobFunction)
+            : juce::ThreadPoolJob("Project13 impulse response"), owner(jobOwner), function(std::move(jobFunction))
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            function();
+            return jobHasFinished;
+        }
+
+        const void* owner;
+        std::function<void()> function;
+    };
+
+    struct OwnerSelector : juce::ThreadPool::JobSelector
+    {
+        explicit OwnerSelector(const void* jobOwner) : owner(jobOwner) {}
+
+        bool isJobSuitable(juce::ThreadPoolJob* job) override
+        {
+            return static_cast<Job*>(job)->owner == owner;
+        }
+
+        const void* owner;
+    };
+
+    juce::ThreadPool pool { 1 };
+};
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    LatencyCompensatedMix.h
+    Global wet/dry blend whose dry path is delayed by the plugin's latency.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ The dry input is written into a circular buffer as each sub-block comes in, and read back
+ 'latency' samples later, when the matching wet samples come out of the chain.
+ The latency can change while running, up to the most prepare() was given, for a chain that gains a stage with latency.
+ Both passes also return the sum of squares of what they touched, so the pre and post meters
+ come out of the same loops instead of separate passes over the buffer.
+ */
+template<typename SampleType>
+struct LatencyCompensatedMix
+{
+    //message thread, while the audio thread isn't running.  the only place that allocates.  the latency starts at the maximum
+    void prepare(int numChannels, int maxSubBlockSize, int maxLatencySamples)
+    {
+        jassert(maxLatencySamples >= 0);
+        maxLatency = maxLatencySamples;
+        latency = maxLatencySamples;
+
+        auto capacity = juce::nextPowerOfTwo(maxSubBlockSize + maxLatency);
+        mask = capacity - 1;
+        dry.setSize(numChannels, capacity);
+        reset();
+    }
+
+    void reset()
+    {
+        dry.clear();
+        writePosition = 0;
+    }
+
+    int getLatency() const { return latency; }
+
+    //audio thread
+    void setLatency(int latencySamples)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(latencySamples, maxLatency));
+        latency = juce::jlimit(0, maxLatency, latencySamples);
+    }
+
+    /*
+     stores the dry input of a sub-block.  adds each channel's sum of squares to 'sumsOfSquares'.
+     */
+    void pushDry(const juce::dsp::AudioBlock<SampleType>& block, double* sumsOfSquares)
+    {
+        const auto numSamples = static_cast<int>(block.getNumSamples());
+        jassert(numSamples <= mask + 1 - maxLatency);
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            const auto* in = block.getChannelPointer(ch);
+            auto* delay = dry.getWritePointer(static_cast<int>(ch));
+            SampleType sum = 0;
+
+            forEachSegment(writePosition, numSamples, [&](int offset, int position, int length)
+            {
+                for (int i = 0; i < length; ++i)
+                {
+                    auto x = in[offset + i];
+                    delay[position + i] = x;
+                    sum += x * x;
+                }
+            });
+
+            sumsOfSquares[ch] += static_cast<double>(sum);
+        }
+
+        writePosition = (writePosition + numSamples) & mask;
+    }
+
+    /*
+     blends the delayed dry signal into the processed sub-block, in place.
+     the wet amount ramps linearly from 'startMix' to 'endMix' across the sub-block (0 = dry, 1 = wet).
+     adds each channel's output sum of squares to 'sumsOfSquares'.
+     */
+    void mix(juce::dsp::AudioBlock<SampleType>& block, float startMix, float endMix, double* sumsOfSquares)
+    {
+        const auto numSamples = static_cast<int>(block.getNumSamples());
+        const auto readPosition = (writePosition - numSamples - latency) & mask;
+        const auto start = static_cast<SampleType>(startMix);
+        const auto step = static_cast<SampleType>(endMix - startMix) / static_cast<SampleType>(numSamples);
+        const bool fullyWet = startMix >= 1.f && endMix >= 1.f;
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto* out = block.getChannelPointer(ch);
+            const auto* delay = dry.getReadPointer(static_cast<int>(ch));
+            SampleType sum = 0;
+
+            if (fullyWet)
+            {
+                //the usual setting: nothing to blend, only the meter
+                for (int i = 0; i < numSamples; ++i)
+                    sum += out[i] * out[i];
+            }
+            else
+            {
+                forEachSegment(readPosition, numSamples, [&](int offset, int position, int length)
+                {
+                    for (int i = 0; i < length; ++i)
+                    {
+                        auto wet = start + step * static_cast<SampleType>(offset + i + 1);
+                        auto d = delay[position + i];
+                        auto y = d + wet * (out[offset + i] - d);
+                        out[offset + i] = y;
+                        sum += y * y;
+                    }
+                });
+            }
+
+            sumsOfSquares[ch] += static_cast<double>(sum);
+        }
+    }
+
+private:
+    //splits a run of the circular buffer into at most two contiguous pieces, so the inner loops have no wrap-around
+    template<typename Callback>
+    void forEachSegment(int position, int numSamples, Callback&& callback) const
+    {
+        auto first = juce::jmin(numSamples, mask + 1 - position);
+        callback(0, position, first);
+        if (first < numSamples)
+            callback(first, 0, numSamples - first);
+    }
+
+    juce::AudioBuffer<SampleType> dry;
+    int latency = 0, maxLatency = 0;
+    int mask = 0;
+    int writePosition = 0;
+};
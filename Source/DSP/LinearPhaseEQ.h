@@ -0,0 +1,323 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEQ.h
+    Linear-phase equalisation by FFT overlap-save, with kernels designed off the audio thread and crossfaded in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+
+/*
+ A linear-phase FIR, as the spectrum LinearPhaseEQ multiplies with.
+
+ design() samples the wanted magnitude on every bin of the FFT, with zero phase, and transforms that to an impulse
+ centred on sample 0.  The middle getLength() taps of it are shifted to the centre of the filter, Hann windowed, and
+ transformed back.  Every frequency is then delayed by the same getLength() / 2 samples, and the magnitude is the one
+ asked for, smoothed by the window: a longer FFT resolves lower frequencies.
+
+ Spectra are the getFFTSize() / 2 + 1 interleaved (re, im) bins juce::dsp::FFT's real-only transforms work with.
+ The kernel is plain data, so it goes through a TripleBuffer; design() allocates, so it belongs on a background thread.
+ */
+struct LinearPhaseKernel
+{
+    static constexpr int minFFTOrder = 10;
+    static constexpr int maxFFTOrder = 13;
+    static constexpr int maxSpectrumSize = (1 << maxFFTOrder) + 2;
+
+    static int getFFTSize(int order) { return 1 << order; }
+    static int getSpectrumSize(int order) { return getFFTSize(order) + 2; }
+    //the number of taps, which is also the hop between overlap-save frames
+    static int getLength(int order) { return getFFTSize(order) / 2; }
+
+    //'magnitudeAt' returns the gain wanted at a frequency in Hz, from 0 to sampleRate / 2
+    template<typename MagnitudeFunction>
+    static LinearPhaseKernel design(int order, double sampleRate, MagnitudeFunction&& magnitudeAt)
+    {
+        jassert(order >= minFFTOrder && order <= maxFFTOrder);
+
+        const auto size = getFFTSize(order);
+        const auto length = getLength(order);
+        juce::dsp::FFT fft(order);
+        std::vector<float> response(2 * static_cast<size_t>(size), 0.f), taps(2 * static_cast<size_t>(size), 0.f);
+
+        for (int bin = 0; bin <= size / 2; ++bin)
+            response[static_cast<size_t>(2 * bin)] = static_cast<float>(magnitudeAt(bin * sampleRate / size));
+
+        fft.performRealOnlyInverseTransform(response.data());
+
+        //tap n is the impulse at n - length / 2, which wraps around to the end of the inverse transform for n < length / 2
+        for (int n = 0; n < length; ++n)
+        {
+            const auto window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * n / length);
+            taps[static_cast<size_t>(n)] = static_cast<float>(response[static_cast<size_t>((n - length / 2 + size) % size)] * window);
+        }
+
+        fft.performRealOnlyForwardTransform(taps.data(), true);
+
+        LinearPhaseKernel kernel;
+        kernel.fftOrder = order;
+        std::copy_n(taps.data(), getSpectrumSize(order), kernel.spectrum.data());
+        return kernel;
+    }
+
+    //a kernel that only delays, which is what a LinearPhaseEQ starts with
+    static LinearPhaseKernel makeDelay(int order)
+    {
+        return design(order, 1.0, [](double) { return 1.0; });
+    }
+
+    int fftOrder = 0;
+    std::array<float, maxSpectrumSize> spectrum {};
+};
+
+/*
+ One channel of linear-phase EQ.
+
+ Input is gathered in frames of getLength() samples.  When a frame is complete, it and the one before it are
+ transformed, multiplied with the kernel and transformed back, and the last half of that is the frame's output,
+ played while the next frame is gathered.  So the delay is one frame plus the kernel's half frame, see getLatencySamples().
+ The FFT size is fixed by prepare(), since it sets the latency the host was told about.
+
+ setKernel() only copies a new kernel in; the next frame takes it up.  That frame is convolved with the old kernel
+ and the new one, and its output crossfades from one to the other, so moving a band never clicks.
+ It costs one more multiply and inverse transform, once per frame, and only while the kernel is changing.
+
+ While bypassed, the input is still gathered, but frames aren't transformed; the one before the window is kept instead.
+ The first block after the bypass transforms the last complete frames once, so the EQ comes back with the output
+ it would have had, delayed by the same latency the processor compensated for while it was bypassed.
+ */
+template<typename SampleType>
+struct LinearPhaseEQ
+{
+    static_assert(std::is_same_v<SampleType, float>, "juce::dsp::FFT is float only");
+    static constexpr bool processesWhileBypassed = true;
+
+    static int getLatencySamples(int fftOrder)
+    {
+        return 3 * LinearPhaseKernel::getLength(fftOrder) / 2;
+    }
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec, int fftOrder)
+    {
+        juce::ignoreUnused(spec);
+
+        const auto size = static_cast<size_t>(LinearPhaseKernel::getFFTSize(fftOrder));
+        const auto spectrumSize = static_cast<size_t>(LinearPhaseKernel::getSpectrumSize(fftOrder));
+        return Arena::bytesFor<float>(size)                 //window
+             + Arena::bytesFor<float>(2 * size)             //transform
+             + Arena::bytesFor<float>(spectrumSize)         //input spectrum
+             + 2 * Arena::bytesFor<float>(spectrumSize)     //kernel, pending kernel
+             + 2 * Arena::bytesFor<float>(size / 2);        //output, skipped frame
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena, int newFFTOrder)
+    {
+        jassert(spec.numChannels == 1);
+        juce::ignoreUnused(spec);
+
+        fftOrder = newFFTOrder;
+        size = LinearPhaseKernel::getFFTSize(fftOrder);
+        length = LinearPhaseKernel::getLength(fftOrder);
+        spectrumSize = LinearPhaseKernel::getSpectrumSize(fftOrder);
+        fft = std::make_unique<juce::dsp::FFT>(fftOrder);
+
+        window = arena.allocate<float>(static_cast<size_t>(size));
+        transform = arena.allocate<float>(2 * static_cast<size_t>(size));
+        inputSpectrum = arena.allocate<float>(static_cast<size_t>(spectrumSize));
+        kernel = arena.allocate<float>(static_cast<size_t>(spectrumSize));
+        pendingKernel = arena.allocate<float>(static_cast<size_t>(spectrumSize));
+        output = arena.allocate<float>(static_cast<size_t>(length));
+        skippedFrame = arena.allocate<float>(static_cast<size_t>(length));
+
+        //passes the input through, delayed, until the first kernel arrives
+        const auto delay = LinearPhaseKernel::makeDelay(fftOrder);
+        std::copy_n(delay.spectrum.data(), spectrumSize, kernel);
+        hasPendingKernel = false;
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (window == nullptr)
+            return;
+
+        std::fill(window, window + size, 0.f);
+        std::fill(output, output + length, 0.f);
+        std::fill(skippedFrame, skippedFrame + length, 0.f);
+        position = 0;
+        skippedFrames = false;
+    }
+
+    //'other' must have been prepared with the same FFT size
+    void copyStateFrom(const LinearPhaseEQ& other)
+    {
+        jassert(window != nullptr && other.window != nullptr && fftOrder == other.fftOrder);
+
+        std::copy_n(other.window, size, window);
+        std::copy_n(other.output, length, output);
+        std::copy_n(other.skippedFrame, length, skippedFrame);
+        std::copy_n(other.kernel, spectrumSize, kernel);
+        std::copy_n(other.pendingKernel, spectrumSize, pendingKernel);
+        hasPendingKernel = other.hasPendingKernel;
+        position = other.position;
+        skippedFrames = other.skippedFrames;
+    }
+
+    //audio thread.  a kernel designed for another FFT size, e.g. requested before the last prepare(), is ignored
+    void setKernel(const LinearPhaseKernel& newKernel)
+    {
+        if (newKernel.fftOrder != fftOrder || window == nullptr)
+            return;
+
+        std::copy_n(newKernel.spectrum.data(), spectrumSize, pendingKernel);
+        hasPendingKernel = true;
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = static_cast<int>(outputBlock.getNumSamples());
+
+        jassert(inputBlock.getNumChannels() == 1);
+
+        const auto* in = inputBlock.getChannelPointer(0);
+        auto* out = outputBlock.getChannelPointer(0);
+
+        if (context.isBypassed)
+        {
+            if (window != nullptr)
+                gatherBypassed(in, numSamples);
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        if (skippedFrames)
+            catchUp();
+
+        for (int i = 0; i < numSamples;)
+        {
+            const auto count = juce::jmin(numSamples - i, length - position);
+
+            std::copy_n(in + i, count, window + length + position);
+            std::copy_n(output + position, count, out + i);
+
+            i += count;
+            position += count;
+            if (position == length)
+            {
+                position = 0;
+                processFrame();
+            }
+        }
+    }
+
+private:
+    //keeps the window filled, so the EQ can pick up where the input is when the bypass ends
+    void gatherBypassed(const float* in, int numSamples)
+    {
+        for (int i = 0; i < numSamples;)
+        {
+            const auto count = juce::jmin(numSamples - i, length - position);
+            std::copy_n(in + i, count, window + length + position);
+
+            i += count;
+            position += count;
+            if (position == length)
+            {
+                position = 0;
+                std::copy_n(window, length, skippedFrame);
+                std::copy_n(window + length, length, window);
+                skippedFrames = true;
+            }
+        }
+    }
+
+    //the output of the last frame that was skipped, which is the one playing now, see processFrame()
+    void catchUp()
+    {
+        skippedFrames = false;
+        if (hasPendingKernel)
+        {
+            std::swap(kernel, pendingKernel);
+            hasPendingKernel = false;
+        }
+
+        std::copy_n(skippedFrame, length, transform);
+        std::copy_n(window, length, transform + length);
+        std::fill(transform + size, transform + 2 * size, 0.f);
+        fft->performRealOnlyForwardTransform(transform, true);
+        std::copy_n(transform, spectrumSize, inputSpectrum);
+
+        convolve(kernel);
+        std::copy_n(transform + length, length, output);
+    }
+
+    void processFrame()
+    {
+        std::copy_n(window, size, transform);
+        std::fill(transform + size, transform + 2 * size, 0.f);
+        fft->performRealOnlyForwardTransform(transform, true);
+        std::copy_n(transform, spectrumSize, inputSpectrum);
+        std::copy_n(window + length, length, window);
+
+        if (!hasPendingKernel)
+        {
+            convolve(kernel);
+            std::copy_n(transform + length, length, output);
+            return;
+        }
+
+        //the old kernel ends up in the pending slot, which is free again once this frame is done
+        std::swap(kernel, pendingKernel);
+        hasPendingKernel = false;
+
+        convolve(pendingKernel);
+        std::copy_n(transform + length, length, output);
+
+        convolve(kernel);
+        const auto* faded = transform + length;
+        const auto step = 1.f / static_cast<float>(length);
+        for (int n = 0; n < length; ++n)
+            output[n] += static_cast<float>(n + 1) * step * (faded[n] - output[n]);
+    }
+
+    //overlap-save: the last half of the circular convolution of the two frames is the linear one of the newer frame
+    void convolve(const float* h)
+    {
+        for (int bin = 0; bin < spectrumSize / 2; ++bin)
+        {
+            const auto xr = inputSpectrum[2 * bin], xi = inputSpectrum[2 * bin + 1];
+            const auto hr = h[2 * bin], hi = h[2 * bin + 1];
+            transform[2 * bin] = xr * hr - xi * hi;
+            transform[2 * bin + 1] = xr * hi + xi * hr;
+        }
+
+        std::fill(transform + spectrumSize, transform + 2 * size, 0.f);
+        fft->performRealOnlyInverseTransform(transform);
+    }
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int fftOrder = 0, size = 0, length = 0, spectrumSize = 0;
+
+    float* window = nullptr;
+    float* transform = nullptr;
+    float* inputSpectrum = nullptr;
+    float* kernel = nullptr;
+    float* pendingKernel = nullptr;
+    float* output = nullptr;
+    float* skippedFrame = nullptr;
+
+    int position = 0;
+    bool hasPendingKernel = false;
+    bool skippedFrames = false;
+};
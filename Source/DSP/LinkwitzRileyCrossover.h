@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    LinkwitzRileyCrossover.h
+    Splits a channel into up to four Linkwitz-Riley bands that sum back to an allpass, all bands at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Biquad.h"
+
+/*
+ Every band is the input through one slot per crossover, each slot two biquads.  For crossover k and band b:
+    b == k      the 24 dB/oct Linkwitz-Riley low-pass, a Butterworth low-pass twice
+    b > k       the Linkwitz-Riley high-pass
+    b < k       the allpass the low-pass and high-pass of crossover k add up to, and a section that passes through
+ so band b below crossover k has the same phase as the bands above it, and all bands together are
+ the product of the crossovers' allpasses: flat, with no dip or bump at any crossover.
+
+ trivially copyable, so it can travel through a TripleBuffer.
+ */
+struct LinkwitzRileyCoefficients
+{
+    static constexpr size_t maxNumBands = 4;
+    static constexpr size_t maxNumCrossovers = maxNumBands - 1;
+    static constexpr size_t maxSections = 2 * maxNumCrossovers;
+
+    std::array<std::array<BiquadCoefficients, maxNumBands>, maxSections> sections {};
+    size_t numBands = 1;
+
+    /*
+     'frequencies' are the crossover points, lowest first; only the first numBands - 1 are used,
+     and one below the point before it is moved up to it.  the juce::dsp design functions allocate, so call this off the audio thread.
+     */
+    static LinkwitzRileyCoefficients design(size_t numBands, const std::array<float, maxNumCrossovers>& frequencies, double sampleRate)
+    {
+        using Coefficients = juce::dsp::IIR::Coefficients<double>;
+
+        LinkwitzRileyCoefficients c;
+        if (sampleRate <= 0.0)
+            return c;
+
+        c.numBands = juce::jlimit<size_t>(1, maxNumBands, numBands);
+        const auto butterworthQuality = 1.0 / juce::MathConstants<double>::sqrt2;
+        auto previous = 20.0;
+
+        for (size_t k = 0; k + 1 < c.numBands; ++k)
+        {
+            //the design functions need the frequency below nyquist
+            const auto freq = juce::jlimit(previous, sampleRate * 0.45, static_cast<double>(frequencies[k]));
+            previous = freq;
+
+            const auto lowPass = BiquadCoefficients::fromJuce(*Coefficients::makeLowPass(sampleRate, freq, butterworthQuality));
+            const auto highPass = BiquadCoefficients::fromJuce(*Coefficients::makeHighPass(sampleRate, freq, butterworthQuality));
+            const auto allPass = BiquadCoefficients::fromJuce(*Coefficients::makeAllPass(sampleRate, freq, butterworthQuality));
+
+            for (size_t band = 0; band < maxNumBands; ++band)
+            {
+                auto& first = c.sections[2 * k][band];
+                auto& second = c.sections[2 * k + 1][band];
+
+                if (band == k)
+                    first = second = lowPass;
+                else if (band > k)
+                    first = second = highPass;
+                else
+                    first = allPass;
+            }
+        }
+
+        return c;
+    }
+};
+
+/*
+ One channel of the split.  The bands run through the same sequence of sections with different coefficients,
+ so the state is laid out band-innermost, like BiquadCascade's channels, and every line of the inner loop is
+ one vector instruction for all four bands: the crossover costs the same for 2, 3 or 4 bands,
+ short of the two sections each further crossover adds.
+ The input is spread over the lanes in chunks of at most chunkSize samples, which stay in L1 while each section
+ makes its pass, and gathered into one buffer per band at the end.
+ */
+template<typename SampleType>
+struct LinkwitzRileyCrossover
+{
+    static constexpr size_t maxNumBands = LinkwitzRileyCoefficients::maxNumBands;
+    static constexpr size_t chunkSize = 64;
+
+    void reset()
+    {
+        for (auto& s : state)
+            s = {};
+    }
+
+    //both must be the same kind of crossover
+    void copyStateFrom(const LinkwitzRileyCrossover& other)
+    {
+        state = other.state;
+        coefficients = other.coefficients;
+        numBands = other.numBands;
+        numSections = other.numSections;
+    }
+
+    //new coefficients keep the state, unless the number of bands changed, which makes it a different filter
+    void setCoefficients(const LinkwitzRileyCoefficients& c)
+    {
+        if (c.numBands != numBands)
+            reset();
+
+        numBands = c.numBands;
+        numSections = 2 * (numBands - 1);
+        for (size_t s = 0; s < numSections; ++s)
+        {
+            auto& k = coefficients[s];
+            for (size_t band = 0; band < maxNumBands; ++band)
+            {
+                const auto& section = c.sections[s][band];
+                k.b0[band] = static_cast<SampleType>(section.b0);
+                k.b1[band] = static_cast<SampleType>(section.b1);
+                k.b2[band] = static_cast<SampleType>(section.b2);
+                k.a1[band] = static_cast<SampleType>(section.a1);
+                k.a2[band] = static_cast<SampleType>(section.a2);
+            }
+        }
+    }
+
+    size_t getNumBands() const { return numBands; }
+
+    //writes numSamples samples to each of the first getNumBands() 'bands'.  'input' may be one of them
+    void split(const SampleType* input, const std::array<SampleType*, maxNumBands>& bands, size_t numSamples) noexcept
+    {
+        for (size_t start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto count = juce::jmin(chunkSize, numSamples - start);
+            alignas(16) std::array<Lanes, chunkSize> lanes;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                for (size_t band = 0; band < maxNumBands; ++band)
+                    lanes[i][band] = input[start + i];
+            }
+
+            for (size_t s = 0; s < numSections; ++s)
+            {
+                const auto& k = coefficients[s];
+                alignas(16) Lanes s1 = state[s].s1;
+                alignas(16) Lanes s2 = state[s].s2;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto& x = lanes[i];
+                    alignas(16) Lanes y;
+                    for (size_t band = 0; band < maxNumBands; ++band)
+                        y[band] = k.b0[band] * x[band] + s1[band];
+                    for (size_t band = 0; band < maxNumBands; ++band)
+                        s1[band] = k.b1[band] * x[band] - k.a1[band] * y[band] + s2[band];
+                    for (size_t band = 0; band < maxNumBands; ++band)
+                        s2[band] = k.b2[band] * x[band] - k.a2[band] * y[band];
+                    x = y;
+                }
+
+                state[s].s1 = s1;
+                state[s].s2 = s2;
+            }
+
+            for (size_t band = 0; band < numBands; ++band)
+            {
+                for (size_t i = 0; i < count; ++i)
+                    bands[band][start + i] = lanes[i][band];
+            }
+        }
+    }
+
+    //writes the sum of the first getNumBands() 'bands' to 'output', which may be one of them
+    void sum(const std::array<SampleType*, maxNumBands>& bands, SampleType* output, size_t numSamples) const noexcept
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto total = bands[0][i];
+            for (size_t band = 1; band < numBands; ++band)
+                total += bands[band][i];
+            output[i] = total;
+        }
+    }
+
+private:
+    using Lanes = std::array<SampleType, maxNumBands>;
+
+    struct Section
+    {
+        alignas(16) Lanes b0 {}, b1 {}, b2 {}, a1 {}, a2 {};
+    };
+
+    struct State
+    {
+        alignas(16) Lanes s1 {}, s2 {};
+    };
+
+    std::array<Section, LinkwitzRileyCoefficients::maxSections> coefficients {};
+    std::array<State, LinkwitzRileyCoefficients::maxSections> state {};
+    size_t numBands = 1;
+    size_t numSections = 0;
+};
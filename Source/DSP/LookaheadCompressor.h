@@ -0,0 +1,269 @@
+/*
+  ==============================================================================
+
+    LookaheadCompressor.h
+    A feed-forward compressor/limiter that sees peaks coming, with a sliding-window peak detector.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <bit>
+#include "Arena.h"
+
+/*
+ The audio is delayed by the lookahead, L samples, and the detector looks at the undelayed input:
+ the level used for output sample n is the largest |x| over the L + 1 input samples from n - L to n,
+ so the gain starts moving L samples before a peak reaches the output.
+
+ The largest value in the window is kept with a monotonic deque: it holds the samples that can still become
+ the maximum, falling from front to back.  Each new sample drops the ones behind it that it is louder than,
+ and the front leaves once it is older than the window.  Every sample is pushed and dropped at most once,
+ so the detector costs O(1) per sample however long the lookahead is.
+ The deque is a power-of-two ring, like the delay line, indexed with running counters and a mask.
+
+ The gain computer has no state, so it runs over a whole chunk of levels at once, in log2 units, with polynomial
+ log2 and exp2 that are plain arithmetic and compile to vector instructions.  Only the attack/release filter
+ after it, which needs the previous sample's gain, runs sample by sample.
+ With an attack shorter than the lookahead, the gain has settled by the time a peak comes out; a high ratio makes it a limiter.
+
+ The lookahead is fixed by prepare(), since it is the latency the host was told about.
+ While bypassed, the input still goes through the delay line and the detector, so the compressor comes back with
+ the audio the processor's latency compensation was playing, instead of a lookahead of silence.
+ Detection and gain are float in every chain; the audio stays SampleType.
+ */
+template<typename SampleType>
+struct LookaheadCompressor
+{
+    static constexpr float maxLookaheadMs = 10.f;
+    static constexpr size_t chunkSize = 64;
+    static constexpr bool processesWhileBypassed = true;
+
+    static int getLookaheadSamples(double sampleRate, float lookaheadMs)
+    {
+        return juce::roundToInt(juce::jlimit(0.f, maxLookaheadMs, lookaheadMs) * sampleRate / 1000.0);
+    }
+
+    //the delay line needs the L + 1 samples of the window, the deque at most as many entries
+    static size_t getRingSize(int lookaheadSamples)
+    {
+        return static_cast<size_t>(juce::nextPowerOfTwo(lookaheadSamples + 2));
+    }
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec, int lookaheadSamples)
+    {
+        juce::ignoreUnused(spec);
+
+        const auto ringSize = getRingSize(lookaheadSamples);
+        return Arena::bytesFor<SampleType>(ringSize)    //delay line
+             + Arena::bytesFor<float>(ringSize)         //deque levels
+             + Arena::bytesFor<juce::uint32>(ringSize); //deque times
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena, int newLookaheadSamples)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels == 1);
+
+        sampleRate = spec.sampleRate;
+        lookahead = static_cast<juce::uint32>(juce::jmax(0, newLookaheadSamples));
+        ringSize = getRingSize(newLookaheadSamples);
+
+        delayLine = arena.allocate<SampleType>(ringSize);
+        peakLevels = arena.allocate<float>(ringSize);
+        peakTimes = arena.allocate<juce::uint32>(ringSize);
+
+        makeup.reset(sampleRate, 0.05);
+        setAttack(attackMs);
+        setRelease(releaseMs);
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (delayLine == nullptr)
+            return;
+
+        std::fill(delayLine, delayLine + ringSize, SampleType(0));
+        makeup.setCurrentAndTargetValue(makeup.getTargetValue());
+
+        writePosition = 0;
+        time = 0;
+        front = back = 0;
+        gain = 1.f;
+    }
+
+    //'other' must have been prepared with the same lookahead
+    void copyStateFrom(const LookaheadCompressor& other)
+    {
+        jassert(delayLine != nullptr && other.delayLine != nullptr && lookahead == other.lookahead);
+
+        std::copy_n(other.delayLine, ringSize, delayLine);
+        std::copy_n(other.peakLevels, ringSize, peakLevels);
+        std::copy_n(other.peakTimes, ringSize, peakTimes);
+        makeup = other.makeup;
+        writePosition = other.writePosition;
+        time = other.time;
+        front = other.front;
+        back = other.back;
+        gain = other.gain;
+    }
+
+    void setThresholdDecibels(float newThresholdDecibels)
+    {
+        thresholdLog2 = newThresholdDecibels / decibelsPerOctave;
+    }
+
+    void setRatio(float newRatio)
+    {
+        jassert(newRatio >= 1.f);
+        slope = 1.f - 1.f / juce::jmax(1.f, newRatio);
+    }
+
+    void setAttack(float newAttackMs)
+    {
+        attackMs = newAttackMs;
+        attackCoefficient = getSmoothingCoefficient(attackMs);
+    }
+
+    void setRelease(float newReleaseMs)
+    {
+        releaseMs = newReleaseMs;
+        releaseCoefficient = getSmoothingCoefficient(releaseMs);
+    }
+
+    void setMakeupDecibels(float newMakeupDecibels)
+    {
+        makeup.setTargetValue(juce::Decibels::decibelsToGain(newMakeupDecibels));
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == 1);
+
+        const auto* in = inputBlock.getChannelPointer(0);
+        auto* out = outputBlock.getChannelPointer(0);
+        const auto mask = ringSize - 1;
+
+        if (context.isBypassed)
+        {
+            for (size_t i = 0; delayLine != nullptr && i < numSamples; ++i)
+            {
+                delayLine[writePosition] = in[i];
+                writePosition = (writePosition + 1) & mask;
+                pushPeak(std::abs(static_cast<float>(in[i])));
+            }
+
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        for (size_t start = 0; start < numSamples; start += chunkSize)
+        {
+            const auto count = juce::jmin(chunkSize, numSamples - start);
+            alignas(16) std::array<float, chunkSize> levels;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto x = in[start + i];
+                delayLine[writePosition] = x;
+                out[start + i] = delayLine[(writePosition - lookahead) & mask];
+                writePosition = (writePosition + 1) & mask;
+
+                levels[i] = pushPeak(std::abs(static_cast<float>(x)));
+            }
+
+            //gain for each level, in octaves: none below the threshold, 1 - 1 / ratio of the overshoot above it.
+            //no branches or calls, so it vectorises; the clamp keeps fastExp2() in range
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto overshoot = juce::jlimit(0.f, 126.f, fastLog2(levels[i]) - thresholdLog2);
+                levels[i] = fastExp2(-slope * overshoot);
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto target = levels[i];
+                const auto coefficient = target < gain ? attackCoefficient : releaseCoefficient;
+                gain = target + coefficient * (gain - target);
+                out[start + i] *= static_cast<SampleType>(gain * makeup.getNextValue());
+            }
+        }
+    }
+
+private:
+    static constexpr float decibelsPerOctave = 6.0205999f;
+
+    float getSmoothingCoefficient(float ms) const
+    {
+        return static_cast<float>(std::exp(-1000.0 / (juce::jmax(0.01f, ms) * sampleRate)));
+    }
+
+    //adds the newest level to the window and returns the window's largest
+    float pushPeak(float level) noexcept
+    {
+        const auto mask = static_cast<juce::uint32>(ringSize - 1);
+
+        while (back != front && peakLevels[(back - 1) & mask] <= level)
+            --back;
+
+        peakLevels[back & mask] = level;
+        peakTimes[back & mask] = time;
+        ++back;
+
+        //times only ever grow by one, so at most the front entry has left the window.  unsigned differences survive wrapping
+        if (time - peakTimes[front & mask] > lookahead)
+            ++front;
+
+        ++time;
+        return peakLevels[front & mask];
+    }
+
+    /*
+     the exponent bits, plus a quadratic through the mantissa in [1, 2).  within 0.005 of log2(x), 0.03 dB,
+     for every x >= 0; 0 and denormals come out near -127 instead of -inf.
+     */
+    static float fastLog2(float x) noexcept
+    {
+        const auto bits = std::bit_cast<std::int32_t>(x);
+        const auto exponent = static_cast<float>(((bits >> 23) & 255) - 128);
+        const auto mantissa = std::bit_cast<float>((bits & 0x007fffff) | 0x3f800000);
+        return exponent + (-0.34484843f * mantissa + 2.02466578f) * mantissa - 0.67487759f;
+    }
+
+    //2^x for -126 <= x <= 0: the whole part goes into the exponent bits, a cubic covers the fraction.  within 0.01% of exp2(x)
+    static float fastExp2(float x) noexcept
+    {
+        auto whole = static_cast<std::int32_t>(x);
+        whole -= static_cast<std::int32_t>(static_cast<float>(whole) > x);
+        const auto fraction = x - static_cast<float>(whole);
+        const auto power = std::bit_cast<float>((whole + 127) << 23);
+        return power * (1.f + fraction * (0.6954f + fraction * (0.2264f + fraction * 0.0782f)));
+    }
+
+    double sampleRate = 44100.0;
+    size_t ringSize = 0, writePosition = 0;
+    juce::uint32 lookahead = 0;
+
+    SampleType* delayLine = nullptr;
+    float* peakLevels = nullptr;
+    juce::uint32* peakTimes = nullptr;
+    //running sample count, and the deque's front and one-past-back, all masked into the ring when used
+    juce::uint32 time = 0, front = 0, back = 0;
+
+    float thresholdLog2 = 0.f, slope = 0.75f;
+    float attackMs = 1.f, releaseMs = 100.f;
+    float attackCoefficient = 0.f, releaseCoefficient = 0.f;
+    float gain = 1.f;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> makeup { 1.f };
+};
@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    ModulationMatrix.h
+    Block-rate LFOs and envelope followers, routed to parameter offsets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ The matrix runs once per sub-block, not per sample.
+ Every modulator and every routing is a lane in a fixed-size array, and each step is one branch-free loop over those lanes,
+ so the compiler vectorises them and the cost doesn't depend on which routings are in use.
+
+ Sources are numbered LFO 1..numLfos, then Env 1..numEnvelopes.  LFOs are bipolar (-1 to 1), envelopes are unipolar (0 to 1).
+ A routing adds source * depth to its target's offset.  Offsets are in normalised (0 to 1) parameter units.
+ Unused routings point at a spare source that is always 0 and a spare target that is never read.
+ */
+struct ModulationMatrix
+{
+    static constexpr size_t numLfos = 4;
+    static constexpr size_t numEnvelopes = 2;
+    static constexpr size_t numSources = numLfos + numEnvelopes;
+    static constexpr size_t numRoutings = 8;
+    static constexpr size_t maxNumTargets = 48;
+
+    enum class LfoShape
+    {
+        Sine,
+        Triangle,
+        Saw,
+        Square,
+        END_OF_LIST
+    };
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    void reset()
+    {
+        lfoPhases.fill(0.f);
+        envelopes.fill(0.f);
+        sources.fill(0.f);
+        offsets.fill(0.f);
+        inputPeak = 0.f;
+        numSamplesSinceLastAdvance = 0;
+    }
+
+    void setLfo(size_t lfo, float rateHz, int shape)
+    {
+        jassert(lfo < numLfos);
+        lfoRates[lfo] = rateHz;
+
+        //one-hot shape weights, so every LFO evaluates the same instructions
+        for (size_t s = 0; s < shapeWeights.size(); ++s)
+            shapeWeights[s][lfo] = static_cast<int>(s) == shape ? 1.f : 0.f;
+    }
+
+    void setEnvelope(size_t envelope, float attackMs, float releaseMs)
+    {
+        jassert(envelope < numEnvelopes);
+        attackTimes[envelope] = attackMs * 0.001f;
+        releaseTimes[envelope] = releaseMs * 0.001f;
+    }
+
+    /*
+     source and target are 0-based.  pass -1 for "none".
+     */
+    void setRouting(size_t routing, int source, int target, float depth)
+    {
+        jassert(routing < numRoutings);
+        routeSources[routing] = juce::isPositiveAndBelow(source, static_cast<int>(numSources)) ? static_cast<size_t>(source) : numSources;
+        routeTargets[routing] = juce::isPositiveAndBelow(target, static_cast<int>(maxNumTargets)) ? static_cast<size_t>(target) : maxNumTargets;
+        routeDepths[routing] = depth;
+    }
+
+    /*
+     feeds the envelope followers.  call once per sub-block with the audio the sub-block starts from.
+     */
+    template<typename SampleType>
+    void analyse(const juce::dsp::AudioBlock<SampleType>& block)
+    {
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(ch), static_cast<int>(block.getNumSamples()));
+            inputPeak = juce::jmax(inputPeak, static_cast<float>(-range.getStart()), static_cast<float>(range.getEnd()));
+        }
+
+        numSamplesSinceLastAdvance += static_cast<int>(block.getNumSamples());
+    }
+
+    /*
+     moves every modulator forward by the samples analysed since the last call and recomputes the target offsets.
+     */
+    void advance()
+    {
+        const auto elapsed = static_cast<float>(numSamplesSinceLastAdvance);
+        const auto elapsedSeconds = elapsed / static_cast<float>(sampleRate);
+        numSamplesSinceLastAdvance = 0;
+
+        //LFO phases, 0 to 1
+        for (size_t i = 0; i < numLfos; ++i)
+        {
+            auto p = lfoPhases[i] + lfoRates[i] * elapsedSeconds;
+            lfoPhases[i] = p - std::floor(p);
+        }
+
+        for (size_t i = 0; i < numLfos; ++i)
+        {
+            auto p = lfoPhases[i];
+
+            //parabolic sine, within 0.1% of std::sin
+            auto x = 2.f * p - 1.f;
+            auto y = 4.f * x * (1.f - std::abs(x));
+            auto sine = -(0.225f * (y * std::abs(y) - y) + y);
+
+            auto triangle = 1.f - 4.f * std::abs(p - 0.5f);
+            auto saw = 2.f * p - 1.f;
+            auto square = p < 0.5f ? 1.f : -1.f;
+
+            sources[i] = shapeWeights[0][i] * sine
+                       + shapeWeights[1][i] * triangle
+                       + shapeWeights[2][i] * saw
+                       + shapeWeights[3][i] * square;
+        }
+
+        //envelope followers: one-pole, with the coefficient scaled to the elapsed time
+        for (size_t i = 0; i < numEnvelopes; ++i)
+        {
+            auto& env = envelopes[i];
+            auto time = inputPeak > env ? attackTimes[i] : releaseTimes[i];
+            auto coef = std::exp(-elapsedSeconds / juce::jmax(time, 1.0e-5f));
+            env = inputPeak + coef * (env - inputPeak);
+            sources[numLfos + i] = juce::jlimit(0.f, 1.f, env);
+        }
+        inputPeak = 0.f;
+
+        offsets.fill(0.f);
+        for (size_t r = 0; r < numRoutings; ++r)
+            offsets[routeTargets[r]] += sources[routeSources[r]] * routeDepths[r];
+    }
+
+    float getOffset(size_t target) const { return offsets[target]; }
+    float getSourceValue(size_t source) const { return sources[source]; }
+
+private:
+    double sampleRate = 44100.0;
+    int numSamplesSinceLastAdvance = 0;
+    float inputPeak = 0.f;
+
+    alignas(16) std::array<float, numLfos> lfoPhases {};
+    alignas(16) std::array<float, numLfos> lfoRates {};
+    std::array<std::array<float, numLfos>, static_cast<size_t>(LfoShape::END_OF_LIST)> shapeWeights { { { 1.f, 1.f, 1.f, 1.f } } };
+
+    alignas(16) std::array<float, numEnvelopes> envelopes {};
+    alignas(16) std::array<float, numEnvelopes> attackTimes { 0.01f, 0.01f };
+    alignas(16) std::array<float, numEnvelopes> releaseTimes { 0.15f, 0.15f };
+
+    //the extra lanes are the "none" source (always 0) and the "none" target (never read)
+    alignas(16) std::array<float, numSources + 1> sources {};
+    alignas(16) std::array<float, maxNumTargets + 1> offsets {};
+
+    std::array<size_t, numRoutings> routeSources {};
+    std::array<size_t, numRoutings> routeTargets {};
+    alignas(16) std::array<float, numRoutings> routeDepths {};
+};
@@ -0,0 +1,310 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.h
+    Zero-latency convolution with an ImpulseResponse, its tail computed on the ConvolutionScheduler's threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+#include "ImpulseResponse.h"
+#include "ConvolutionScheduler.h"
+
+/*
+ The impulse response is convolved in three parts, see ImpulseResponse:
+    the head, sample by sample, so the dry impulse comes out in the same sample it went in,
+    the mid partitions, by overlap-save every headSize samples, on the audio thread,
+    the tail, by overlap-save every tailPartitionSize samples, as a ConvolutionTail job.
+
+ A partition that starts d samples in only needs input that is d samples old, so each FFT has exactly the time
+ before its output is due.  For the mid partitions that is no time at all: they run at the block boundary, inline.
+ The tail's job is posted tailLead partitions before it is collected, see ImpulseResponse::getTailLead().
+ A host hands over a whole block at once, so that is at least one host block: a job posted in one processBlock()
+ is never collected in the same call.  In realtime a job no scheduler thread has finished by then leaves that block
+ of the tail out; rendering offline, collecting runs or waits for it.  A job that couldn't be posted restarts the tail
+ from silence, so what follows it stays aligned.
+
+ The IR channel follows the processing channel.
+ */
+template<typename SampleType>
+struct PartitionedConvolver
+{
+    static_assert(std::is_same_v<SampleType, float>, "juce::dsp::FFT is float only");
+
+    static constexpr int blockSize = ImpulseResponse::headSize;
+    static constexpr int tailBlockSize = ImpulseResponse::tailPartitionSize;
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        return Arena::bytesFor<float>(2 * blockSize)                                                          //head history
+             + Arena::bytesFor<float>(2 * blockSize)                                                          //mid window
+             + Arena::bytesFor<float>(4 * blockSize)                                                          //mid transform
+             + Arena::bytesFor<float>(getMidHistorySize(ImpulseResponse::getTailLead(static_cast<int>(spec.maximumBlockSize)))) //mid history
+             + Arena::bytesFor<float>(blockSize)                                                              //mid output
+             + Arena::bytesFor<float>(2 * tailBlockSize)                                                      //tail window
+             + Arena::bytesFor<float>(tailBlockSize);                                                         //tail output
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels == 1);
+
+        sampleRate = spec.sampleRate;
+        tailLead = ImpulseResponse::getTailLead(static_cast<int>(spec.maximumBlockSize));
+        numMidPartitions = ImpulseResponse::getNumMidPartitions(tailLead);
+        fft = std::make_unique<juce::dsp::FFT>(ImpulseResponse::midFFTOrder);
+
+        headHistory = arena.allocate<float>(2 * blockSize);
+        midWindow = arena.allocate<float>(2 * blockSize);
+        midTransform = arena.allocate<float>(4 * blockSize);
+        midHistory = arena.allocate<float>(getMidHistorySize(tailLead));
+        midOutput = arena.allocate<float>(blockSize);
+        tailWindow = arena.allocate<float>(2 * tailBlockSize);
+        tailOutput = arena.allocate<float>(tailBlockSize);
+
+        for (auto* smoother : { &mix, &gain })
+            smoother->reset(sampleRate, 0.05);
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (headHistory == nullptr)
+            return;
+
+        std::fill(headHistory, headHistory + 2 * blockSize, 0.f);
+        std::fill(midWindow, midWindow + 2 * blockSize, 0.f);
+        std::fill(midHistory, midHistory + getMidHistorySize(tailLead), 0.f);
+        std::fill(midOutput, midOutput + blockSize, 0.f);
+        std::fill(tailWindow, tailWindow + 2 * tailBlockSize, 0.f);
+        std::fill(tailOutput, tailOutput + tailBlockSize, 0.f);
+
+        for (auto* smoother : { &mix, &gain })
+            smoother->setCurrentAndTargetValue(smoother->getTargetValue());
+
+        blockPosition = 0;
+        tailPosition = 0;
+        midHistoryPosition = 0;
+        restartTail();
+        wasBypassed = false;
+    }
+
+    /*
+     'other' must have been prepared with the same spec.
+     the input side is copied; the tail's history lives in the other's ConvolutionTail, so the tail starts over from silence.
+     */
+    void copyStateFrom(const PartitionedConvolver& other)
+    {
+        jassert(headHistory != nullptr && other.headHistory != nullptr && tailLead == other.tailLead);
+
+        std::copy_n(other.headHistory, 2 * blockSize, headHistory);
+        std::copy_n(other.midWindow, 2 * blockSize, midWindow);
+        std::copy_n(other.midHistory, getMidHistorySize(tailLead), midHistory);
+        std::copy_n(other.midOutput, blockSize, midOutput);
+        std::copy_n(other.tailWindow, 2 * tailBlockSize, tailWindow);
+        std::fill(tailOutput, tailOutput + tailBlockSize, 0.f);
+
+        mix = other.mix;
+        gain = other.gain;
+        blockPosition = other.blockPosition;
+        tailPosition = other.tailPosition;
+        midHistoryPosition = other.midHistoryPosition;
+        restartTail();
+        wasBypassed = other.wasBypassed;
+    }
+
+    /*
+     audio thread.  'ir' and 'tail' must stay alive until a different pair, or nullptrs, has been set.
+     'tail' is nullptr when the response is too short to have one.  changing either starts the convolution from silence.
+     a response split for another block size passes the input through, until the processor has loaded one for this one.
+     */
+    void setImpulseResponse(const ImpulseResponse* ir, ConvolutionTail* tail, int channel)
+    {
+        if (ir != nullptr && ir->getTailLead() != tailLead)
+        {
+            ir = nullptr;
+            tail = nullptr;
+        }
+
+        auto newChannel = ir != nullptr ? juce::jmin(channel, ir->getNumChannels() - 1) : 0;
+        if (ir == impulseResponse && tail == convolutionTail && newChannel == irChannel)
+            return;
+
+        impulseResponse = ir;
+        convolutionTail = tail;
+        irChannel = newChannel;
+        reset();
+    }
+
+    void setMix(float newMix)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newMix, 1.f));
+        mix.setTargetValue(newMix);
+    }
+
+    void setGainDecibels(float newGainDecibels)
+    {
+        gain.setTargetValue(juce::Decibels::decibelsToGain(newGainDecibels));
+    }
+
+    //true while the host renders offline, where a late tail block is waited for instead of left out
+    void setWaitsForTail(bool shouldWait)
+    {
+        waitsForTail = shouldWait;
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == 1);
+
+        if (context.isBypassed || impulseResponse == nullptr)
+        {
+            wasBypassed = wasBypassed || context.isBypassed;
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        //the histories are stale after a bypass
+        if (wasBypassed)
+            reset();
+
+        const auto* in = inputBlock.getChannelPointer(0);
+        auto* out = outputBlock.getChannelPointer(0);
+        const auto* head = impulseResponse->getHead(irChannel);
+        const auto hasTail = convolutionTail != nullptr;
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto x = in[i];
+
+            //written twice, so the last blockSize samples are always contiguous, oldest first, at headHistory + blockPosition + 1
+            headHistory[blockPosition] = x;
+            headHistory[blockPosition + blockSize] = x;
+            const auto* recent = headHistory + blockPosition + 1;
+
+            auto wet = midOutput[blockPosition] + (hasTail ? tailOutput[tailPosition] : 0.f);
+            for (int k = 0; k < blockSize; ++k)
+                wet += head[k] * recent[blockSize - 1 - k];
+
+            midWindow[blockSize + blockPosition] = x;
+            tailWindow[tailBlockSize + tailPosition] = x;
+
+            const auto wetAmount = mix.getNextValue();
+            out[i] = x * (1.f - wetAmount) + wet * gain.getNextValue() * wetAmount;
+
+            if (++blockPosition == blockSize)
+            {
+                blockPosition = 0;
+                processMidBlock();
+            }
+
+            if (++tailPosition == tailBlockSize)
+            {
+                tailPosition = 0;
+                if (hasTail)
+                    exchangeTailBlock();
+                std::copy_n(tailWindow + tailBlockSize, tailBlockSize, tailWindow);
+            }
+        }
+    }
+
+private:
+    //overlap-save over the last two blocks: the last blockSize samples of the circular convolution are the linear one
+    void processMidBlock()
+    {
+        constexpr int spectrumSize = ImpulseResponse::midSpectrumSize;
+        const auto numPartitions = numMidPartitions;
+
+        std::copy_n(midWindow, 2 * blockSize, midTransform);
+        std::fill(midTransform + 2 * blockSize, midTransform + 4 * blockSize, 0.f);
+        fft->performRealOnlyForwardTransform(midTransform, true);
+
+        //the newest spectrum goes in front of the others, so midHistory[midHistoryPosition + k] meets partition k
+        midHistoryPosition = (midHistoryPosition == 0 ? numPartitions : midHistoryPosition) - 1;
+        std::copy_n(midTransform, spectrumSize, midHistory + midHistoryPosition * spectrumSize);
+
+        std::fill(midTransform, midTransform + 4 * blockSize, 0.f);
+        for (int k = 0; k < numPartitions; ++k)
+        {
+            const auto* x = midHistory + ((midHistoryPosition + k) % numPartitions) * spectrumSize;
+            ImpulseResponse::multiplyAdd(x, impulseResponse->getMidSpectrum(irChannel, k), midTransform, blockSize + 1);
+        }
+
+        fft->performRealOnlyInverseTransform(midTransform);
+        std::copy_n(midTransform + blockSize, blockSize, midOutput);
+        std::copy_n(midWindow + blockSize, blockSize, midWindow);
+    }
+
+    //collects the tail for the block about to start, and posts the one for tailLead blocks after it
+    void exchangeTailBlock()
+    {
+        const auto due = nextTailSequence - tailLead;
+        if (due < firstTailSequence)
+        {
+            std::fill(tailOutput, tailOutput + tailBlockSize, 0.f);
+        }
+        else if (!convolutionTail->collect(due, tailOutput, waitsForTail))
+        {
+            std::fill(tailOutput, tailOutput + tailBlockSize, 0.f);
+            ConvolutionScheduler::get().countDroppedBlock();
+        }
+
+        //a block that isn't posted is missing from the history, so the next job starts it over
+        const auto deadline = juce::Time::getHighResolutionTicks()
+                            + juce::Time::secondsToHighResolutionTicks(tailLead * tailBlockSize / sampleRate);
+        clearTailHistory = !convolutionTail->post(nextTailSequence, tailWindow, deadline, clearTailHistory);
+
+        ++nextTailSequence;
+        ConvolutionScheduler::get().notify();
+    }
+
+    static size_t getMidHistorySize(int lead)
+    {
+        return static_cast<size_t>(ImpulseResponse::getNumMidPartitions(lead)) * ImpulseResponse::midSpectrumSize;
+    }
+
+    //jobs already posted belong to the old history; nothing before the next one is collected
+    void restartTail()
+    {
+        std::fill(tailOutput, tailOutput + tailBlockSize, 0.f);
+        clearTailHistory = true;
+        firstTailSequence = nextTailSequence;
+    }
+
+    double sampleRate = 44100.0;
+    int tailLead = 1, numMidPartitions = ImpulseResponse::getNumMidPartitions(1);
+    std::unique_ptr<juce::dsp::FFT> fft;
+
+    const ImpulseResponse* impulseResponse = nullptr;
+    ConvolutionTail* convolutionTail = nullptr;
+    int irChannel = 0;
+
+    float* headHistory = nullptr;
+    float* midWindow = nullptr;
+    float* midTransform = nullptr;
+    float* midHistory = nullptr;
+    float* midOutput = nullptr;
+    float* tailWindow = nullptr;
+    float* tailOutput = nullptr;
+
+    int blockPosition = 0, tailPosition = 0, midHistoryPosition = 0;
+    juce::int64 nextTailSequence = 0, firstTailSequence = 0;
+    bool clearTailHistory = true;
+    bool waitsForTail = false;
+    bool wasBypassed = false;
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> mix, gain;
+};
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    SharedTables.h
+    Read-only lookup tables and filter taps shared by every instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ One copy of the sine, tan and decibel tables and the half-band taps, however many instances are loaded,
+ so hundreds of instances share the same few cache lines instead of each computing the same functions.
+
+ get() builds everything the first time it is called.  Stages call it from prepare(), on the message thread,
+ so neither the processor's constructor nor the audio thread ever pays for it.
+ C++ runs the initialisation exactly once even when several instances prepare at the same time;
+ after that get() is a plain read with no lock, and the tables are never written again.
+
+ The tan table is indexed by fc / fs, so one table serves every sample rate.
+ Lookups interpolate linearly and clamp to the table's range.
+ */
+struct SharedTables
+{
+    static constexpr int sineSize = 4096;
+    static constexpr int tanSize = 4096;
+    static constexpr double maxNormalisedFrequency = 0.49;
+    static constexpr float minDecibels = -60.f, maxDecibels = 60.f, decibelStep = 0.1f;
+    static constexpr int decibelSize = static_cast<int>((maxDecibels - minDecibels) / decibelStep + 0.5f);
+
+    static constexpr int halfBandNumTaps = 47;
+    static constexpr int halfBandCentreTap = (halfBandNumTaps - 1) / 2;
+    static constexpr int halfBandNumPhaseTaps = (halfBandNumTaps + 1) / 2;
+
+    static const SharedTables& get()
+    {
+        static const SharedTables tables;
+        return tables;
+    }
+
+    //sin(phase), phase in [0, 2 pi]
+    template<typename SampleType>
+    SampleType sine(double phase) const noexcept
+    {
+        return static_cast<SampleType>(lookup(sineTable.data(), static_cast<float>(phase * (sineSize / juce::MathConstants<double>::twoPi)), sineSize));
+    }
+
+    //tan(pi * fc / fs), for fc / fs up to maxNormalisedFrequency
+    template<typename SampleType>
+    SampleType tanPi(SampleType normalisedFrequency) const noexcept
+    {
+        return static_cast<SampleType>(lookup(tanTable.data(), static_cast<float>(normalisedFrequency * (tanSize / maxNormalisedFrequency)), tanSize));
+    }
+
+    //clamped to [minDecibels, maxDecibels]
+    template<typename SampleType>
+    SampleType decibelsToGain(SampleType decibels) const noexcept
+    {
+        return static_cast<SampleType>(lookup(decibelTable.data(), (static_cast<float>(decibels) - minDecibels) / decibelStep, decibelSize));
+    }
+
+    //the even taps of HalfBandResampler's filter, see designHalfBandTaps()
+    template<typename SampleType>
+    const SampleType* getHalfBandTaps() const noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+            return halfBandTapsFloat.data();
+        else
+            return halfBandTapsDouble.data();
+    }
+
+private:
+    SharedTables()
+    {
+        for (int i = 0; i <= sineSize; ++i)
+            sineTable[static_cast<size_t>(i)] = static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * i / sineSize));
+
+        for (int i = 0; i <= tanSize; ++i)
+            tanTable[static_cast<size_t>(i)] = static_cast<float>(std::tan(juce::MathConstants<double>::pi * maxNormalisedFrequency * i / tanSize));
+
+        for (int i = 0; i <= decibelSize; ++i)
+            decibelTable[static_cast<size_t>(i)] = juce::Decibels::decibelsToGain(minDecibels + decibelStep * static_cast<float>(i));
+
+        designHalfBandTaps();
+    }
+
+    //tables have size + 1 entries, so the last interval has its right neighbour
+    static float lookup(const float* table, float position, int size) noexcept
+    {
+        position = juce::jlimit(0.f, static_cast<float>(size), position);
+        const auto index = juce::jmin(static_cast<int>(position), size - 1);
+        const auto frac = position - static_cast<float>(index);
+        return table[index] + frac * (table[index + 1] - table[index]);
+    }
+
+    //h[k] = 0.5 sinc((k - c) / 2), Kaiser windowed, normalised to unity gain at DC.  only the even taps are stored.
+    void designHalfBandTaps()
+    {
+        std::array<double, halfBandNumTaps> window {};
+        juce::dsp::WindowingFunction<double>::fillWindowingTables(window.data(), halfBandNumTaps,
+                                                                  juce::dsp::WindowingFunction<double>::kaiser,
+                                                                  false, 8.0);
+        double sum = 0;
+        for (int j = 0; j < halfBandNumPhaseTaps; ++j)
+        {
+            auto k = 2 * j;
+            auto x = juce::MathConstants<double>::pi * 0.5 * static_cast<double>(k - halfBandCentreTap);
+            auto tap = 0.5 * std::sin(x) / x * window[static_cast<size_t>(k)];
+            halfBandTapsDouble[static_cast<size_t>(j)] = tap;
+            sum += tap;
+        }
+
+        //the centre tap is 0.5, so the even taps must add up to the other half
+        for (size_t j = 0; j < halfBandTapsDouble.size(); ++j)
+        {
+            halfBandTapsDouble[j] *= 0.5 / sum;
+            halfBandTapsFloat[j] = static_cast<float>(halfBandTapsDouble[j]);
+        }
+    }
+
+    std::array<float, sineSize + 1> sineTable {};
+    std::array<float, tanSize + 1> tanTable {};
+    std::array<float, decibelSize + 1> decibelTable {};
+    std::array<double, halfBandNumPhaseTaps> halfBandTapsDouble {};
+    std::array<float, halfBandNumPhaseTaps> halfBandTapsFloat {};
+};
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    StageProcessor.h
+    The interface every stage of the DSP chain is processed through.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ juce::dsp::ProcessorBase only processes float, so the chain uses this instead.
+ the chain is instantiated once per sample type; stages are prepared through their concrete type, so only processing and reset are virtual.
+ */
+template<typename SampleType>
+struct StageProcessor
+{
+    virtual ~StageProcessor() = default;
+    virtual void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) = 0;
+    virtual void reset() = 0;
+};
+
+/*
+ what the chain expects of the processors behind it, so each of them only documents what is particular to it:
+ - process() may be handed the same block as input and output, so every input sample is read before its output is written.
+ - copyStateFrom(other) makes a processor continue exactly where 'other' is, so a stage can be rebuilt without a click.
+   each one says what 'other' must have been prepared with.
+ - one that can't trust its state after a bypass, such as feedback lines or histories, resets when it is enabled again,
+   and starts from silence like a freshly prepared one.
+ - one that isn't multichannel processes one channel per instance; the chain holds one per channel.
+   those built on juce::dsp::FFT are float only, and the double chain reaches them through DSP_Choice's conversion.
+ */
+
+/*
+ a processor that delays its output, and keeps its delay lines fed while bypassed so it comes back without a gap,
+ says so with 'static constexpr bool processesWhileBypassed = true'.  DSP_Choice then still hands it bypassed blocks
+ when it has to convert their precision first.
+ */
+template<typename Processor>
+concept ProcessesWhileBypassed = Processor::processesWhileBypassed;
+
+/*
+ the sample type a processor template was instantiated with, e.g. double for juce::dsp::IIR::Filter<double>.
+ */
+template<typename Processor>
+struct ProcessorSampleType;
+
+template<template<typename...> class Processor, typename SampleType, typename... Rest>
+struct ProcessorSampleType<Processor<SampleType, Rest...>>
+{
+    using type = SampleType;
+};
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    TptSvf.h
+    Topology-preserving state variable filter for the general filter's modes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+#include "SharedTables.h"
+
+/*
+ A trapezoidal-integrated SVF (Zavalishin / Simper).  Its two integrator states are plain signal levels,
+ so the cutoff, Q and gain can change every sample without resetting anything and without the filter blowing up.
+
+ The core produces band-pass and low-pass outputs in one go; every mode is a weighted sum of them and the input:
+    peak      x + (A^2 - 1) k band    with k = 1 / (Q A), the same response as IIR::Coefficients::makePeakFilter
+    band-pass k band                  (0 dB at the centre, like IIR::Coefficients::makeBandPass)
+    notch     x - k band
+    all-pass  x - 2k band
+ with k = 1 / Q for the others, and A^2 the peak's gain.  Switching modes only changes the weights.
+
+ setParameters() sets targets; each block ramps the cutoff, k and gain linearly from the previous targets,
+ and the per-sample coefficients are computed for the whole block first, with a polynomial tan().
+ */
+template<typename SampleType>
+struct TptSvf
+{
+    //same order as the General Filter Mode choices
+    enum class Mode
+    {
+        Peak,
+        Bandpass,
+        Notch,
+        Allpass
+    };
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        auto numChannels = static_cast<size_t>(spec.numChannels);
+        auto blockSize = static_cast<size_t>(spec.maximumBlockSize);
+
+        return Arena::bytesFor<SampleType>(2 * numChannels) //integrator states
+             + Arena::bytesFor<SampleType>(4 * blockSize);  //per-sample a1, a2, a3 and band weight
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels > 0);
+
+        sampleRate = spec.sampleRate;
+        numChannels = static_cast<size_t>(spec.numChannels);
+        maxBlockSize = static_cast<size_t>(spec.maximumBlockSize);
+        tables = &SharedTables::get();
+
+        state = arena.allocate<SampleType>(2 * numChannels);
+        a1 = arena.allocate<SampleType>(maxBlockSize);
+        a2 = arena.allocate<SampleType>(maxBlockSize);
+        a3 = arena.allocate<SampleType>(maxBlockSize);
+        bandWeights = arena.allocate<SampleType>(maxBlockSize);
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (state != nullptr)
+            std::fill(state, state + 2 * numChannels, SampleType(0));
+
+        current = target;
+    }
+
+    //both must have been prepared with the same spec
+    void copyStateFrom(const TptSvf& other)
+    {
+        jassert(numChannels == other.numChannels && state != nullptr && other.state != nullptr);
+        std::copy(other.state, other.state + 2 * numChannels, state);
+        current = other.current;
+    }
+
+    void setMode(Mode newMode)
+    {
+        mode = newMode;
+    }
+
+    void setParameters(SampleType cutoffHz, SampleType quality, SampleType gainDb)
+    {
+        jassert(cutoffHz > SampleType(0) && quality > SampleType(0));
+        target.cutoff = cutoffHz;
+        target.k = SampleType(1) / quality;
+        if (gainDb != lastGainDb)
+        {
+            lastGainDb = gainDb;
+            target.gain = tables->decibelsToGain(gainDb);                 //A^2
+            rootGain = tables->decibelsToGain(gainDb * SampleType(0.5)); //A
+        }
+        target.peakK = target.k / rootGain;
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            current = target;
+            return;
+        }
+
+        //input and band weights of the current mode, as a function of k and A^2
+        const auto inputWeight = mode == Mode::Bandpass ? SampleType(0) : SampleType(1);
+        const auto kScale = mode == Mode::Allpass ? SampleType(-2) : (mode == Mode::Notch ? SampleType(-1) : SampleType(1));
+        const auto usesGain = mode == Mode::Peak ? SampleType(1) : SampleType(0);
+        const auto currentK = mode == Mode::Peak ? current.peakK : current.k;
+        const auto targetK = mode == Mode::Peak ? target.peakK : target.k;
+
+        const auto n = static_cast<SampleType>(juce::jmax(numSamples, size_t(1)));
+        const auto cutoffStep = (target.cutoff - current.cutoff) / n;
+        const auto kStep = (targetK - currentK) / n;
+        const auto gainStep = (target.gain - current.gain) / n;
+        const auto piOverFs = static_cast<SampleType>(juce::MathConstants<double>::pi / sampleRate);
+        const auto maxW = static_cast<SampleType>(juce::MathConstants<double>::pi * 0.45);
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto t = static_cast<SampleType>(i + 1);
+            const auto w = juce::jlimit(SampleType(0), maxW, (current.cutoff + cutoffStep * t) * piOverFs);
+            const auto g = fastTan(w);
+            const auto k = currentK + kStep * t;
+            const auto gain = current.gain + gainStep * t;
+
+            a1[i] = SampleType(1) / (SampleType(1) + g * (g + k));
+            a2[i] = g * a1[i];
+            a3[i] = g * a2[i];
+            //peak: (A^2 - 1) k.  the other modes: kScale * k
+            bandWeights[i] = k * (usesGain * (gain - SampleType(1)) + (SampleType(1) - usesGain) * kScale);
+        }
+        current = target;
+
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = inputBlock.getChannelPointer(ch);
+            auto* out = outputBlock.getChannelPointer(ch);
+            auto ic1 = state[2 * ch];
+            auto ic2 = state[2 * ch + 1];
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                const auto x = in[i];
+                const auto v3 = x - ic2;
+                const auto band = a1[i] * ic1 + a2[i] * v3;
+                const auto low = ic2 + a2[i] * ic1 + a3[i] * v3;
+                ic1 = SampleType(2) * band - ic1;
+                ic2 = SampleType(2) * low - ic2;
+
+                out[i] = inputWeight * x + bandWeights[i] * band;
+            }
+
+            state[2 * ch] = ic1;
+            state[2 * ch + 1] = ic2;
+        }
+    }
+
+private:
+    //[5/4] Pade approximant, accurate to well under 0.1% up to 0.45 pi
+    static SampleType fastTan(SampleType x) noexcept
+    {
+        const auto x2 = x * x;
+        return x * (SampleType(945) - x2 * (SampleType(105) - x2))
+                 / (SampleType(945) - x2 * (SampleType(420) - SampleType(15) * x2));
+    }
+
+    struct Parameters
+    {
+        SampleType cutoff = SampleType(750), k = SampleType(1), peakK = SampleType(1), gain = SampleType(1);
+    };
+
+    double sampleRate = 44100.0;
+    size_t numChannels = 0, maxBlockSize = 0;
+    const SharedTables* tables = nullptr;
+
+    SampleType* state = nullptr;
+    SampleType* a1 = nullptr;
+    SampleType* a2 = nullptr;
+    SampleType* a3 = nullptr;
+    SampleType* bandWeights = nullptr;
+
+    Mode mode = Mode::Peak;
+    Parameters target, current;
+    SampleType lastGainDb = 0, rootGain = 1;
+};
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    Wait-free single-producer / single-consumer latest-value exchange.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ The producer always writes into its own back slot, then swaps it with the middle slot.
+ The consumer swaps the middle slot with its front slot only when something new was published.
+ Neither side ever waits, and the consumer always gets the most recent complete value.
+ Older values that were never read are simply overwritten.
+ */
+template<typename T>
+struct TripleBuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>, "values are copied between threads without allocating");
+
+    //producer thread only
+    void write(const T& value)
+    {
+        slots[back] = value;
+        auto previous = middle.exchange(static_cast<juce::uint8>(back | newDataFlag), std::memory_order_acq_rel);
+        back = previous & indexMask;
+    }
+
+    //consumer thread only.  returns false, and leaves value untouched, if nothing was written since the last read.
+    bool read(T& value)
+    {
+        if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+            return false;
+
+        auto previous = middle.exchange(static_cast<juce::uint8>(front), std::memory_order_acq_rel);
+        front = previous & indexMask;
+        value = slots[front];
+        return true;
+    }
+
+    /*
+     consumer thread only.  like read(), but when nothing new was written it returns the value it read last time,
+     for a consumer that needs the current value whether or not it changed.  something must have been written first.
+     */
+    bool readLatest(T& value)
+    {
+        if (read(value))
+            return true;
+
+        value = slots[front];
+        return false;
+    }
+
+private:
+    static constexpr juce::uint8 indexMask = 0x3;
+    static constexpr juce::uint8 newDataFlag = 0x4;
+
+    std::array<T, 3> slots {};
+    juce::uint8 back = 0;
+    juce::uint8 front = 1;
+    std::atomic<juce::uint8> middle { 2 };
+};
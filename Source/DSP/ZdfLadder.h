@@ -0,0 +1,236 @@
+/*
+  ==============================================================================
+
+    ZdfLadder.h
+    Zero-delay-feedback (TPT) 4-pole ladder filter with per-sample cutoff.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Arena.h"
+
+/*
+ Same controls and modes as juce::dsp::LadderFilter, so it drops into the LadderFilter stage.
+ Four TPT one-pole low-passes with global feedback; the feedback loop is solved instead of delayed by a sample,
+ so the cutoff tracks exactly and can change every sample without zipper noise.
+
+ The cutoff can come from a per-sample buffer (process with a cutoff pointer), or from setCutoffFrequencyHz(),
+ in which case it ramps linearly to the new value across the next block.
+ Per-sample coefficients are computed for the whole block first, in a branch-free loop the compiler vectorises,
+ with polynomial tan() and tanh() approximations instead of library calls.
+ The recursion itself runs one sample at a time.
+
+ Each channel's 4 integrator states, the cutoff ramp and the coefficients live in the Arena.
+ */
+template<typename SampleType>
+struct ZdfLadder
+{
+    static constexpr size_t numPoles = 4;
+
+    static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec)
+    {
+        auto numChannels = static_cast<size_t>(spec.numChannels);
+        auto blockSize = static_cast<size_t>(spec.maximumBlockSize);
+
+        return Arena::bytesFor<SampleType>(numPoles * numChannels) //integrator states
+             + Arena::bytesFor<SampleType>(blockSize)              //cutoff ramp
+             + Arena::bytesFor<SampleType>(blockSize);             //per-sample G
+    }
+
+    void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena)
+    {
+        jassert(spec.sampleRate > 0);
+        jassert(spec.numChannels > 0);
+
+        sampleRate = spec.sampleRate;
+        numChannels = static_cast<size_t>(spec.numChannels);
+        maxBlockSize = static_cast<size_t>(spec.maximumBlockSize);
+
+        state = arena.allocate<SampleType>(numPoles * numChannels);
+        cutoffRamp = arena.allocate<SampleType>(maxBlockSize);
+        gains = arena.allocate<SampleType>(maxBlockSize);
+
+        reset();
+    }
+
+    void reset()
+    {
+        if (state != nullptr)
+            std::fill(state, state + numPoles * numChannels, SampleType(0));
+
+        currentCutoff = targetCutoff;
+    }
+
+    //both must have been prepared with the same spec
+    void copyStateFrom(const ZdfLadder& other)
+    {
+        jassert(numChannels == other.numChannels && state != nullptr && other.state != nullptr);
+        std::copy(other.state, other.state + numPoles * numChannels, state);
+        currentCutoff = other.currentCutoff;
+    }
+
+    void setMode(juce::dsp::LadderFilterMode newMode)
+    {
+        using Mode = juce::dsp::LadderFilterMode;
+        //weights of { input, pole 1, pole 2, pole 3, pole 4 }, as in juce::dsp::LadderFilter
+        switch (newMode)
+        {
+        case Mode::LPF12: mix = { 0, 0, 1, 0, 0 }; compensation = SampleType(0.5); break;
+        case Mode::HPF12: mix = { 1, -2, 1, 0, 0 }; compensation = SampleType(0); break;
+        case Mode::BPF12: mix = { 0, 0, -1, 1, 0 }; compensation = SampleType(0.5); break;
+        case Mode::LPF24: mix = { 0, 0, 0, 0, 1 }; compensation = SampleType(0.5); break;
+        case Mode::HPF24: mix = { 1, -4, 6, -4, 1 }; compensation = SampleType(0); break;
+        case Mode::BPF24: mix = { 0, 0, 1, -2, 1 }; compensation = SampleType(0.5); break;
+        default: jassertfalse; break;
+        }
+    }
+
+    void setCutoffFrequencyHz(SampleType newCutoffHz)
+    {
+        jassert(newCutoffHz > SampleType(0));
+        targetCutoff = newCutoffHz;
+    }
+
+    //0 to 1, self-oscillates near 1
+    void setResonance(SampleType newResonance)
+    {
+        jassert(juce::isPositiveAndNotGreaterThan(newResonance, SampleType(1)));
+        feedback = SampleType(4) * newResonance;
+    }
+
+    //1 and up.  the output level curve matches juce::dsp::LadderFilter
+    void setDrive(SampleType newDrive)
+    {
+        jassert(newDrive >= SampleType(1));
+        if (newDrive == drive)
+            return;
+
+        drive = newDrive;
+        outputGain = static_cast<SampleType>(std::pow(drive, SampleType(-2.642)) * SampleType(0.6103) + SampleType(0.3903));
+    }
+
+    template<typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto numSamples = context.getOutputBlock().getNumSamples();
+        jassert(numSamples <= maxBlockSize);
+
+        //ramp from where the last block ended to the latest target
+        const auto step = (targetCutoff - currentCutoff) / static_cast<SampleType>(juce::jmax(numSamples, size_t(1)));
+        for (size_t i = 0; i < numSamples; ++i)
+            cutoffRamp[i] = currentCutoff + step * static_cast<SampleType>(i + 1);
+        currentCutoff = targetCutoff;
+
+        process(context, cutoffRamp);
+    }
+
+    /*
+     cutoffHz holds one cutoff per sample of the block, shared by all channels.
+     */
+    template<typename ProcessContext>
+    void process(const ProcessContext& context, const SampleType* cutoffHz) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numSamples = outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumChannels() == numChannels);
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed)
+        {
+            if (context.usesSeparateInputAndOutputBlocks())
+                outputBlock.copyFrom(inputBlock);
+
+            return;
+        }
+
+        //G = g / (1 + g), g = tan(pi * fc / fs).  the cutoff is kept below 0.45 fs, where the approximation is still accurate
+        const auto piOverFs = static_cast<SampleType>(juce::MathConstants<double>::pi / sampleRate);
+        const auto maxW = static_cast<SampleType>(juce::MathConstants<double>::pi * 0.45);
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto w = juce::jlimit(SampleType(0), maxW, cutoffHz[i] * piOverFs);
+            auto g = fastTan(w);
+            gains[i] = g / (SampleType(1) + g);
+        }
+
+        const auto k = feedback;
+        const auto comp = compensation;
+        const auto m = mix;
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = inputBlock.getChannelPointer(ch);
+            auto* out = outputBlock.getChannelPointer(ch);
+            auto* s = state + numPoles * ch;
+            auto s1 = s[0], s2 = s[1], s3 = s[2], s4 = s[3];
+
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                const auto G = gains[i];
+                const auto beta = SampleType(1) - G;
+
+                //each pole is y = G * x + beta * s, so the 4th pole's output is G^4 * u + S
+                const auto sigma = beta * (G * (G * (G * s1 + s2) + s3) + s4);
+                const auto G4 = G * G * G * G;
+
+                const auto x = outputGain * fastTanh(drive * in[i]);
+                //solve u = x - k * (y4 - comp * x) for u, then soft-clip it to keep the resonance bounded
+                const auto u = fastTanh((x * (SampleType(1) + k * comp) - k * sigma) / (SampleType(1) + k * G4));
+
+                const auto v1 = G * (u - s1);
+                const auto y1 = v1 + s1;
+                s1 = y1 + v1;
+                const auto v2 = G * (y1 - s2);
+                const auto y2 = v2 + s2;
+                s2 = y2 + v2;
+                const auto v3 = G * (y2 - s3);
+                const auto y3 = v3 + s3;
+                s3 = y3 + v3;
+                const auto v4 = G * (y3 - s4);
+                const auto y4 = v4 + s4;
+                s4 = y4 + v4;
+
+                out[i] = m[0] * u + m[1] * y1 + m[2] * y2 + m[3] * y3 + m[4] * y4;
+            }
+
+            s[0] = s1;
+            s[1] = s2;
+            s[2] = s3;
+            s[3] = s4;
+        }
+    }
+
+private:
+    //[5/4] Pade approximant, within 1e-4 relative of std::tan up to 0.45 pi
+    static SampleType fastTan(SampleType x) noexcept
+    {
+        const auto x2 = x * x;
+        return x * (SampleType(945) - x2 * (SampleType(105) - x2))
+                 / (SampleType(945) - x2 * (SampleType(420) - SampleType(15) * x2));
+    }
+
+    //rational approximation, exactly +/-1 at +/-3 and clamped beyond
+    static SampleType fastTanh(SampleType x) noexcept
+    {
+        x = juce::jlimit(SampleType(-3), SampleType(3), x);
+        const auto x2 = x * x;
+        return x * (SampleType(27) + x2) / (SampleType(27) + SampleType(9) * x2);
+    }
+
+    double sampleRate = 44100.0;
+    size_t numChannels = 0, maxBlockSize = 0;
+
+    SampleType* state = nullptr;
+    SampleType* cutoffRamp = nullptr;
+    SampleType* gains = nullptr;
+
+    SampleType targetCutoff = SampleType(200), currentCutoff = SampleType(200);
+    SampleType feedback = 0;
+    SampleType drive = SampleType(1), outputGain = SampleType(1);
+    std::array<SampleType, numPoles + 1> mix { 0, 0, 1, 0, 0 };
+    SampleType compensation = SampleType(0.5);
+};
@@ -26,6 +26,14 @@ static juce::String getNameFromDSPOption(Project13AudioProcessor::DSP_Option opt
         return "LADDERFILTER";
     case Project13AudioProcessor::DSP_Option::GeneralFilter:
         return "GEN FILTER";
+    case Project13AudioProcessor::DSP_Option::Convolution:
+        return "CONVOLUTION";
+    case Project13AudioProcessor::DSP_Option::LinearPhaseEQ:
+        return "LIN EQ";
+    case Project13AudioProcessor::DSP_Option::Dynamics:
+        return "DYNAMICS";
+    case Project13AudioProcessor::DSP_Option::Reverb:
+        return "REVERB";
     case Project13AudioProcessor::DSP_Option::END_OF_LIST:
         jassertfalse;
     }
@@ -44,6 +52,14 @@ static Project13AudioProcessor::DSP_Option getDSPOptionFromName(juce::String nam
         return Project13AudioProcessor::DSP_Option::LadderFilter;
     if (name == "GEN FILTER")
         return Project13AudioProcessor::DSP_Option::GeneralFilter;
+    if (name == "CONVOLUTION")
+        return Project13AudioProcessor::DSP_Option::Convolution;
+    if (name == "LIN EQ")
+        return Project13AudioProcessor::DSP_Option::LinearPhaseEQ;
+    if (name == "DYNAMICS")
+        return Project13AudioProcessor::DSP_Option::Dynamics;
+    if (name == "REVERB")
+        return Project13AudioProcessor::DSP_Option::Reverb;
 
     return Project13AudioProcessor::DSP_Option::END_OF_LIST;
 }
@@ -221,7 +237,8 @@ void ExtendedTabbedButtonBar::mouseDown(const juce::MouseEvent& e)
 void Project13AudioProcessorEditor::tabOrderChanged(Project13AudioProcessor::DSP_Order newOrder)
 {
     rebuildInterface();
-    audioProcessor.dspOrderFifo.push(newOrder);
+    shownDspOrder = newOrder;
+    audioProcessor.setDspOrder(newOrder);
 }
 
 struct PowerButtonWithParam : PowerButton
@@ -287,8 +304,8 @@ void Project13AudioProcessorEditor::selectedTabChanged(int newCurrentTabIndex)
      when the audio parameter settings are loaded from disk, the callback for the parameter attachment is called.
      this callback changes the selected tab and rebuilds the interface.
      the creation of the attachment can't happen until after tabs have been created.
-     tabs are created in TimerCallback whenever the restoreDspOrderFifo has a DSP_Order instance to pull.
-     This is why the attachment creation is not in the constructor, but is instead in timerCallback(), after it is determined that the restoreDspOrderFifo has items to pull.
+     tabs are created in TimerCallback whenever the processor has a new DSP_Order for the editor.
+     This is why the attachment creation is not in the constructor, but is instead in timerCallback(), after the first DSP_Order has been read.
      */
     if (selectedTabAttachment)
     {
@@ -412,11 +429,49 @@ Project13AudioProcessorEditor::Project13AudioProcessorEditor (Project13AudioProc
     setLookAndFeel(&lookAndFeel);
     addAndMakeVisible(tabbedComponent);
     addAndMakeVisible(dspGUI);
-    audioProcessor.guiNeedsLatestDspOrder.set(true);
+    //the first timerCallback() builds the tabs from whatever order is current
+    shownDspOrder.fill(Project13AudioProcessor::DSP_Option::END_OF_LIST);
+
+    presetSelector.setTextWhenNothingSelected("Presets");
+    presetSelector.setTextWhenNoChoicesAvailable("No Presets");
+    presetSelector.onChange = [this]()
+    {
+        auto index = presetSelector.getSelectedItemIndex();
+        if (index >= 0)
+            audioProcessor.setCurrentProgram(index);
+    };
+    addAndMakeVisible(presetSelector);
+
+    savePresetButton.onClick = [this]() { showSavePresetDialog(); };
+    addAndMakeVisible(savePresetButton);
+    refreshPresetList();
+
+    morphEnabledAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(audioProcessor.apvts, audioProcessor.morphEnabled->getParameterID(), morphEnabledButton);
+    morphSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, audioProcessor.morphAmount->getParameterID(), morphSlider);
+    storeMorphAButton.setTooltip("Store the current settings as morph snapshot A");
+    storeMorphBButton.setTooltip("Store the current settings as morph snapshot B");
+    storeMorphAButton.onClick = [this]() { audioProcessor.storeMorphSnapshot(Project13AudioProcessor::MorphSlot::A); };
+    storeMorphBButton.onClick = [this]() { audioProcessor.storeMorphSnapshot(Project13AudioProcessor::MorphSlot::B); };
+    addAndMakeVisible(morphEnabledButton);
+    addAndMakeVisible(storeMorphAButton);
+    addAndMakeVisible(morphSlider);
+    addAndMakeVisible(storeMorphBButton);
+
+    midSideAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(audioProcessor.apvts, audioProcessor.midSideMode->getParameterID(), midSideButton);
+    midSideButton.setTooltip("Process mid on the left chain and side on the right chain");
+    addAndMakeVisible(midSideButton);
+
+    globalMixAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.apvts, audioProcessor.globalMixPercent->getParameterID(), globalMixSlider);
+    globalMixSlider.setTooltip("Global wet/dry mix");
+    addAndMakeVisible(globalMixSlider);
+
+    impulseResponseButton.onClick = [this]() { showImpulseResponseChooser(); };
+    updateImpulseResponseTooltip();
+    addAndMakeVisible(impulseResponseButton);
 
     tabbedComponent.addListener(this);
     startTimerHz(30);
-    setSize(768, 400);
+    setSize(768, 420);
 }
 
 Project13AudioProcessorEditor::~Project13AudioProcessorEditor()
@@ -555,26 +610,62 @@ void Project13AudioProcessorEditor::resized()
     auto leftmeterArea = bounds.removeFromLeft(meterWidth);
     auto rightMeterArea = bounds.removeFromRight(meterWidth);
     juce::ignoreUnused(leftmeterArea, rightMeterArea);
+
+    auto presetArea = bounds.removeFromTop(24);
+    storeMorphBButton.setBounds(presetArea.removeFromRight(30));
+    morphSlider.setBounds(presetArea.removeFromRight(150));
+    storeMorphAButton.setBounds(presetArea.removeFromRight(30));
+    morphEnabledButton.setBounds(presetArea.removeFromRight(70));
+    midSideButton.setBounds(presetArea.removeFromRight(50));
+    globalMixSlider.setBounds(presetArea.removeFromRight(100));
+    impulseResponseButton.setBounds(presetArea.removeFromRight(40));
+    savePresetButton.setBounds(presetArea.removeFromRight(60));
+    presetSelector.setBounds(presetArea);
+    bounds.removeFromTop(6);
+
     tabbedComponent.setBounds(bounds.removeFromTop(30));
     dspGUI.setBounds(bounds);
 }
 
+void Project13AudioProcessorEditor::showImpulseResponseChooser()
+{
+    impulseResponseChooser = std::make_unique<juce::FileChooser>("Load an impulse response for the convolution stage",
+                                                                 audioProcessor.getImpulseResponseFile(),
+                                                                 "*.wav;*.aif;*.aiff;*.flac");
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    impulseResponseChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+    {
+        //cancelling leaves the current impulse response alone
+        auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        audioProcessor.loadImpulseResponse(file);
+        updateImpulseResponseTooltip();
+    });
+}
+
+void Project13AudioProcessorEditor::updateImpulseResponseTooltip()
+{
+    auto file = audioProcessor.getImpulseResponseFile();
+    impulseResponseButton.setTooltip(file == juce::File() ? juce::String("Load an impulse response for the convolution stage")
+                                                          : "Impulse response: " + file.getFileName());
+}
+
 void Project13AudioProcessorEditor::timerCallback()
 {
     repaint();
-    if (audioProcessor.restoreDspOrderFifo.getNumAvailableForReading() == 0)
-        return;
 
-    using T = Project13AudioProcessor::DSP_Order;
-    T newOrder;
-    newOrder.fill(Project13AudioProcessor::DSP_Option::END_OF_LIST);
-    auto empty = newOrder;
-    while (audioProcessor.restoreDspOrderFifo.pull(newOrder))
-    {
-        ; // do nothing.   you'll do something with the most recently pulled order
-    }
+    //the band choices can change without the order changing
+    showStagesMovedAfterBands();
+
+    //until the tabs exist, take the current order even if an earlier editor already read it
+    Project13AudioProcessor::DSP_Order newOrder;
+    if (!audioProcessor.readDspOrder(newOrder, selectedTabAttachment == nullptr))
+        return;
 
-    if (newOrder != empty) //if you pulled nothing, newOrder will be filled with END_OF_LIST
+    //orders this editor sent itself come back too, and the tabs already show them
+    if (newOrder != shownDspOrder)
     {
         addTabsFromDSPOrder(newOrder);
     }
@@ -599,6 +690,34 @@ void Project13AudioProcessorEditor::timerCallback()
 
 }
 
+void Project13AudioProcessorEditor::refreshPresetList()
+{
+    presetSelector.clear(juce::dontSendNotification);
+    presetSelector.addItemList(audioProcessor.getPresetNames(), 1);
+
+    if (presetSelector.getNumItems() > 0)
+        presetSelector.setSelectedItemIndex(audioProcessor.getCurrentProgram(), juce::dontSendNotification);
+}
+
+void Project13AudioProcessorEditor::showSavePresetDialog()
+{
+    auto* window = new juce::AlertWindow("Save Preset", "Enter a name for the preset", juce::MessageBoxIconType::NoIcon, this);
+    window->addTextEditor("name", "Preset " + juce::String(presetSelector.getNumItems() + 1));
+    window->addButton("Save", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    window->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    //the window deletes itself after the callback runs
+    window->enterModalState(true, juce::ModalCallbackFunction::create([this, window](int result)
+        {
+            auto name = window->getTextEditorContents("name").trim();
+            if (result == 1 && name.isNotEmpty())
+            {
+                audioProcessor.savePresetToBank(name);
+                refreshPresetList();
+            }
+        }), true);
+}
+
 void Project13AudioProcessorEditor::addTabsFromDSPOrder(Project13AudioProcessor::DSP_Order newOrder)
 {
     tabbedComponent.clearTabs();
@@ -632,7 +751,23 @@ void Project13AudioProcessorEditor::addTabsFromDSPOrder(Project13AudioProcessor:
     }
 
     rebuildInterface();  
-    audioProcessor.dspOrderFifo.push(newOrder);
+    shownDspOrder = newOrder;
+    showStagesMovedAfterBands();
+}
+
+void Project13AudioProcessorEditor::showStagesMovedAfterBands()
+{
+    if (tabbedComponent.getNumTabs() != static_cast<int>(shownDspOrder.size()))
+        return;
+
+    auto moved = audioProcessor.getStagesMovedAfterBands(shownDspOrder);
+    for (int i = 0; i < tabbedComponent.getNumTabs(); ++i)
+    {
+        auto isMoved = moved[static_cast<size_t>(i)];
+        tabbedComponent.setTabBackgroundColour(i, isMoved ? juce::Colours::orange : juce::Colours::white);
+        if (auto tab = tabbedComponent.getTabButton(i))
+            tab->setTooltip(isMoved ? juce::String("Runs on the full signal after the bands are summed, not at this position") : juce::String());
+    }
 }
 
 void Project13AudioProcessorEditor::rebuildInterface()
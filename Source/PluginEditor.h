@@ -153,7 +153,31 @@ private:
     static constexpr int meterWidth = 80;
     std::unique_ptr<juce::ParameterAttachment> selectedTabAttachment;
     void addTabsFromDSPOrder(Project13AudioProcessor::DSP_Order);
+    Project13AudioProcessor::DSP_Order shownDspOrder;
+    void showStagesMovedAfterBands();
     void rebuildInterface();
 
+    juce::ComboBox presetSelector;
+    juce::TextButton savePresetButton { "Save" };
+    void refreshPresetList();
+    void showSavePresetDialog();
+
+    juce::ToggleButton morphEnabledButton { "Morph" };
+    juce::TextButton storeMorphAButton { "A" }, storeMorphBButton { "B" };
+    juce::Slider morphSlider { juce::Slider::SliderStyle::LinearHorizontal, juce::Slider::TextEntryBoxPosition::NoTextBox };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> morphEnabledAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> morphSliderAttachment;
+
+    juce::ToggleButton midSideButton { "M/S" };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> midSideAttachment;
+
+    juce::Slider globalMixSlider { juce::Slider::SliderStyle::LinearHorizontal, juce::Slider::TextEntryBoxPosition::NoTextBox };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> globalMixAttachment;
+
+    juce::TextButton impulseResponseButton { "IR" };
+    std::unique_ptr<juce::FileChooser> impulseResponseChooser;
+    void showImpulseResponseChooser();
+    void updateImpulseResponseTooltip();
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Project13AudioProcessorEditor)
 };
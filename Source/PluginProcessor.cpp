@@ -58,11 +58,265 @@ auto getGeneralFilterChoices()
     };
 }
 auto getGeneralFilterModeName() { return juce::String("General Filter Mode"); }
+auto getGeneralFilterEngineName() { return juce::String("General Filter Engine"); }
+//order matches Project13AudioProcessor::GeneralFilterEngine
+auto getGeneralFilterEngineChoices()
+{
+    return juce::StringArray
+    {
+        "Biquad",
+        "SVF",
+    };
+}
 auto getGeneralFilterFreqName() { return juce::String("General Filter Freq hz"); }
 auto getGeneralFilterQualityName() { return juce::String("General Filter Quality"); }
 auto getGeneralFilterGainName() { return juce::String("General Filter Gain"); }
 auto getGeneralFilterBypassName() { return juce::String("General Filter Bypass"); }
 
+auto getConvolutionMixName() { return juce::String("Convolution Mix %"); }
+auto getConvolutionGainName() { return juce::String("Convolution Gain"); }
+auto getConvolutionBypassName() { return juce::String("Convolution Bypass"); }
+
+auto getLinearPhaseEQLowFreqName() { return juce::String("Lin EQ Low Freq Hz"); }
+auto getLinearPhaseEQLowGainName() { return juce::String("Lin EQ Low Gain"); }
+auto getLinearPhaseEQMidFreqName() { return juce::String("Lin EQ Mid Freq Hz"); }
+auto getLinearPhaseEQMidQualityName() { return juce::String("Lin EQ Mid Quality"); }
+auto getLinearPhaseEQMidGainName() { return juce::String("Lin EQ Mid Gain"); }
+auto getLinearPhaseEQHighFreqName() { return juce::String("Lin EQ High Freq Hz"); }
+auto getLinearPhaseEQHighGainName() { return juce::String("Lin EQ High Gain"); }
+auto getLinearPhaseEQFFTSizeName() { return juce::String("Lin EQ FFT Size"); }
+auto getLinearPhaseEQBypassName() { return juce::String("Lin EQ Bypass"); }
+//choice n is an FFT of order LinearPhaseKernel::minFFTOrder + n
+auto getLinearPhaseEQFFTSizeChoices()
+{
+    return juce::StringArray
+    {
+        "1024",
+        "2048",
+        "4096",
+        "8192",
+    };
+}
+
+auto getDynamicsThresholdName() { return juce::String("Dynamics Threshold dB"); }
+auto getDynamicsRatioName() { return juce::String("Dynamics Ratio"); }
+auto getDynamicsAttackName() { return juce::String("Dynamics Attack ms"); }
+auto getDynamicsReleaseName() { return juce::String("Dynamics Release ms"); }
+auto getDynamicsMakeupName() { return juce::String("Dynamics Makeup dB"); }
+auto getDynamicsLookaheadName() { return juce::String("Dynamics Lookahead ms"); }
+auto getDynamicsBypassName() { return juce::String("Dynamics Bypass"); }
+
+auto getReverbSizeName() { return juce::String("Reverb Size %"); }
+auto getReverbDecayName() { return juce::String("Reverb Decay s"); }
+auto getReverbDampingName() { return juce::String("Reverb Damping %"); }
+auto getReverbModDepthName() { return juce::String("Reverb Mod Depth %"); }
+auto getReverbMixName() { return juce::String("Reverb Mix %"); }
+auto getReverbBypassName() { return juce::String("Reverb Bypass"); }
+
+auto getMorphAmountName() { return juce::String("Morph %"); }
+auto getMorphSwitchPointName() { return juce::String("Morph Switch Point %"); }
+auto getMorphEnabledName() { return juce::String("Morph Enabled"); }
+
+auto getDoublePrecisionFiltersName() { return juce::String("Double Precision Filters"); }
+
+auto getGlobalMixName() { return juce::String("Global Mix %"); }
+
+auto getPreHpfFreqName() { return juce::String("Pre HPF Hz"); }
+auto getPreHpfSlopeName() { return juce::String("Pre HPF Slope"); }
+auto getPreLpfFreqName() { return juce::String("Pre LPF Hz"); }
+auto getPreLpfSlopeName() { return juce::String("Pre LPF Slope"); }
+auto getPreFilterBypassName() { return juce::String("Pre Filter Bypass"); }
+
+auto getPostHpfFreqName() { return juce::String("Post HPF Hz"); }
+auto getPostHpfSlopeName() { return juce::String("Post HPF Slope"); }
+auto getPostLpfFreqName() { return juce::String("Post LPF Hz"); }
+auto getPostLpfSlopeName() { return juce::String("Post LPF Slope"); }
+auto getPostFilterBypassName() { return juce::String("Post Filter Bypass"); }
+
+//each step adds one 2nd order section
+auto getFilterSlopeChoices()
+{
+    return juce::StringArray
+    {
+        "12 dB/Oct",
+        "24 dB/Oct",
+        "36 dB/Oct",
+        "48 dB/Oct",
+    };
+}
+
+auto getInternalRateCapName() { return juce::String("Internal Rate Cap"); }
+auto getInternalRateCapChoices()
+{
+    return juce::StringArray
+    {
+        "Off",
+        "48 kHz",
+        "96 kHz",
+    };
+}
+
+//the power of 2 that brings the host rate down to the cap, at most 8
+int getDecimationFactor(double sampleRate, int capChoice)
+{
+    const auto caps = std::array { 0.0, 48000.0, 96000.0 };
+    const auto cap = caps[static_cast<size_t>(juce::jlimit(0, static_cast<int>(caps.size()) - 1, capChoice))];
+    if (cap <= 0.0)
+        return 1;
+
+    int factor = 1;
+    while (factor < 8 && sampleRate / factor > cap + 1.0)
+        factor *= 2;
+
+    return factor;
+}
+
+auto getMidSideModeName() { return juce::String("Mid/Side Mode"); }
+auto getPhaserMidSideName() { return juce::String("Phaser M/S"); }
+auto getChorusMidSideName() { return juce::String("Chorus M/S"); }
+auto getOverdriveMidSideName() { return juce::String("Overdrive M/S"); }
+auto getLadderFilterMidSideName() { return juce::String("Ladder Filter M/S"); }
+auto getGeneralFilterMidSideName() { return juce::String("General Filter M/S"); }
+auto getConvolutionMidSideName() { return juce::String("Convolution M/S"); }
+auto getLinearPhaseEQMidSideName() { return juce::String("Lin EQ M/S"); }
+auto getDynamicsMidSideName() { return juce::String("Dynamics M/S"); }
+auto getReverbMidSideName() { return juce::String("Reverb M/S"); }
+
+//order matches Project13AudioProcessor::MidSideAssignment
+auto getMidSideChoices()
+{
+    return juce::StringArray
+    {
+        "Mid + Side",
+        "Mid",
+        "Side",
+    };
+}
+
+auto getMultibandModeName() { return juce::String("Multiband"); }
+//choice n splits the chain into n + 1 bands; 0 leaves it full band
+auto getMultibandModeChoices()
+{
+    return juce::StringArray
+    {
+        "Off",
+        "2 Bands",
+        "3 Bands",
+        "4 Bands",
+    };
+}
+
+auto getCrossover1FreqName() { return juce::String("Crossover 1 Hz"); }
+auto getCrossover2FreqName() { return juce::String("Crossover 2 Hz"); }
+auto getCrossover3FreqName() { return juce::String("Crossover 3 Hz"); }
+
+auto getPhaserBandName() { return juce::String("Phaser Band"); }
+auto getChorusBandName() { return juce::String("Chorus Band"); }
+auto getOverdriveBandName() { return juce::String("Overdrive Band"); }
+auto getLadderFilterBandName() { return juce::String("Ladder Filter Band"); }
+auto getGeneralFilterBandName() { return juce::String("General Filter Band"); }
+auto getConvolutionBandName() { return juce::String("Convolution Band"); }
+auto getLinearPhaseEQBandName() { return juce::String("Lin EQ Band"); }
+auto getDynamicsBandName() { return juce::String("Dynamics Band"); }
+auto getReverbBandName() { return juce::String("Reverb Band"); }
+
+//choice n is band n, lowest first; 0 is the full signal, see Project13AudioProcessor::getLiveStageBand()
+auto getBandChoices()
+{
+    return juce::StringArray
+    {
+        "Full",
+        "Band 1",
+        "Band 2",
+        "Band 3",
+        "Band 4",
+    };
+}
+
+auto getLfoRateName(size_t i) { return juce::String("LFO ") + juce::String(static_cast<int>(i) + 1) + " Rate Hz"; }
+auto getLfoShapeName(size_t i) { return juce::String("LFO ") + juce::String(static_cast<int>(i) + 1) + " Shape"; }
+auto getEnvAttackName(size_t i) { return juce::String("Env ") + juce::String(static_cast<int>(i) + 1) + " Attack ms"; }
+auto getEnvReleaseName(size_t i) { return juce::String("Env ") + juce::String(static_cast<int>(i) + 1) + " Release ms"; }
+auto getModSourceName(size_t i) { return juce::String("Mod ") + juce::String(static_cast<int>(i) + 1) + " Source"; }
+auto getModTargetName(size_t i) { return juce::String("Mod ") + juce::String(static_cast<int>(i) + 1) + " Target"; }
+auto getModDepthName(size_t i) { return juce::String("Mod ") + juce::String(static_cast<int>(i) + 1) + " Depth %"; }
+
+auto getLfoShapeChoices()
+{
+    return juce::StringArray
+    {
+        "Sine",
+        "Triangle",
+        "Saw",
+        "Square",
+    };
+}
+
+auto getModSourceChoices()
+{
+    juce::StringArray choices { "None" };
+    for (size_t i = 0; i < ModulationMatrix::numLfos; ++i)
+        choices.add("LFO " + juce::String(static_cast<int>(i) + 1));
+    for (size_t i = 0; i < ModulationMatrix::numEnvelopes; ++i)
+        choices.add("Env " + juce::String(static_cast<int>(i) + 1));
+    return choices;
+}
+
+/*
+ every float parameter the DSP reads through a smoother can be modulated.
+ the order here is the order of the "Mod n Target" choices, so only ever append to it.
+ */
+auto getModTargetNames()
+{
+    return juce::StringArray
+    {
+        getPhaserRateName(),
+        getPhaserCenterFreqName(),
+        getPhaserDepthName(),
+        getPhaserFeedbackName(),
+        getPhaserMixName(),
+        getChorusRateName(),
+        getChorusDepthName(),
+        getChorusCenterDelayName(),
+        getChorusFeedbackName(),
+        getChorusMixName(),
+        getOverdriveSaturationName(),
+        getLadderFilterCutoffName(),
+        getLadderFilterResonanceName(),
+        getLadderFilterDriveName(),
+        getGeneralFilterFreqName(),
+        getGeneralFilterQualityName(),
+        getGeneralFilterGainName(),
+        getGlobalMixName(),
+        getPreHpfFreqName(),
+        getPreLpfFreqName(),
+        getPostHpfFreqName(),
+        getPostLpfFreqName(),
+        getConvolutionMixName(),
+        getConvolutionGainName(),
+        getCrossover1FreqName(),
+        getCrossover2FreqName(),
+        getCrossover3FreqName(),
+        getDynamicsThresholdName(),
+        getDynamicsRatioName(),
+        getDynamicsAttackName(),
+        getDynamicsReleaseName(),
+        getDynamicsMakeupName(),
+        getReverbSizeName(),
+        getReverbDecayName(),
+        getReverbDampingName(),
+        getReverbModDepthName(),
+        getReverbMixName(),
+    };
+}
+
+auto getModTargetChoices()
+{
+    juce::StringArray choices { "None" };
+    choices.addArray(getModTargetNames());
+    return choices;
+}
+
 //==============================================================================
 Project13AudioProcessor::Project13AudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -81,7 +335,7 @@ Project13AudioProcessor::Project13AudioProcessor()
     {
         dspOrder[i] = static_cast<DSP_Option>(i);
     }
-    restoreDspOrderFifo.push(dspOrder);
+    publishDspOrder(dspOrder);
     /*
      cached params
      */
@@ -108,6 +362,44 @@ Project13AudioProcessor::Project13AudioProcessor()
         &generalFilterFreqHz,
         &generalFilterQuality,
         &generalFilterGain,
+
+        &morphAmount,
+        &morphSwitchPoint,
+
+        &globalMixPercent,
+
+        &preHpfFreqHz,
+        &preLpfFreqHz,
+        &postHpfFreqHz,
+        &postLpfFreqHz,
+
+        &convolutionMixPercent,
+        &convolutionGain,
+
+        &linearPhaseEQLowFreqHz,
+        &linearPhaseEQLowGain,
+        &linearPhaseEQMidFreqHz,
+        &linearPhaseEQMidQuality,
+        &linearPhaseEQMidGain,
+        &linearPhaseEQHighFreqHz,
+        &linearPhaseEQHighGain,
+
+        &crossover1FreqHz,
+        &crossover2FreqHz,
+        &crossover3FreqHz,
+
+        &dynamicsThresholdDb,
+        &dynamicsRatio,
+        &dynamicsAttackMs,
+        &dynamicsReleaseMs,
+        &dynamicsMakeupDb,
+        &dynamicsLookaheadMs,
+
+        &reverbSizePercent,
+        &reverbDecaySeconds,
+        &reverbDampingPercent,
+        &reverbModDepthPercent,
+        &reverbMixPercent,
     };
     auto floatNameFuncs = std::array
     {
@@ -132,6 +424,44 @@ Project13AudioProcessor::Project13AudioProcessor()
         &getGeneralFilterFreqName,
         &getGeneralFilterQualityName,
         &getGeneralFilterGainName,
+
+        &getMorphAmountName,
+        &getMorphSwitchPointName,
+
+        &getGlobalMixName,
+
+        &getPreHpfFreqName,
+        &getPreLpfFreqName,
+        &getPostHpfFreqName,
+        &getPostLpfFreqName,
+
+        &getConvolutionMixName,
+        &getConvolutionGainName,
+
+        &getLinearPhaseEQLowFreqName,
+        &getLinearPhaseEQLowGainName,
+        &getLinearPhaseEQMidFreqName,
+        &getLinearPhaseEQMidQualityName,
+        &getLinearPhaseEQMidGainName,
+        &getLinearPhaseEQHighFreqName,
+        &getLinearPhaseEQHighGainName,
+
+        &getCrossover1FreqName,
+        &getCrossover2FreqName,
+        &getCrossover3FreqName,
+
+        &getDynamicsThresholdName,
+        &getDynamicsRatioName,
+        &getDynamicsAttackName,
+        &getDynamicsReleaseName,
+        &getDynamicsMakeupName,
+        &getDynamicsLookaheadName,
+
+        &getReverbSizeName,
+        &getReverbDecayName,
+        &getReverbDampingName,
+        &getReverbModDepthName,
+        &getReverbMixName,
     };
 
     auto choiceParams = std::array
@@ -139,6 +469,36 @@ Project13AudioProcessor::Project13AudioProcessor()
         &ladderFilterMode,
 
         &generalFilterMode,
+        &generalFilterEngine,
+
+        &internalRateCap,
+        &linearPhaseEQFFTSize,
+
+        &phaserMidSide,
+        &chorusMidSide,
+        &overdriveMidSide,
+        &ladderFilterMidSide,
+        &generalFilterMidSide,
+        &convolutionMidSide,
+        &linearPhaseEQMidSide,
+        &dynamicsMidSide,
+        &reverbMidSide,
+
+        &preHpfSlope,
+        &preLpfSlope,
+        &postHpfSlope,
+        &postLpfSlope,
+
+        &multibandMode,
+        &phaserBand,
+        &chorusBand,
+        &overdriveBand,
+        &ladderFilterBand,
+        &generalFilterBand,
+        &convolutionBand,
+        &linearPhaseEQBand,
+        &dynamicsBand,
+        &reverbBand,
     };
 
     auto choiceNameFuncs = std::array
@@ -146,6 +506,36 @@ Project13AudioProcessor::Project13AudioProcessor()
         &getLadderFilterModeName,
 
         &getGeneralFilterModeName,
+        &getGeneralFilterEngineName,
+
+        &getInternalRateCapName,
+        &getLinearPhaseEQFFTSizeName,
+
+        &getPhaserMidSideName,
+        &getChorusMidSideName,
+        &getOverdriveMidSideName,
+        &getLadderFilterMidSideName,
+        &getGeneralFilterMidSideName,
+        &getConvolutionMidSideName,
+        &getLinearPhaseEQMidSideName,
+        &getDynamicsMidSideName,
+        &getReverbMidSideName,
+
+        &getPreHpfSlopeName,
+        &getPreLpfSlopeName,
+        &getPostHpfSlopeName,
+        &getPostLpfSlopeName,
+
+        &getMultibandModeName,
+        &getPhaserBandName,
+        &getChorusBandName,
+        &getOverdriveBandName,
+        &getLadderFilterBandName,
+        &getGeneralFilterBandName,
+        &getConvolutionBandName,
+        &getLinearPhaseEQBandName,
+        &getDynamicsBandName,
+        &getReverbBandName,
     };
 
     auto bypassParams = std::array
@@ -155,6 +545,10 @@ Project13AudioProcessor::Project13AudioProcessor()
         &overdriveBypass,
         &ladderFilterBypass,
         &generalFilterBypass,
+        &convolutionBypass,
+        &linearPhaseEQBypass,
+        &dynamicsBypass,
+        &reverbBypass,
     };
 
     auto bypassNameFuncs = std::array
@@ -164,6 +558,28 @@ Project13AudioProcessor::Project13AudioProcessor()
         &getOverdriveBypassName,
         &getLadderFilterBypassName,
         &getGeneralFilterBypassName,
+        &getConvolutionBypassName,
+        &getLinearPhaseEQBypassName,
+        &getDynamicsBypassName,
+        &getReverbBypassName,
+    };
+
+    auto toggleParams = std::array
+    {
+        &morphEnabled,
+        &doublePrecisionFilters,
+        &midSideMode,
+        &preFilterBypass,
+        &postFilterBypass,
+    };
+
+    auto toggleNameFuncs = std::array
+    {
+        &getMorphEnabledName,
+        &getDoublePrecisionFiltersName,
+        &getMidSideModeName,
+        &getPreFilterBypassName,
+        &getPostFilterBypassName,
     };
 
     auto intParams = std::array
@@ -178,13 +594,147 @@ Project13AudioProcessor::Project13AudioProcessor()
 
     initCachedParams<juce::AudioParameterInt*>(intParams, intFuncs);
     initCachedParams<juce::AudioParameterBool*>(bypassParams, bypassNameFuncs);
+    initCachedParams<juce::AudioParameterBool*>(toggleParams, toggleNameFuncs);
     jassert(floatParams.size() == floatNameFuncs.size());
     initCachedParams<juce::AudioParameterFloat*>(floatParams, floatNameFuncs);
     initCachedParams<juce::AudioParameterChoice*>(choiceParams, choiceNameFuncs);
+
+    for (auto* param : getParameters())
+    {
+        if (auto* rap = dynamic_cast<juce::RangedAudioParameter*>(param))
+        {
+            allParams.push_back(rap);
+            paramHashes.push_back(PresetBank::hashParamID(rap->getParameterID()));
+        }
+    }
+
+    /*
+     every ParamSnapshot loop indexes values[] by position in allParams.
+     a layout that outgrows the snapshot would write past it, so this stops every build, not just debug ones.
+     */
+    if (allParams.size() > maxNumParams)
+    {
+        jassertfalse;
+        std::abort();
+    }
+
+    paramIndexForParameter.assign(static_cast<size_t>(getParameters().size()), 0);
+    for (size_t i = 0; i < allParams.size(); ++i)
+    {
+        auto* param = allParams[i];
+        paramValues[i] = param->convertFrom0to1(param->getValue());
+        latestParamValues[i].store(paramValues[i], std::memory_order_relaxed);
+        paramChanged[i].store(false, std::memory_order_relaxed);
+        paramIndexForParameter[static_cast<size_t>(param->getParameterIndex())] = i;
+        param->addListener(this);
+    }
+
+    /*
+     everything the audio thread reads out of liveParams is looked up by index once, here.
+     */
+    auto smoothers = getSmoothers();
+    auto paramsNeedingSmoothing = getParamsNeedingSmoothing();
+    jassert(smoothers.size() == paramsNeedingSmoothing.size());
+    for (size_t i = 0; i < smoothers.size(); ++i)
+        smoothedParams.push_back({ smoothers[i], getParamIndex(paramsNeedingSmoothing[i]) });
+
+    for (size_t i = 0; i < bypassParams.size(); ++i)
+        bypassParamIndices[i] = getParamIndex(*bypassParams[i]);
+
+    ladderFilterModeIndex = getParamIndex(ladderFilterMode);
+    generalFilterModeIndex = getParamIndex(generalFilterMode);
+    generalFilterEngineIndex = getParamIndex(generalFilterEngine);
+
+    //same order as DSP_Option
+    auto midSideParams = std::array { phaserMidSide, chorusMidSide, overdriveMidSide, ladderFilterMidSide, generalFilterMidSide, convolutionMidSide, linearPhaseEQMidSide, dynamicsMidSide, reverbMidSide };
+    for (size_t i = 0; i < midSideParams.size(); ++i)
+        midSideParamIndices[i] = getParamIndex(midSideParams[i]);
+    midSideModeIndex = getParamIndex(midSideMode);
+
+    //same order as DSP_Option
+    auto bandParams = std::array { phaserBand, chorusBand, overdriveBand, ladderFilterBand, generalFilterBand, convolutionBand, linearPhaseEQBand, dynamicsBand, reverbBand };
+    for (size_t i = 0; i < bandParams.size(); ++i)
+        bandParamIndices[i] = getParamIndex(bandParams[i]);
+    multibandModeIndex = getParamIndex(multibandMode);
+
+    prePostFilterParamIndices[0] = { getParamIndex(preHpfSlope), getParamIndex(preLpfSlope), getParamIndex(preFilterBypass) };
+    prePostFilterParamIndices[1] = { getParamIndex(postHpfSlope), getParamIndex(postLpfSlope), getParamIndex(postFilterBypass) };
+
+    linearPhaseEQParamIndices = { getParamIndex(linearPhaseEQLowFreqHz), getParamIndex(linearPhaseEQLowGain),
+                                  getParamIndex(linearPhaseEQMidFreqHz), getParamIndex(linearPhaseEQMidQuality), getParamIndex(linearPhaseEQMidGain),
+                                  getParamIndex(linearPhaseEQHighFreqHz), getParamIndex(linearPhaseEQHighGain) };
+
+    auto getIndexForName = [this](const juce::String& name)
+    {
+        auto* param = apvts.getParameter(name);
+        jassert(param != nullptr);
+        return getParamIndex(param);
+    };
+
+    for (size_t i = 0; i < ModulationMatrix::numLfos; ++i)
+    {
+        modParamIndices.lfoRate[i] = getIndexForName(getLfoRateName(i));
+        modParamIndices.lfoShape[i] = getIndexForName(getLfoShapeName(i));
+    }
+
+    for (size_t i = 0; i < ModulationMatrix::numEnvelopes; ++i)
+    {
+        modParamIndices.envAttack[i] = getIndexForName(getEnvAttackName(i));
+        modParamIndices.envRelease[i] = getIndexForName(getEnvReleaseName(i));
+    }
+
+    for (size_t i = 0; i < ModulationMatrix::numRoutings; ++i)
+    {
+        modParamIndices.routeSource[i] = getIndexForName(getModSourceName(i));
+        modParamIndices.routeTarget[i] = getIndexForName(getModTargetName(i));
+        modParamIndices.routeDepth[i] = getIndexForName(getModDepthName(i));
+    }
+
+    auto modTargetNames = getModTargetNames();
+    jassert(static_cast<size_t>(modTargetNames.size()) <= ModulationMatrix::maxNumTargets);
+    for (const auto& name : modTargetNames)
+    {
+        auto* param = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter(name));
+        jassert(param != nullptr);
+        modTargetParamIndices[numModTargets] = getParamIndex(param);
+        modTargetRanges[numModTargets] = &param->range;
+        ++numModTargets;
+    }
+
+    /*
+     float parameters are interpolated while morphing, choices and bools switch at the switch point.
+     the morph controls themselves and the selected tab are never morphed.
+     */
+    for (auto* param : allParams)
+    {
+        if (param == morphAmount || param == morphSwitchPoint || param == morphEnabled || param == selectedTab || param == doublePrecisionFilters)
+            morphBehaviours.push_back(MorphBehaviour::ignore);
+        else if (dynamic_cast<juce::AudioParameterFloat*>(param) != nullptr)
+            morphBehaviours.push_back(MorphBehaviour::interpolate);
+        else
+            morphBehaviours.push_back(MorphBehaviour::switchAtPoint);
+    }
+
+    presetBank.open(getPresetBankFile(), paramHashes);
+
+    startTimerHz(10);
+}
+
+size_t Project13AudioProcessor::getParamIndex(const juce::RangedAudioParameter* param) const
+{
+    auto it = std::find(allParams.begin(), allParams.end(), param);
+    jassert(it != allParams.end());
+    return static_cast<size_t>(std::distance(allParams.begin(), it));
 }
 
 Project13AudioProcessor::~Project13AudioProcessor()
 {
+    stopTimer();
+    //a load that is still running would hand its result to this instance
+    impulseResponseLoader->removeJobs(this, 10000);
+
+    for (auto* param : allParams)
+        param->removeListener(this);
 }
 
 //==============================================================================
@@ -222,157 +772,1171 @@ bool Project13AudioProcessor::isMidiEffect() const
 
 double Project13AudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    //the convolution rings on for as long as its impulse response, the reverb for its decay
+    auto tail = impulseResponseSeconds.load(std::memory_order_relaxed);
+    if (!reverbBypass->get())
+        tail = juce::jmax(tail, static_cast<double>(reverbDecaySeconds->get()));
+
+    return tail;
 }
 
 int Project13AudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    const juce::ScopedLock sl(programLock);
+    return juce::jmax(1, presetBank.getNumPresets());   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                                        // so this should be at least 1, even if you're not really implementing programs.
 }
 
 int Project13AudioProcessor::getCurrentProgram()
 {
-    return 0;
+    const juce::ScopedLock sl(programLock);
+    return currentProgram;
 }
 
 void Project13AudioProcessor::setCurrentProgram (int index)
 {
+    /*
+     the preset is read straight out of the memory-mapped bank into a snapshot and handed to the audio thread.
+     parameters the preset doesn't know about keep their current values.
+     */
+    auto snapshot = captureParamSnapshot();
+    std::array<juce::uint8, std::tuple_size<DSP_Order>::value> order;
+
+    const juce::ScopedLock pl(programLock);
+    if (!presetBank.readPreset(index, snapshot.values.data(), order.data(), order.size()))
+        return;
+
+    DSP_Order newOrder;
+    for (size_t i = 0; i < newOrder.size(); ++i)
+        newOrder[i] = static_cast<DSP_Option>(order[i]);
+
+    completeDspOrder(newOrder);
+    if (isValidDspOrder(newOrder))
+        snapshot.dspOrder = newOrder;
+
+    currentProgram = index;
+
+    //the parameters follow once the audio thread has the program, see syncParamsToProgram()
+    pendingProgram = snapshot;
+    pendingProgramSerial = ++lastProgramSerial;
+
+    //the editor shows the preset's order right away.  still under programLock, so programs are published in serial order
+    const juce::SpinLock::ScopedLockType sl(dspOrderRequestLock);
+    requestedChain.program = snapshot;
+    requestedChain.programSerial = pendingProgramSerial;
+    publishDspOrder(snapshot.dspOrder);
 }
 
 const juce::String Project13AudioProcessor::getProgramName (int index)
 {
-    return {};
+    const juce::ScopedLock sl(programLock);
+    return presetBank.getPresetName(index);
 }
 
 void Project13AudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    {
+        const juce::ScopedLock sl(programLock);
+        std::vector<PresetBank::Preset> presets;
+        if (!juce::isPositiveAndBelow(index, presetBank.getNumPresets()) || !readAllPresets(presets))
+            return;
+
+        presets[static_cast<size_t>(index)].name = newName;
+        rewritePresetBank(presets);
+    }
+
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
 }
 
-//==============================================================================
-void Project13AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+juce::StringArray Project13AudioProcessor::getPresetNames() const
 {
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
+    juce::StringArray names;
+    const juce::ScopedLock sl(programLock);
+    for (int i = 0; i < presetBank.getNumPresets(); ++i)
+        names.add(presetBank.getPresetName(i));
 
-    leftChannel.prepare(spec);
-    rightChannel.prepare(spec);
+    return names;
+}
+
+bool Project13AudioProcessor::savePresetToBank(const juce::String& name)
+{
+    auto snapshot = captureParamSnapshot();
+
+    PresetBank::Preset preset;
+    preset.name = name;
+    preset.values.assign(snapshot.values.begin(), snapshot.values.begin() + allParams.size());
+    for (auto option : snapshot.dspOrder)
+        preset.order.push_back(static_cast<juce::uint8>(option));
 
-    for (auto smoother : getSmoothers())
     {
-        smoother->reset(sampleRate, 0.005); //5 ms smoothing time
+        //a preset that can't be read would be dropped from the rewritten bank, so nothing is saved instead
+        const juce::ScopedLock sl(programLock);
+        std::vector<PresetBank::Preset> presets;
+        if (!readAllPresets(presets))
+            return false;
+
+        presets.push_back(preset);
+        if (!rewritePresetBank(presets))
+            return false;
+
+        currentProgram = static_cast<int>(presets.size()) - 1;
     }
 
-    updateSmoothersFromParams(1, SmootherUpdateMode::initialize);
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+    return true;
 }
 
-std::vector<juce::SmoothedValue<float>*> Project13AudioProcessor::getSmoothers()
+juce::File Project13AudioProcessor::getPresetBankFile()
 {
-    auto smoothers = std::vector
-    {
-        &phaserRateHzSmoother,
-        &phaserCenterFreqHzSmoother,
-        &phaserDepthPercentSmoother,
-        &phaserFeedbackPercentSmoother,
-        &phaserMixPercentSmoother,
-        &chorusRateHzSmoother,
-        &chorusDepthPercentSmoother,
-        &chorusCenterDelayMsSmoother,
-        &chorusFeedbackPercentSmoother,
-        &chorusMixPercentSmoother,
-        &overdriveSaturationSmoother,
-        &ladderFilterCutoffHzSmoother,
-        &ladderFilterResonanceSmoother,
-        &ladderFilterDriveSmoother,
-        &generalFilterFreqHzSmoother,
-        &generalFilterQualitySmoother,
-        &generalFilterGainSmoother,
-    };
-
-    return smoothers;
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile(JucePlugin_Manufacturer)
+        .getChildFile(JucePlugin_Name)
+        .getChildFile("Presets.p13bank");
 }
 
-void Project13AudioProcessor::updateSmoothersFromParams(int numSamplesToSkip, SmootherUpdateMode init)
+bool Project13AudioProcessor::readAllPresets(std::vector<PresetBank::Preset>& presets) const
 {
-    auto paramsNeedingSmoothing = std::array
+    presets.clear();
+    presets.reserve(static_cast<size_t>(presetBank.getNumPresets()));
+
+    for (int i = 0; i < presetBank.getNumPresets(); ++i)
     {
-        phaserRateHz,
-        phaserCenterFreqHz,
-        phaserDepthPercent,
-        phaserFeedbackPercent,
-        phaserMixPercent,
-        chorusRateHz,
-        chorusDepthPercent,
-        chorusCenterDelayMs,
-        chorusFeedbackPercent,
-        chorusMixPercent,
-        overdriveSaturation,
-        ladderFilterCutoffHz,
-        ladderFilterResonance,
-        ladderFilterDrive,
-        generalFilterFreqHz,
-        generalFilterQuality,
-        generalFilterGain,
-    };
+        PresetBank::Preset preset;
+        preset.name = presetBank.getPresetName(i);
+        preset.order.resize(std::tuple_size<DSP_Order>::value);
 
-    auto smoothers = getSmoothers();
+        //parameters the stored preset predates get their default value
+        for (auto* param : allParams)
+            preset.values.push_back(param->convertFrom0to1(param->getDefaultValue()));
 
-    jassert(smoothers.size() == paramsNeedingSmoothing.size());
+        if (!presetBank.readPreset(i, preset.values.data(), preset.order.data(), preset.order.size()))
+            return false;
 
-    for (size_t i = 0; i < smoothers.size(); ++i)
-    {
-        auto smoother = smoothers[i];
-        auto param = paramsNeedingSmoothing[i];
+        //rewritten with the stages it predates filled in
+        DSP_Order order;
+        for (size_t j = 0; j < order.size(); ++j)
+            order[j] = static_cast<DSP_Option>(preset.order[j]);
 
-        if (init == SmootherUpdateMode::initialize)
-            smoother->setCurrentAndTargetValue(param->get());
-        else
-            smoother->setTargetValue(param->get());
+        completeDspOrder(order);
+        for (size_t j = 0; j < order.size(); ++j)
+            preset.order[j] = static_cast<juce::uint8>(order[j]);
 
-        smoother->skip(numSamplesToSkip);
+        presets.push_back(std::move(preset));
     }
+
+    return true;
 }
 
-std::vector<juce::RangedAudioParameter*>
-Project13AudioProcessor::getParamsForOptions(Project13AudioProcessor::DSP_Option option)
+bool Project13AudioProcessor::rewritePresetBank(const std::vector<PresetBank::Preset>& presets)
 {
-    switch (option)
-    {
-    case DSP_Option::Phase:
+    auto file = getPresetBankFile();
+
+    //the mapping must be released before the file can be replaced on Windows
+    presetBank.close();
+    auto written = PresetBank::write(file, paramHashes, std::tuple_size<DSP_Order>::value, presets);
+    presetBank.open(file, paramHashes);
+    return written;
+}
+
+Project13AudioProcessor::ParamSnapshot Project13AudioProcessor::captureParamSnapshot() const
+{
+    ParamSnapshot snapshot;
+    for (size_t i = 0; i < allParams.size(); ++i)
     {
-        return
-        {
-            phaserRateHz,
-            phaserCenterFreqHz,
-            phaserDepthPercent,
-            phaserFeedbackPercent,
-            phaserMixPercent,
-            phaserBypass,
-        };
+        auto* param = allParams[i];
+        snapshot.values[i] = param->convertFrom0to1(param->getValue());
     }
-    case DSP_Option::Chorus:
+
+    const juce::SpinLock::ScopedLockType sl(dspOrderRequestLock);
+    snapshot.dspOrder = requestedChain.order;
+    return snapshot;
+}
+
+bool Project13AudioProcessor::isValidDspOrder(const DSP_Order& order)
+{
+    //every DSP_Option must appear exactly once
+    std::array<bool, std::tuple_size<DSP_Order>::value> seen {};
+    for (auto option : order)
     {
-        return
-        {
-            chorusRateHz,
-            chorusDepthPercent,
-            chorusCenterDelayMs,
-            chorusFeedbackPercent,
-            chorusMixPercent,
-            chorusBypass,
-        };
+        auto idx = static_cast<size_t>(option);
+        if (idx >= seen.size() || seen[idx])
+            return false;
+
+        seen[idx] = true;
     }
-    case DSP_Option::OverDrive:
+
+    return true;
+}
+
+void Project13AudioProcessor::completeDspOrder(DSP_Order& order)
+{
+    std::array<bool, std::tuple_size<DSP_Order>::value> seen {};
+    for (auto option : order)
     {
-        return
-        {
-            overdriveSaturation,
-            overdriveBypass,
-        };
+        if (auto idx = static_cast<size_t>(option); idx < seen.size())
+            seen[idx] = true;
     }
-    case DSP_Option::LadderFilter:
+
+    //anything that isn't a stage, e.g. END_OF_LIST or a preset bank's padding, is replaced by a missing one
+    size_t next = 0;
+    for (auto& option : order)
+    {
+        if (static_cast<size_t>(option) < seen.size())
+            continue;
+
+        while (next < seen.size() && seen[next])
+            ++next;
+        if (next == seen.size())
+            return;
+
+        option = static_cast<DSP_Option>(next);
+        seen[next] = true;
+    }
+}
+
+void Project13AudioProcessor::applyParamSnapshot(const ParamSnapshot& snapshot, juce::uint32 serial)
+{
+    //called on the audio thread, from applyChainRequest().  setCurrentProgram() already gave the editor the new order.
+    programSnapshot = snapshot;
+    activeProgramSerial = serial;
+    programOverridesParams = true;
+    appliedProgramSerial.store(serial, std::memory_order_release);
+}
+
+void Project13AudioProcessor::syncParamsToProgram()
+{
+    //message thread.  a newer program that the audio thread hasn't picked up yet is synced on a later tick
+    ParamSnapshot program;
+    juce::uint32 serial = 0;
+    {
+        const juce::ScopedLock sl(programLock);
+        if (pendingProgramSerial == 0 || appliedProgramSerial.load(std::memory_order_acquire) != pendingProgramSerial)
+            return;
+
+        program = pendingProgram;
+        serial = pendingProgramSerial;
+    }
+
+    //outside the lock, since the parameters notify the host
+    applyParamValues(program);
+
+    const juce::ScopedLock sl(programLock);
+    //a program set meanwhile, or a session loaded, replaced this one; it's synced, or cancelled, on its own
+    if (pendingProgramSerial != serial)
+        return;
+
+    syncedProgramSerial.store(serial, std::memory_order_release);
+    pendingProgramSerial = 0;
+}
+
+void Project13AudioProcessor::setDspOrder(const DSP_Order& newOrder)
+{
+    const juce::SpinLock::ScopedLockType sl(dspOrderRequestLock);
+    publishDspOrder(newOrder);
+}
+
+bool Project13AudioProcessor::readDspOrder(DSP_Order& order, bool evenIfUnchanged)
+{
+    if (!evenIfUnchanged)
+        return editorDspOrder.read(order);
+
+    editorDspOrder.readLatest(order);
+    return true;
+}
+
+void Project13AudioProcessor::publishDspOrder(const DSP_Order& newOrder)
+{
+    //the mailboxes have a single producer, so every caller holds dspOrderRequestLock, except the constructor
+    requestedChain.order = newOrder;
+    chainRequests.write(requestedChain);
+    editorDspOrder.write(newOrder);
+}
+
+void Project13AudioProcessor::applyChainRequest()
+{
+    //audio thread.  a program brings its own order, but the request's order is the latest one either way
+    ChainRequest request;
+    if (!chainRequests.read(request))
+        return;
+
+    if (request.programSerial != activeProgramSerial)
+        applyParamSnapshot(request.program, request.programSerial);
+
+#if VERIFY_BYPASS_FUNCTIONALITY
+    jassertfalse;
+#endif
+    if (isValidDspOrder(request.order))
+        dspOrder = request.order;
+}
+
+void Project13AudioProcessor::pushAudioCommand(const AudioCommand& command)
+{
+    const juce::ScopedLock sl(unsentAudioCommandsLock);
+
+    //anything still waiting goes first, so commands arrive in the order they were made
+    if (unsentAudioCommands.empty() && audioCommands.push(command))
+        return;
+
+    //a command that will never be sent can go, as long as nothing it owns is left behind
+    auto supersedes = [&command](const AudioCommand& waiting)
+    {
+        if (auto* newMorph = std::get_if<StoreMorphSnapshotCommand>(&command))
+        {
+            auto* oldMorph = std::get_if<StoreMorphSnapshotCommand>(&waiting);
+            return oldMorph != nullptr && oldMorph->update.slot == newMorph->update.slot;
+        }
+
+        return std::holds_alternative<SetConvolutionCommand>(command) && std::holds_alternative<SetConvolutionCommand>(waiting);
+    };
+
+    //the audio thread never saw the sets those commands carry, so they can be freed right away
+    std::vector<ConvolutionSet*> supersededSets;
+    for (const auto& waiting : unsentAudioCommands)
+    {
+        if (auto* oldConvolution = std::get_if<SetConvolutionCommand>(&waiting); oldConvolution != nullptr && supersedes(waiting))
+            supersededSets.push_back(oldConvolution->set);
+    }
+
+    unsentAudioCommands.erase(std::remove_if(unsentAudioCommands.begin(), unsentAudioCommands.end(), supersedes),
+                              unsentAudioCommands.end());
+    unsentAudioCommands.push_back(command);
+
+    for (auto* set : supersededSets)
+    {
+        convolutionSets.erase(std::remove_if(convolutionSets.begin(), convolutionSets.end(),
+                                             [set](const auto& owned) { return owned.get() == set; }),
+                              convolutionSets.end());
+    }
+}
+
+void Project13AudioProcessor::sendUnsentAudioCommands()
+{
+    const juce::ScopedLock sl(unsentAudioCommandsLock);
+
+    size_t numSent = 0;
+    while (numSent < unsentAudioCommands.size() && audioCommands.push(unsentAudioCommands[numSent]))
+        ++numSent;
+
+    unsentAudioCommands.erase(unsentAudioCommands.begin(), unsentAudioCommands.begin() + static_cast<std::ptrdiff_t>(numSent));
+}
+
+void Project13AudioProcessor::applyAudioCommands()
+{
+    applyChainRequest();
+
+    //a set that couldn't be handed back last time goes first; the commands wait until it has
+    if (unretiredConvolutionSet != nullptr)
+    {
+        if (!retiredConvolutionSets.push(unretiredConvolutionSet))
+            return;
+
+        unretiredConvolutionSet = nullptr;
+    }
+
+    AudioCommand command;
+    while (unretiredConvolutionSet == nullptr && audioCommands.pop(command))
+    {
+        if (auto* storeMorph = std::get_if<StoreMorphSnapshotCommand>(&command))
+        {
+            auto idx = static_cast<size_t>(storeMorph->update.slot);
+            morphSnapshots[idx] = storeMorph->update.snapshot;
+            morphSnapshotStored[idx] = storeMorph->update.valid;
+        }
+        else if (auto* setConvolution = std::get_if<SetConvolutionCommand>(&command))
+        {
+            //the convolvers pick the new set up in updateDSPFromParams(), before they process again
+            //the message thread frees retired sets on its next tick.  until it has, the replaced one is kept here
+            if (convolutionSet != nullptr && !retiredConvolutionSets.push(convolutionSet))
+                unretiredConvolutionSet = convolutionSet;
+
+            convolutionSet = setConvolution->set;
+        }
+        else if (auto* retireStage = std::get_if<RetireStageCommand>(&command))
+        {
+            //stageReady was cleared before this was sent, so no stage waiting for it is used from here on
+            acknowledgedRetirementSerial.store(retireStage->serial, std::memory_order_release);
+        }
+    }
+}
+
+//==============================================================================
+void Project13AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    /*
+     the impulse response is resampled to the processing rate and split for the host's block size when it is loaded,
+     so a new rate or a longer block needs a new load
+     */
+    const auto tailLead = ImpulseResponse::getTailLead(samplesPerBlock);
+    bool splitChanged = false;
+    {
+        const juce::ScopedLock irLock(impulseResponseLock);
+        splitChanged = impulseResponseSampleRate != sampleRate || impulseResponseTailLead != tailLead;
+    }
+    if (splitChanged)
+        requestImpulseResponse(sampleRate, tailLead);
+
+    //rendering offline, the whole render should hear the impulse response, so it isn't left to the timer
+    if (isNonRealtime() && juce::MessageManager::existsAndIsCurrentThread())
+    {
+        const auto timeout = juce::Time::getMillisecondCounter() + 10000;
+        while (numImpulseResponseJobs.load() > 0 && juce::Time::getMillisecondCounter() < timeout)
+            juce::Thread::sleep(1);
+
+        freeRetiredConvolutionSets();
+        installLoadedImpulseResponse();
+    }
+
+    //the audio thread isn't running, so whatever was queued while it was stopped is applied here
+    applyAudioCommands();
+
+    juce::dsp::ProcessSpec spec;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = samplesPerBlock;
+    spec.numChannels = 1;
+
+    for (auto smoother : getSmoothers())
+    {
+        smoother->reset(sampleRate, 0.005); //5 ms smoothing time
+    }
+
+    modulationMatrix.prepare(sampleRate);
+
+    updateSmoothersFromParams(1, SmootherUpdateMode::initialize);
+
+    //the first block shouldn't wait on the coefficient worker
+    requestedGeneralFilterSettings = getGeneralFilterSettings();
+    generalFilterCoefficients = makeGeneralFilterCoefficients(requestedGeneralFilterSettings);
+    generalFilterCoefficientRequests.start();
+
+    requestedPrePostFilterSettings = getPrePostFilterSettings();
+    prePostFilterCoefficients = makePrePostFilterCoefficients(requestedPrePostFilterSettings);
+    prePostFilters.reset();
+    prePostFiltersDouble.reset();
+    prePostFilters.setCoefficients(prePostFilterCoefficients);
+    prePostFiltersDouble.setCoefficients(prePostFilterCoefficients);
+    prePostFilterCoefficientRequests.start();
+
+    requestedCrossoverSettings = getCrossoverSettings();
+    crossoverCoefficients = makeCrossoverCoefficients(requestedCrossoverSettings);
+    crossoverCoefficientRequests.start();
+
+    /*
+     only stages that are enabled right now are prepared.
+     bypassed stages stay unallocated until the audio thread asks for them, see timerCallback().
+     */
+    const juce::ScopedLock sl(stagePreparationLock);
+    releaseAllStages();
+    stageSpec = spec;
+    hasStageSpec = true;
+
+    //switching the filter precision swaps the stage types, so it only takes effect here
+    if (isUsingDoublePrecision())
+        activePrecision = ChainPrecision::doubleChain;
+    else if (doublePrecisionFilters->get())
+        activePrecision = ChainPrecision::floatChainDoubleFilters;
+    else
+        activePrecision = ChainPrecision::floatChain;
+
+    //the resampled stages change the latency, so the cap only takes effect here too
+    decimationFactor = getDecimationFactor(sampleRate, internalRateCap->getIndex());
+    //the linear-phase EQ's FFT size, with the kernel the EQ starts from.  a later change is picked up by timerCallback()
+    linearPhaseEQFFTOrder = LinearPhaseKernel::minFFTOrder + linearPhaseEQFFTSize->getIndex();
+    requestedLinearPhaseEQSettings = getLinearPhaseEQSettings();
+    linearPhaseEQKernel = makeLinearPhaseEQKernel(requestedLinearPhaseEQSettings);
+    ++linearPhaseEQKernelSerial;
+    linearPhaseEQKernelRequests.start();
+    //and the dynamics stage's lookahead, also picked up by timerCallback() when it changes later
+    dynamicsLookaheadSamples = LookaheadCompressor<float>::getLookaheadSamples(sampleRate, dynamicsLookaheadMs->get());
+    maxDynamicsLookaheadSamples = LookaheadCompressor<float>::getLookaheadSamples(sampleRate, LookaheadCompressor<float>::maxLookaheadMs);
+
+    withActiveChain([this](auto& left, auto& right)
+    {
+        left.prepareLatencyCompensation(getMaxChainLatency());
+        right.prepareLatencyCompensation(getMaxChainLatency());
+    });
+
+    //enabled stages, in the order they are processed
+    std::vector<DSP_Option> layout;
+    size_t arenaBytes = 0;
+    for (auto option : dspOrder)
+    {
+        auto i = static_cast<size_t>(option);
+        if (option == DSP_Option::END_OF_LIST || stageReady[i].load() || isLiveStageOff(option))
+            continue;
+
+        stageReady[i].store(true);
+        layout.push_back(option);
+        arenaBytes += 2 * getStageArenaBytes(option, spec);
+    }
+
+    dspArena.reserve(arenaBytes);
+
+    //the left chain is processed completely before the right one, so it is laid out first
+    withActiveChain([&](auto& left, auto& right)
+    {
+        for (auto option : layout)
+            left.prepareStage(option, spec, dspArena);
+        for (auto option : layout)
+            right.prepareStage(option, spec, dspArena);
+    });
+
+    //once the layout is known, since it decides whether the linear-phase EQ's and the lookahead's latency count yet
+    setLatencySamples(getChainLatency());
+
+    //the dry path is delayed by whatever latency the plugin reports, see processBlockImpl()
+    jassert(getTotalNumOutputChannels() <= 2);
+    if (isUsingDoublePrecision())
+    {
+        globalMixDouble.prepare(2, maxSubBlockSize, getMaxChainLatency());
+        globalMixDouble.setLatency(getLatencySamples());
+    }
+    else
+    {
+        globalMix.prepare(2, maxSubBlockSize, getMaxChainLatency());
+        globalMix.setLatency(getLatencySamples());
+    }
+    previousGlobalMix = globalMixPercentSmoother.getCurrentValue() * 0.01f;
+
+    dualMono = false;
+    dualMonoMatchedSamples = 0;
+}
+
+size_t Project13AudioProcessor::getStageArenaBytes(DSP_Option option, const juce::dsp::ProcessSpec& spec) const
+{
+    switch (activePrecision)
+    {
+    case ChainPrecision::floatChain:
+        return MonoChannelDSP<float>::getStageArenaBytes(option, spec, getStageDecimation(option), linearPhaseEQFFTOrder, dynamicsLookaheadSamples);
+    case ChainPrecision::floatChainDoubleFilters:
+        return MonoChannelDSP<float, double>::getStageArenaBytes(option, spec, getStageDecimation(option), linearPhaseEQFFTOrder, dynamicsLookaheadSamples);
+    case ChainPrecision::doubleChain:
+        return MonoChannelDSP<double>::getStageArenaBytes(option, spec, getStageDecimation(option), linearPhaseEQFFTOrder, dynamicsLookaheadSamples);
+    }
+
+    jassertfalse;
+    return 0;
+}
+
+void Project13AudioProcessor::releaseAllStages()
+{
+    //called with stagePreparationLock held, while the audio thread isn't running
+    for (size_t i = 0; i < stageReady.size(); ++i)
+    {
+        auto option = static_cast<DSP_Option>(i);
+        stageReady[i].store(false);
+        stageRequested[i].store(false);
+        stageRetirementSerials[i] = 0;
+        withActiveChain([option](auto& left, auto& right)
+        {
+            left.releaseStage(option);
+            right.releaseStage(option);
+        });
+        lateStageArenas[i].release();
+    }
+
+    dspArena.release();
+}
+
+void Project13AudioProcessor::timerCallback()
+{
+    syncParamsToProgram();
+    sendUnsentAudioCommands();
+    freeRetiredConvolutionSets();
+    installLoadedImpulseResponse();
+
+    /*
+     the audio thread requests a stage when it is enabled but not prepared yet.
+     allocation happens here on the message thread, and the audio thread only starts using the stage once stageReady is set.
+     */
+    const juce::ScopedLock sl(stagePreparationLock);
+    if (!hasStageSpec)
+        return;
+
+    //a new FFT size takes effect by rebuilding the EQ below, from the same path as a stage enabled late
+    const auto fftOrder = LinearPhaseKernel::minFFTOrder + linearPhaseEQFFTSize->getIndex();
+    if (fftOrder != linearPhaseEQFFTOrder.load(std::memory_order_relaxed))
+    {
+        const auto retirement = retireStage(DSP_Option::LinearPhaseEQ);
+        if (retirement != StageRetirement::waiting)
+        {
+            //the audio thread requests a kernel of the new size from its next block, see updateLinearPhaseEQKernel()
+            linearPhaseEQFFTOrder.store(fftOrder, std::memory_order_relaxed);
+            if (retirement == StageRetirement::released)
+                requestStage(DSP_Option::LinearPhaseEQ);
+        }
+    }
+
+    //so is a new lookahead, which sizes the dynamics stage's delay line
+    const auto lookaheadSamples = LookaheadCompressor<float>::getLookaheadSamples(stageSpec.sampleRate, dynamicsLookaheadMs->get());
+    if (lookaheadSamples != dynamicsLookaheadSamples.load(std::memory_order_relaxed))
+    {
+        const auto retirement = retireStage(DSP_Option::Dynamics);
+        if (retirement != StageRetirement::waiting)
+        {
+            dynamicsLookaheadSamples.store(lookaheadSamples, std::memory_order_relaxed);
+            if (retirement == StageRetirement::released)
+                requestStage(DSP_Option::Dynamics);
+        }
+    }
+
+    for (size_t i = 0; i < stageReady.size(); ++i)
+    {
+        //a stage that is still being retired keeps its request for a later tick
+        if (stageRetirementSerials[i] != 0)
+            continue;
+
+        if (!stageRequested[i].exchange(false) || stageReady[i].load())
+            continue;
+
+        auto option = static_cast<DSP_Option>(i);
+        auto& arena = lateStageArenas[i];
+        arena.reserve(2 * getStageArenaBytes(option, stageSpec));
+        withActiveChain([&](auto& left, auto& right)
+        {
+            left.prepareStage(option, stageSpec, arena);
+            right.prepareStage(option, stageSpec, arena);
+        });
+        stageReady[i].store(true, std::memory_order_release);
+
+        //the audio thread counts the EQ's or the lookahead's latency from here on too, see getChainLatency()
+        if (option == DSP_Option::LinearPhaseEQ || option == DSP_Option::Dynamics)
+            setLatencySamples(getChainLatency());
+    }
+}
+
+Project13AudioProcessor::StageRetirement Project13AudioProcessor::retireStage(DSP_Option option)
+{
+    //called with stagePreparationLock held
+    auto i = static_cast<size_t>(option);
+    auto& serial = stageRetirementSerials[i];
+    if (serial == 0)
+    {
+        if (!stageReady[i].load())
+            return StageRetirement::notReady;
+
+        //the queue publishes the cleared flag with the command
+        stageReady[i].store(false);
+        serial = ++lastRetirementSerial;
+        pushAudioCommand(RetireStageCommand { serial });
+        return StageRetirement::waiting;
+    }
+
+    //commands are applied in order, so a later acknowledgement covers this one too
+    if (static_cast<juce::int32>(acknowledgedRetirementSerial.load(std::memory_order_acquire) - serial) < 0)
+        return StageRetirement::waiting;
+
+    serial = 0;
+    withActiveChain([option](auto& left, auto& right)
+    {
+        left.releaseStage(option);
+        right.releaseStage(option);
+    });
+    //a stage that was carved from dspArena leaves its space there unused until the next prepareToPlay()
+    lateStageArenas[i].release();
+    setLatencySamples(getChainLatency());
+    return StageRetirement::released;
+}
+
+void Project13AudioProcessor::loadImpulseResponse(const juce::File& file)
+{
+    int tailLead = 0;
+    {
+        const juce::ScopedLock sl(impulseResponseLock);
+        impulseResponseFile = file;
+        tailLead = impulseResponseTailLead;
+    }
+
+    requestImpulseResponse(getSampleRate(), tailLead);
+}
+
+juce::File Project13AudioProcessor::getImpulseResponseFile() const
+{
+    const juce::ScopedLock sl(impulseResponseLock);
+    return impulseResponseFile;
+}
+
+void Project13AudioProcessor::requestImpulseResponse(double sampleRate, int tailLead)
+{
+    const juce::ScopedLock sl(impulseResponseLock);
+
+    //whatever is still loading is out of date now
+    const auto request = ++impulseResponseRequest;
+    impulseResponseSampleRate = sampleRate;
+    impulseResponseTailLead = tailLead;
+
+    if (impulseResponseFile == juce::File())
+    {
+        loadedImpulseResponseRequest = request;
+        loadedImpulseResponse = nullptr;
+        return;
+    }
+
+    //there is nothing to resample to yet; prepareToPlay() asks again
+    if (sampleRate <= 0.0)
+        return;
+
+    ++numImpulseResponseJobs;
+    impulseResponseLoader->addJob(this, [this, file = impulseResponseFile, sampleRate, tailLead, request]
+    {
+        juce::String error;
+        auto impulseResponse = ImpulseResponseLibrary::get().load(file, sampleRate, tailLead, error);
+        if (impulseResponse == nullptr)
+            DBG(error);
+
+        const juce::ScopedLock irLock(impulseResponseLock);
+        if (request == impulseResponseRequest)
+        {
+            loadedImpulseResponseRequest = request;
+            loadedImpulseResponse = impulseResponse;
+        }
+        --numImpulseResponseJobs;
+    });
+}
+
+void Project13AudioProcessor::installLoadedImpulseResponse()
+{
+    ImpulseResponse::Ptr impulseResponse;
+    {
+        const juce::ScopedLock sl(impulseResponseLock);
+        if (loadedImpulseResponseRequest != impulseResponseRequest || loadedImpulseResponseRequest == installedImpulseResponseRequest)
+            return;
+
+        installedImpulseResponseRequest = loadedImpulseResponseRequest;
+        impulseResponse = std::move(loadedImpulseResponse);
+
+        //a file that couldn't be read isn't kept, so it isn't saved with the session either
+        if (impulseResponse == nullptr)
+            impulseResponseFile = juce::File();
+    }
+
+    std::unique_ptr<ConvolutionSet> set;
+    size_t tailBytes = 0;
+    if (impulseResponse != nullptr)
+    {
+        set = std::make_unique<ConvolutionSet>(impulseResponse);
+        for (const auto& tail : set->tails)
+            tailBytes += tail != nullptr ? tail->getSizeInBytes() : 0;
+    }
+
+    impulseResponseSeconds.store(impulseResponse != nullptr ? impulseResponse->getLengthSeconds() : 0.0);
+    convolutionTailBytes.store(tailBytes);
+    pushAudioCommand(SetConvolutionCommand { set.get() });
+    if (set != nullptr)
+        convolutionSets.push_back(std::move(set));
+}
+
+void Project13AudioProcessor::freeRetiredConvolutionSets()
+{
+    ConvolutionSet* retired = nullptr;
+    while (retiredConvolutionSets.pop(retired))
+    {
+        convolutionSets.erase(std::remove_if(convolutionSets.begin(), convolutionSets.end(),
+                                             [retired](const auto& set) { return set.get() == retired; }),
+                              convolutionSets.end());
+    }
+}
+
+Project13AudioProcessor::ConvolutionSet::ConvolutionSet(ImpulseResponse::Ptr ir)
+    : impulseResponse(std::move(ir))
+{
+    if (impulseResponse->getNumTailPartitions() == 0)
+        return;
+
+    //the same IR channel as the convolver on that processing channel, see PartitionedConvolver::setImpulseResponse()
+    for (size_t ch = 0; ch < tails.size(); ++ch)
+    {
+        tails[ch] = std::make_unique<ConvolutionTail>(impulseResponse, juce::jmin(static_cast<int>(ch), impulseResponse->getNumChannels() - 1));
+        ConvolutionScheduler::get().add(*tails[ch]);
+    }
+}
+
+Project13AudioProcessor::ConvolutionSet::~ConvolutionSet()
+{
+    for (auto& tail : tails)
+    {
+        if (tail != nullptr)
+            ConvolutionScheduler::get().remove(*tail);
+    }
+}
+
+void Project13AudioProcessor::requestStage(DSP_Option option)
+{
+    stageRequested[static_cast<size_t>(option)].store(true, std::memory_order_relaxed);
+}
+
+Project13AudioProcessor::MemoryReport Project13AudioProcessor::getMemoryReport() const
+{
+    const juce::ScopedLock sl(stagePreparationLock);
+
+    MemoryReport report;
+    report.instanceBytes = sizeof(*this);
+    report.arenaBytes = dspArena.getFootprint();
+    for (const auto& arena : lateStageArenas)
+        report.arenaBytes += arena.getFootprint();
+
+    report.totalBytes = report.instanceBytes;
+
+    for (size_t i = 0; i < stageReady.size(); ++i)
+    {
+        report.stageReady[i] = stageReady[i].load();
+        if (report.stageReady[i] && hasStageSpec)
+        {
+            //one instance per channel
+            report.stageBytes[i] = 2 * estimateStageBufferBytes(static_cast<DSP_Option>(i), stageSpec);
+            report.totalBytes += report.stageBytes[i];
+        }
+    }
+
+    return report;
+}
+
+size_t Project13AudioProcessor::estimateStageBufferBytes(DSP_Option option, const juce::dsp::ProcessSpec& spec) const
+{
+    /*
+     memory a prepared stage holds, per channel.
+     what comes from the arena is exact, what the juce::dsp filters allocate in prepare() is estimated.
+     */
+    auto bytes = getStageArenaBytes(option, spec);
+
+    switch (option)
+    {
+    case DSP_Option::OverDrive:
+        //juce::dsp::LadderFilter: filter state for 4 poles + feedback
+        return bytes + 5 * (activePrecision == ChainPrecision::floatChain ? sizeof(float) : sizeof(double));
+    case DSP_Option::Phase:
+    case DSP_Option::Chorus:
+    case DSP_Option::LadderFilter:
+    case DSP_Option::GeneralFilter:
+    case DSP_Option::LinearPhaseEQ:
+    case DSP_Option::Dynamics:
+    case DSP_Option::Reverb:
+        //every other stage keeps its state in the arena
+        return bytes;
+    case DSP_Option::Convolution:
+        //plus the tail's history and jobs.  the impulse response itself is shared between instances, so it isn't counted
+        return bytes + convolutionTailBytes.load() / 2;
+    case DSP_Option::END_OF_LIST:
+        break;
+    }
+
+    jassertfalse;
+    return 0;
+}
+
+juce::String Project13AudioProcessor::MemoryReport::toString() const
+{
+    juce::String s;
+    s << "instance: " << static_cast<juce::int64>(instanceBytes) << " bytes\n";
+    s << "arenas: " << static_cast<juce::int64>(arenaBytes) << " bytes\n";
+    for (size_t i = 0; i < stageBytes.size(); ++i)
+    {
+        s << "stage " << static_cast<int>(i) << ": "
+          << (stageReady[i] ? juce::String(static_cast<juce::int64>(stageBytes[i])) + " bytes" : juce::String("not allocated"))
+          << "\n";
+    }
+    s << "total: " << static_cast<juce::int64>(totalBytes) << " bytes";
+    return s;
+}
+
+std::vector<juce::SmoothedValue<float>*> Project13AudioProcessor::getSmoothers()
+{
+    auto smoothers = std::vector
+    {
+        &phaserRateHzSmoother,
+        &phaserCenterFreqHzSmoother,
+        &phaserDepthPercentSmoother,
+        &phaserFeedbackPercentSmoother,
+        &phaserMixPercentSmoother,
+        &chorusRateHzSmoother,
+        &chorusDepthPercentSmoother,
+        &chorusCenterDelayMsSmoother,
+        &chorusFeedbackPercentSmoother,
+        &chorusMixPercentSmoother,
+        &overdriveSaturationSmoother,
+        &ladderFilterCutoffHzSmoother,
+        &ladderFilterResonanceSmoother,
+        &ladderFilterDriveSmoother,
+        &generalFilterFreqHzSmoother,
+        &generalFilterQualitySmoother,
+        &generalFilterGainSmoother,
+        &globalMixPercentSmoother,
+        &preHpfFreqHzSmoother,
+        &preLpfFreqHzSmoother,
+        &postHpfFreqHzSmoother,
+        &postLpfFreqHzSmoother,
+        &convolutionMixPercentSmoother,
+        &convolutionGainSmoother,
+        &crossover1FreqHzSmoother,
+        &crossover2FreqHzSmoother,
+        &crossover3FreqHzSmoother,
+        &dynamicsThresholdDbSmoother,
+        &dynamicsRatioSmoother,
+        &dynamicsAttackMsSmoother,
+        &dynamicsReleaseMsSmoother,
+        &dynamicsMakeupDbSmoother,
+        &reverbSizePercentSmoother,
+        &reverbDecaySecondsSmoother,
+        &reverbDampingPercentSmoother,
+        &reverbModDepthPercentSmoother,
+        &reverbMixPercentSmoother,
+    };
+
+    return smoothers;
+}
+
+std::vector<juce::RangedAudioParameter*> Project13AudioProcessor::getParamsNeedingSmoothing()
+{
+    return
+    {
+        phaserRateHz,
+        phaserCenterFreqHz,
+        phaserDepthPercent,
+        phaserFeedbackPercent,
+        phaserMixPercent,
+        chorusRateHz,
+        chorusDepthPercent,
+        chorusCenterDelayMs,
+        chorusFeedbackPercent,
+        chorusMixPercent,
+        overdriveSaturation,
+        ladderFilterCutoffHz,
+        ladderFilterResonance,
+        ladderFilterDrive,
+        generalFilterFreqHz,
+        generalFilterQuality,
+        generalFilterGain,
+        globalMixPercent,
+        preHpfFreqHz,
+        preLpfFreqHz,
+        postHpfFreqHz,
+        postLpfFreqHz,
+        convolutionMixPercent,
+        convolutionGain,
+        crossover1FreqHz,
+        crossover2FreqHz,
+        crossover3FreqHz,
+        dynamicsThresholdDb,
+        dynamicsRatio,
+        dynamicsAttackMs,
+        dynamicsReleaseMs,
+        dynamicsMakeupDb,
+        reverbSizePercent,
+        reverbDecaySeconds,
+        reverbDampingPercent,
+        reverbModDepthPercent,
+        reverbMixPercent,
+    };
+}
+
+void Project13AudioProcessor::updateLiveParams()
+{
+    //a program the parameters don't match yet is read in their place, see syncParamsToProgram()
+    if (programOverridesParams && syncedProgramSerial.load(std::memory_order_acquire) == activeProgramSerial)
+        programOverridesParams = false;
+
+    //only the parameters that changed since the last sub-block are read, see parameterValueChanged()
+    if (paramsChanged.exchange(false, std::memory_order_acquire))
+    {
+        for (size_t i = 0; i < allParams.size(); ++i)
+        {
+            if (paramChanged[i].load(std::memory_order_relaxed) && paramChanged[i].exchange(false, std::memory_order_acquire))
+                paramValues[i] = latestParamValues[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    const auto& source = programOverridesParams ? programSnapshot.values : paramValues;
+    std::copy_n(source.begin(), allParams.size(), liveParams.values.begin());
+    liveParams.dspOrder = dspOrder;
+
+    if (!morphEnabled->get() || !morphSnapshotStored[0] || !morphSnapshotStored[1])
+        return;
+
+    /*
+     interpolate every float parameter between A and B.
+     choices, bools and the DSP_Order come from A below the switch point and from B at or above it.
+     */
+    const auto& a = morphSnapshots[0];
+    const auto& b = morphSnapshots[1];
+    auto amount = morphAmount->get() * 0.01f;
+    const auto& discreteSource = amount >= morphSwitchPoint->get() * 0.01f ? b : a;
+
+    for (size_t i = 0; i < allParams.size(); ++i)
+    {
+        switch (morphBehaviours[i])
+        {
+        case MorphBehaviour::interpolate:
+            liveParams.values[i] = a.values[i] + amount * (b.values[i] - a.values[i]);
+            break;
+        case MorphBehaviour::switchAtPoint:
+            liveParams.values[i] = discreteSource.values[i];
+            break;
+        case MorphBehaviour::ignore:
+            break;
+        }
+    }
+
+    if (isValidDspOrder(discreteSource.dspOrder))
+        liveParams.dspOrder = discreteSource.dspOrder;
+}
+
+void Project13AudioProcessor::parameterValueChanged(int parameterIndex, float)
+{
+    //any thread.  read back from the parameter, so the value is the one getValue() gives, e.g. snapped to a choice
+    auto index = paramIndexForParameter[static_cast<size_t>(parameterIndex)];
+    auto* param = allParams[index];
+    latestParamValues[index].store(param->convertFrom0to1(param->getValue()), std::memory_order_relaxed);
+    paramChanged[index].store(true, std::memory_order_release);
+    paramsChanged.store(true, std::memory_order_release);
+}
+
+void Project13AudioProcessor::applyModulation()
+{
+    for (size_t i = 0; i < ModulationMatrix::numLfos; ++i)
+    {
+        modulationMatrix.setLfo(i,
+                                liveParams.values[modParamIndices.lfoRate[i]],
+                                getLiveChoiceIndex(modParamIndices.lfoShape[i]));
+    }
+
+    for (size_t i = 0; i < ModulationMatrix::numEnvelopes; ++i)
+    {
+        modulationMatrix.setEnvelope(i,
+                                     liveParams.values[modParamIndices.envAttack[i]],
+                                     liveParams.values[modParamIndices.envRelease[i]]);
+    }
+
+    //choice 0 is "none" for both the source and the target
+    for (size_t i = 0; i < ModulationMatrix::numRoutings; ++i)
+    {
+        modulationMatrix.setRouting(i,
+                                    getLiveChoiceIndex(modParamIndices.routeSource[i]) - 1,
+                                    getLiveChoiceIndex(modParamIndices.routeTarget[i]) - 1,
+                                    liveParams.values[modParamIndices.routeDepth[i]] * 0.01f);
+    }
+
+    modulationMatrix.advance();
+
+    //offsets are applied in the normalised domain, so a depth of 100% sweeps the target's whole range
+    for (size_t t = 0; t < numModTargets; ++t)
+    {
+        auto offset = modulationMatrix.getOffset(t);
+        if (offset == 0.f)
+            continue;
+
+        const auto& range = *modTargetRanges[t];
+        auto& value = liveParams.values[modTargetParamIndices[t]];
+        value = range.convertFrom0to1(juce::jlimit(0.f, 1.f, range.convertTo0to1(value) + offset));
+    }
+}
+
+void Project13AudioProcessor::updateSmoothersFromParams(int numSamplesToSkip, SmootherUpdateMode init)
+{
+    updateLiveParams();
+    applyModulation();
+
+    for (auto& [smoother, paramIndex] : smoothedParams)
+    {
+        auto value = liveParams.values[paramIndex];
+
+        if (init == SmootherUpdateMode::initialize)
+            smoother->setCurrentAndTargetValue(value);
+        else
+            smoother->setTargetValue(value);
+
+        smoother->skip(numSamplesToSkip);
+    }
+}
+
+void Project13AudioProcessor::storeMorphSnapshot(MorphSlot slot)
+{
+    MorphSnapshotUpdate update;
+    update.slot = slot;
+    update.snapshot = captureParamSnapshot();
+
+    auto idx = static_cast<size_t>(slot);
+    storedMorphSnapshots[idx] = update.snapshot;
+    storedMorphSnapshotValid[idx] = true;
+    pushAudioCommand(StoreMorphSnapshotCommand { update });
+}
+
+std::array<bool, static_cast<size_t>(Project13AudioProcessor::DSP_Option::END_OF_LIST)>
+Project13AudioProcessor::getStagesMovedAfterBands(const DSP_Order& order) const
+{
+    std::array<bool, static_cast<size_t>(DSP_Option::END_OF_LIST)> moved {};
+    if (multibandMode->getIndex() == 0)
+        return moved;
+
+    //the same test MonoChannelDSP::process() makes, on the parameters instead of liveParams
+    auto isOnBand = [this](DSP_Option option)
+    {
+        if (option == DSP_Option::END_OF_LIST)
+            return false;
+
+        const auto* param = allParams[bandParamIndices[static_cast<size_t>(option)]];
+        return param->convertFrom0to1(param->getValue()) >= 1.f;
+    };
+
+    auto firstBandStage = order.size();
+    size_t lastBandStage = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (isOnBand(order[i]))
+        {
+            firstBandStage = juce::jmin(firstBandStage, i);
+            lastBandStage = i;
+        }
+    }
+
+    for (size_t i = firstBandStage + 1; i < lastBandStage; ++i)
+        moved[i] = order[i] != DSP_Option::END_OF_LIST && !isOnBand(order[i]);
+
+    return moved;
+}
+
+std::vector<juce::RangedAudioParameter*>
+Project13AudioProcessor::getParamsForOptions(Project13AudioProcessor::DSP_Option option)
+{
+    switch (option)
+    {
+    case DSP_Option::Phase:
+    {
+        return
+        {
+            phaserRateHz,
+            phaserCenterFreqHz,
+            phaserDepthPercent,
+            phaserFeedbackPercent,
+            phaserMixPercent,
+            phaserMidSide,
+            phaserBand,
+            phaserBypass,
+        };
+    }
+    case DSP_Option::Chorus:
+    {
+        return
+        {
+            chorusRateHz,
+            chorusDepthPercent,
+            chorusCenterDelayMs,
+            chorusFeedbackPercent,
+            chorusMixPercent,
+            chorusMidSide,
+            chorusBand,
+            chorusBypass,
+        };
+    }
+    case DSP_Option::OverDrive:
+    {
+        return
+        {
+            overdriveSaturation,
+            overdriveMidSide,
+            overdriveBand,
+            overdriveBypass,
+        };
+    }
+    case DSP_Option::LadderFilter:
     {
         return
         {
@@ -380,6 +1944,8 @@ Project13AudioProcessor::getParamsForOptions(Project13AudioProcessor::DSP_Option
             ladderFilterCutoffHz,
             ladderFilterResonance,
             ladderFilterDrive,
+            ladderFilterMidSide,
+            ladderFilterBand,
             ladderFilterBypass,
         };
     }
@@ -388,12 +1954,72 @@ Project13AudioProcessor::getParamsForOptions(Project13AudioProcessor::DSP_Option
         return
         {
             generalFilterMode,
+            generalFilterEngine,
             generalFilterFreqHz,
             generalFilterQuality,
             generalFilterGain,
+            generalFilterMidSide,
+            generalFilterBand,
             generalFilterBypass,
         };
     }
+    case DSP_Option::Convolution:
+    {
+        return
+        {
+            convolutionMixPercent,
+            convolutionGain,
+            convolutionMidSide,
+            convolutionBand,
+            convolutionBypass,
+        };
+    }
+    case DSP_Option::LinearPhaseEQ:
+    {
+        return
+        {
+            linearPhaseEQLowFreqHz,
+            linearPhaseEQLowGain,
+            linearPhaseEQMidFreqHz,
+            linearPhaseEQMidQuality,
+            linearPhaseEQMidGain,
+            linearPhaseEQHighFreqHz,
+            linearPhaseEQHighGain,
+            linearPhaseEQFFTSize,
+            linearPhaseEQMidSide,
+            linearPhaseEQBand,
+            linearPhaseEQBypass,
+        };
+    }
+    case DSP_Option::Dynamics:
+    {
+        return
+        {
+            dynamicsThresholdDb,
+            dynamicsRatio,
+            dynamicsAttackMs,
+            dynamicsReleaseMs,
+            dynamicsMakeupDb,
+            dynamicsLookaheadMs,
+            dynamicsMidSide,
+            dynamicsBand,
+            dynamicsBypass,
+        };
+    }
+    case DSP_Option::Reverb:
+    {
+        return
+        {
+            reverbSizePercent,
+            reverbDecaySeconds,
+            reverbDampingPercent,
+            reverbModDepthPercent,
+            reverbMixPercent,
+            reverbMidSide,
+            reverbBand,
+            reverbBypass,
+        };
+    }
     case DSP_Option::END_OF_LIST:
         break;
     }
@@ -402,30 +2028,165 @@ Project13AudioProcessor::getParamsForOptions(Project13AudioProcessor::DSP_Option
     return {};
 }
 
-void Project13AudioProcessor::MonoChannelDSP::prepare(const juce::dsp::ProcessSpec& spec)
+template<typename SampleType, typename FilterSampleType>
+StageProcessor<SampleType>* Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::getProcessor(DSP_Option option)
+{
+    switch (option)
+    {
+    case DSP_Option::Phase:
+        return &phaser;
+    case DSP_Option::Chorus:
+        return &chorus;
+    case DSP_Option::OverDrive:
+        return &overdrive;
+    case DSP_Option::LadderFilter:
+        return &ladderFilter;
+    case DSP_Option::GeneralFilter:
+        if (generalFilterUsesSvf)
+            return &generalFilterSvf;
+        return &generalFilter;
+    case DSP_Option::Convolution:
+        return &convolution;
+    case DSP_Option::LinearPhaseEQ:
+        return &linearPhaseEQ;
+    case DSP_Option::Dynamics:
+        return &dynamics;
+    case DSP_Option::Reverb:
+        return &reverb;
+    case DSP_Option::END_OF_LIST:
+        break;
+    }
+
+    jassertfalse;
+    return nullptr;
+}
+
+template<typename SampleType, typename FilterSampleType>
+size_t Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::getStageArenaBytes(DSP_Option option, const juce::dsp::ProcessSpec& spec, int decimation, int fftOrder, int lookaheadSamples)
+{
+    switch (option)
+    {
+    case DSP_Option::Phase:
+        return decltype(phaser)::getArenaBytes(spec, decimation);
+    case DSP_Option::Chorus:
+        return decltype(chorus)::getArenaBytes(spec, decimation);
+    case DSP_Option::OverDrive:
+        return decltype(overdrive)::getArenaBytes(spec);
+    case DSP_Option::LadderFilter:
+        return decltype(ladderFilter)::getArenaBytes(spec);
+    case DSP_Option::GeneralFilter:
+        return decltype(generalFilter)::getArenaBytes(spec, decimation) + decltype(generalFilterSvf)::getArenaBytes(spec, decimation);
+    case DSP_Option::Convolution:
+        return decltype(convolution)::getArenaBytes(spec);
+    case DSP_Option::LinearPhaseEQ:
+        return decltype(linearPhaseEQ)::getArenaBytes(spec, 1, fftOrder);
+    case DSP_Option::Dynamics:
+        return decltype(dynamics)::getArenaBytes(spec, 1, lookaheadSamples);
+    case DSP_Option::Reverb:
+        return decltype(reverb)::getArenaBytes(spec);
+    case DSP_Option::END_OF_LIST:
+        break;
+    }
+
+    jassertfalse;
+    return 0;
+}
+
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::prepareStage(DSP_Option option, const juce::dsp::ProcessSpec& spec, Arena& arena)
 {
     jassert(spec.numChannels == 1);
 
-    std::vector<juce::dsp::ProcessorBase*> dsp
+    switch (option)
     {
-        &phaser,
-        &chorus,
-        &overdrive,
-        &ladderFilter,
-        &generalFilter
-    };
+    case DSP_Option::Phase:
+        phaser.prepare(spec, arena, p.getStageDecimation(option));
+        break;
+    case DSP_Option::Chorus:
+        chorus.prepare(spec, arena, p.getStageDecimation(option));
+        break;
+    case DSP_Option::OverDrive:
+        overdrive.prepare(spec, arena);
+        break;
+    case DSP_Option::LadderFilter:
+        ladderFilter.prepare(spec, arena);
+        break;
+    case DSP_Option::GeneralFilter:
+        generalFilter.prepare(spec, arena, p.getStageDecimation(option));
+        generalFilterSvf.prepare(spec, arena, p.getStageDecimation(option));
+        break;
+    case DSP_Option::Convolution:
+        convolution.prepare(spec, arena);
+        break;
+    case DSP_Option::LinearPhaseEQ:
+        linearPhaseEQ.prepare(spec, arena, 1, p.linearPhaseEQFFTOrder.load(std::memory_order_relaxed));
+        linearPhaseEQKernelSerial.reset();
+        break;
+    case DSP_Option::Dynamics:
+        dynamics.prepare(spec, arena, 1, p.dynamicsLookaheadSamples.load(std::memory_order_relaxed));
+        break;
+    case DSP_Option::Reverb:
+        reverb.prepare(spec, arena);
+        reverb.dsp.setChannel(channel);
+        break;
+    case DSP_Option::END_OF_LIST:
+        jassertfalse;
+        return;
+    }
+
+    getProcessor(option)->reset();
+}
 
-    for (auto p : dsp)
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::releaseStage(DSP_Option option)
+{
+    switch (option)
     {
-        p->prepare(spec);
-        p->reset();
+    case DSP_Option::Phase:
+        phaser.release();
+        break;
+    case DSP_Option::Chorus:
+        chorus.release();
+        break;
+    case DSP_Option::OverDrive:
+        overdrive.release();
+        break;
+    case DSP_Option::LadderFilter:
+        ladderFilter.release();
+        break;
+    case DSP_Option::GeneralFilter:
+        generalFilter.release();
+        generalFilterSvf.release();
+        break;
+    case DSP_Option::Convolution:
+        convolution.release();
+        break;
+    case DSP_Option::LinearPhaseEQ:
+        linearPhaseEQ.release();
+        break;
+    case DSP_Option::Dynamics:
+        dynamics.release();
+        break;
+    case DSP_Option::Reverb:
+        reverb.release();
+        break;
+    case DSP_Option::END_OF_LIST:
+        jassertfalse;
+        break;
     }
 }
 
 void Project13AudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    //hand back every stage's buffers and the arenas.  the next prepareToPlay() allocates whatever is enabled again.
+    generalFilterCoefficientRequests.stop();
+    prePostFilterCoefficientRequests.stop();
+    linearPhaseEQKernelRequests.stop();
+    crossoverCoefficientRequests.stop();
+
+    const juce::ScopedLock sl(stagePreparationLock);
+    hasStageSpec = false;
+    releaseAllStages();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -581,151 +2342,817 @@ juce::AudioProcessorValueTreeState::ParameterLayout Project13AudioProcessor::cre
         0.0f, "dB"));
     name = getGeneralFilterBypassName();
     layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, false));
+    /*
+     morph:
+     amount: 0 to 1, A to B
+     switch point: 0 to 1, where choices, bools and the DSP order flip from A to B
+     enabled
+     */
+    name = getMorphAmountName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 0.f, "%"));
+    name = getMorphSwitchPointName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 50.f, "%"));
+    name = getMorphEnabledName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, false));
+    /*
+     run the overdrive, ladder and general filter in double while the host runs in float.
+     the stages are swapped in prepareToPlay(), so this can't be automated.
+     */
+    name = getDoublePrecisionFiltersName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, false,
+                                                          juce::AudioParameterBoolAttributes().withAutomatable(false)));
+    /*
+     modulation:
+     LFO n: rate Hz, shape
+     Env n: attack ms, release ms
+     Mod n: source, target, depth (-100% to 100% of the target's range)
+     */
+    for (size_t i = 0; i < ModulationMatrix::numLfos; ++i)
+    {
+        name = getLfoRateName(i);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.01f, 20.f, 0.01f, 0.5f), 1.f, "Hz"));
+        name = getLfoShapeName(i);
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getLfoShapeChoices(), 0));
+    }
+
+    for (size_t i = 0; i < ModulationMatrix::numEnvelopes; ++i)
+    {
+        name = getEnvAttackName(i);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.1f, 500.f, 0.1f, 0.5f), 10.f, "ms"));
+        name = getEnvReleaseName(i);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(1.f, 2000.f, 1.f, 0.5f), 150.f, "ms"));
+    }
+
+    for (size_t i = 0; i < ModulationMatrix::numRoutings; ++i)
+    {
+        name = getModSourceName(i);
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getModSourceChoices(), 0));
+        name = getModTargetName(i);
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getModTargetChoices(), 0));
+        name = getModDepthName(i);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(-100.f, 100.f, 0.1f, 1.f), 0.f, "%"));
+    }
+    /*
+     mid/side:
+     mode: the left chain processes mid, the right chain processes side
+     per stage: which of the two it runs on
+     */
+    name = getMidSideModeName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, false));
+    for (auto midSideName : { getPhaserMidSideName(), getChorusMidSideName(), getOverdriveMidSideName(), getLadderFilterMidSideName(), getGeneralFilterMidSideName() })
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ midSideName, versionHint }, midSideName, getMidSideChoices(), 0));
+    /*
+     global mix:
+     0 to 100%, blends the whole chain with the latency-compensated dry input
+     */
+    name = getGlobalMixName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 100.f, "%"));
+    /*
+     pre/post filters:
+     HPF Hz, slope: off at 20 Hz
+     LPF Hz, slope: off at 20 kHz
+     bypass
+     */
+    auto addFilterPair = [&layout](const juce::String& hpfFreqName, const juce::String& hpfSlopeName,
+                                   const juce::String& lpfFreqName, const juce::String& lpfSlopeName,
+                                   const juce::String& bypassName)
+    {
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ hpfFreqName, versionHint }, hpfFreqName, juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20.f, "Hz"));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ hpfSlopeName, versionHint }, hpfSlopeName, getFilterSlopeChoices(), 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ lpfFreqName, versionHint }, lpfFreqName, juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20000.f, "Hz"));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ lpfSlopeName, versionHint }, lpfSlopeName, getFilterSlopeChoices(), 0));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ bypassName, versionHint }, bypassName, true));
+    };
+    addFilterPair(getPreHpfFreqName(), getPreHpfSlopeName(), getPreLpfFreqName(), getPreLpfSlopeName(), getPreFilterBypassName());
+    addFilterPair(getPostHpfFreqName(), getPostHpfSlopeName(), getPostLpfFreqName(), getPostLpfSlopeName(), getPostFilterBypassName());
+    /*
+     general filter engine: Biquad, SVF
+     */
+    name = getGeneralFilterEngineName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getGeneralFilterEngineChoices(), 0));
+    /*
+     internal rate cap: Off, 48 kHz, 96 kHz
+     the phaser, chorus and general filter run at or below this rate.  it changes the latency, so it can't be automated.
+     */
+    name = getInternalRateCapName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getInternalRateCapChoices(), 0,
+                                                            juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    /*
+     convolution:
+     mix: 0 to 100%
+     gain: dB, applied to the wet signal
+     the impulse response is a file, see loadImpulseResponse()
+     */
+    name = getConvolutionMixName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 100.f, "%"));
+    name = getConvolutionGainName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(-24.f, 24.f, 0.1f, 1.f), 0.f, "dB"));
+    name = getConvolutionMidSideName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getMidSideChoices(), 0));
+    name = getConvolutionBypassName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, false));
+    /*
+     linear-phase EQ:
+     low shelf: Hz, dB
+     mid peak: Hz, Q, dB
+     high shelf: Hz, dB
+     FFT size: 1024 to 8192.  a longer FFT resolves lower frequencies, for more latency, so it can't be automated.
+     */
+    name = getLinearPhaseEQLowFreqName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(20.f, 1000.f, 1.f, 0.5f), 100.f, "Hz"));
+    name = getLinearPhaseEQLowGainName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(-18.f, 18.f, 0.1f, 1.f), 0.f, "dB"));
+    name = getLinearPhaseEQMidFreqName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 1000.f, "Hz"));
+    name = getLinearPhaseEQMidQualityName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.1f, 10.f, 0.01f, 0.5f), 0.71f, ""));
+    name = getLinearPhaseEQMidGainName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(-18.f, 18.f, 0.1f, 1.f), 0.f, "dB"));
+    name = getLinearPhaseEQHighFreqName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(1000.f, 20000.f, 1.f, 0.5f), 8000.f, "Hz"));
+    name = getLinearPhaseEQHighGainName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(-18.f, 18.f, 0.1f, 1.f), 0.f, "dB"));
+    name = getLinearPhaseEQFFTSizeName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getLinearPhaseEQFFTSizeChoices(), 2,
+                                                            juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    name = getLinearPhaseEQMidSideName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getMidSideChoices(), 0));
+    name = getLinearPhaseEQBypassName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, false));
+    /*
+     multiband:
+     mode: Off, or the number of Linkwitz-Riley bands the chain is split into
+     crossover n: Hz, between band n and band n + 1
+     per stage: the full signal, or the one band it runs on
+     */
+    name = getMultibandModeName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getMultibandModeChoices(), 0));
+    auto crossoverNames = std::array { getCrossover1FreqName(), getCrossover2FreqName(), getCrossover3FreqName() };
+    auto crossoverDefaults = std::array { 200.f, 1000.f, 5000.f };
+    for (size_t i = 0; i < crossoverNames.size(); ++i)
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ crossoverNames[i], versionHint }, crossoverNames[i], juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), crossoverDefaults[i], "Hz"));
+    for (auto bandName : { getPhaserBandName(), getChorusBandName(), getOverdriveBandName(), getLadderFilterBandName(), getGeneralFilterBandName(), getConvolutionBandName(), getLinearPhaseEQBandName() })
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ bandName, versionHint }, bandName, getBandChoices(), 0));
+    /*
+     dynamics:
+     threshold: dB, ratio: n:1, the top of the range is as good as a limiter
+     attack, release: ms
+     makeup: dB
+     lookahead: ms, the latency it adds, so it can't be automated
+     it starts bypassed, so sessions from before it existed sound and time the same
+     */
+    name = getDynamicsThresholdName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(-60.f, 0.f, 0.1f, 1.f), 0.f, "dB"));
+    name = getDynamicsRatioName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(1.f, 50.f, 0.1f, 0.3f), 4.f, ":1"));
+    name = getDynamicsAttackName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.1f, 100.f, 0.1f, 0.5f), 1.f, "ms"));
+    name = getDynamicsReleaseName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(5.f, 1000.f, 1.f, 0.5f), 100.f, "ms"));
+    name = getDynamicsMakeupName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 24.f, 0.1f, 1.f), 0.f, "dB"));
+    name = getDynamicsLookaheadName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, LookaheadCompressor<float>::maxLookaheadMs, 0.1f, 1.f), 5.f,
+                                                           juce::AudioParameterFloatAttributes().withLabel("ms").withAutomatable(false)));
+    name = getDynamicsMidSideName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getMidSideChoices(), 0));
+    name = getDynamicsBandName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getBandChoices(), 0));
+    name = getDynamicsBypassName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, true));
+    /*
+     reverb:
+     size: 25 to 100% of the longest delays
+     decay: seconds to fall by 60 dB, reported as the tail
+     damping: 0 to 100%, how much faster the highs decay
+     mod depth: 0 to 100% of 1 ms, driven by LFO 1
+     mix: 0 to 100%
+     it starts bypassed, like the dynamics
+     */
+    name = getReverbSizeName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(FdnReverb<float>::minSize * 100.f, 100.f, 0.1f, 1.f), 70.f, "%"));
+    name = getReverbDecayName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.1f, 20.f, 0.01f, 0.3f), 2.f, "s"));
+    name = getReverbDampingName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 50.f, "%"));
+    name = getReverbModDepthName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 20.f, "%"));
+    name = getReverbMixName();
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{ name, versionHint }, name, juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 30.f, "%"));
+    name = getReverbMidSideName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getMidSideChoices(), 0));
+    name = getReverbBandName();
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{ name, versionHint }, name, getBandChoices(), 0));
+    name = getReverbBypassName();
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID{ name, versionHint }, name, true));
     return layout;
 }
 
-void Project13AudioProcessor::MonoChannelDSP::updateDSPFromParams()
+Project13AudioProcessor::GeneralFilterSettings Project13AudioProcessor::getGeneralFilterSettings() const
+{
+    GeneralFilterSettings settings;
+    settings.mode = getLiveChoiceIndex(generalFilterModeIndex);
+    settings.freq = generalFilterFreqHzSmoother.getCurrentValue();
+    settings.quality = generalFilterQualitySmoother.getCurrentValue();
+    settings.gain = generalFilterGainSmoother.getCurrentValue();
+    settings.sampleRate = getSampleRate();
+    return settings;
+}
+
+BiquadCoefficients Project13AudioProcessor::makeGeneralFilterCoefficients(const GeneralFilterSettings& settings)
+{
+    //runs on the CoefficientWorker, so the juce::dsp helpers are free to allocate
+    using Coefficients = juce::dsp::IIR::Coefficients<double>;
+    if (settings.sampleRate <= 0.0)
+        return {};
+
+    auto freq = static_cast<double>(settings.freq);
+    auto quality = static_cast<double>(settings.quality);
+    Coefficients::Ptr coefficients;
+
+    //choices: Peak, bandpass, notch, allpass,
+    switch (static_cast<GeneralFilterMode>(settings.mode))
+    {
+        case GeneralFilterMode::Peak:
+        {
+            coefficients = Coefficients::makePeakFilter(settings.sampleRate, freq, quality, juce::Decibels::decibelsToGain(static_cast<double>(settings.gain)));
+            break;
+        }
+        case GeneralFilterMode::Bandpass:
+        {
+            coefficients = Coefficients::makeBandPass(settings.sampleRate, freq, quality);
+            break;
+        }
+        case GeneralFilterMode::Notch:
+        {
+            coefficients = Coefficients::makeNotch(settings.sampleRate, freq, quality);
+            break;
+        }
+        case GeneralFilterMode::Allpass:
+        {
+            coefficients = Coefficients::makeAllPass(settings.sampleRate, freq, quality);
+            break;
+        }
+        case GeneralFilterMode::END_OF_LIST:
+        {
+            jassertfalse;
+            break;
+        }
+    }
+
+    if (coefficients == nullptr)
+        return {};
+
+    return BiquadCoefficients::fromJuce(*coefficients);
+}
+
+Project13AudioProcessor::PrePostFilterSettings Project13AudioProcessor::getPrePostFilterSettings() const
+{
+    auto getPair = [this](const FilterPairParamIndices& indices,
+                          const juce::SmoothedValue<float>& hpfFreq,
+                          const juce::SmoothedValue<float>& lpfFreq)
+    {
+        FilterPairSettings pair;
+        pair.bypassed = liveParams.values[indices.bypass] > 0.5f;
+        if (pair.bypassed)
+            return pair;
+
+        pair.hpfFreq = hpfFreq.getCurrentValue();
+        pair.hpfSlope = getLiveChoiceIndex(indices.hpfSlope);
+        pair.lpfFreq = lpfFreq.getCurrentValue();
+        pair.lpfSlope = getLiveChoiceIndex(indices.lpfSlope);
+        return pair;
+    };
+
+    PrePostFilterSettings settings;
+    settings.pre = getPair(prePostFilterParamIndices[0], preHpfFreqHzSmoother, preLpfFreqHzSmoother);
+    settings.post = getPair(prePostFilterParamIndices[1], postHpfFreqHzSmoother, postLpfFreqHzSmoother);
+    settings.sampleRate = getSampleRate();
+    return settings;
+}
+
+BiquadCascadeCoefficients Project13AudioProcessor::makeFilterPairCoefficients(const FilterPairSettings& settings, double sampleRate)
+{
+    BiquadCascadeCoefficients cascade;
+    if (settings.bypassed || sampleRate <= 0.0)
+        return cascade;
+
+    //slope choice n is a Butterworth of order 2(n + 1), i.e. n + 1 biquads
+    auto getOrder = [](int slope) { return 2 * (juce::jlimit(0, 3, slope) + 1); };
+    auto addSections = [&cascade](const juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<double>>& sections)
+    {
+        for (auto* section : sections)
+            cascade.add(BiquadCoefficients::fromJuce(*section));
+    };
+    //the design functions need the cutoff below nyquist
+    auto limit = [sampleRate](float freq) { return juce::jmin(static_cast<double>(freq), sampleRate * 0.45); };
+
+    using Design = juce::dsp::FilterDesign<double>;
+    if (settings.hpfFreq > 20.f)
+        addSections(Design::designIIRHighpassHighOrderButterworthMethod(limit(settings.hpfFreq), sampleRate, getOrder(settings.hpfSlope)));
+    if (settings.lpfFreq < 20000.f && settings.lpfFreq < sampleRate * 0.45)
+        addSections(Design::designIIRLowpassHighOrderButterworthMethod(limit(settings.lpfFreq), sampleRate, getOrder(settings.lpfSlope)));
+
+    return cascade;
+}
+
+Project13AudioProcessor::PrePostFilterCoefficients Project13AudioProcessor::makePrePostFilterCoefficients(const PrePostFilterSettings& settings)
+{
+    //runs on the CoefficientWorker
+    return { makeFilterPairCoefficients(settings.pre, settings.sampleRate), makeFilterPairCoefficients(settings.post, settings.sampleRate) };
+}
+
+bool Project13AudioProcessor::updatePrePostFilterCoefficients()
+{
+    auto settings = getPrePostFilterSettings();
+    if (settings != requestedPrePostFilterSettings)
+    {
+        requestedPrePostFilterSettings = settings;
+        prePostFilterCoefficientRequests.request(settings);
+    }
+
+    return prePostFilterCoefficientRequests.pull(prePostFilterCoefficients);
+}
+
+void Project13AudioProcessor::updateGeneralFilterCoefficients()
+{
+    //ask for new coefficients when the settings moved, and pick up whatever the thread has published since the last sub-block
+    auto settings = getGeneralFilterSettings();
+    if (settings != requestedGeneralFilterSettings)
+    {
+        requestedGeneralFilterSettings = settings;
+        generalFilterCoefficientRequests.request(settings);
+    }
+
+    generalFilterCoefficientRequests.pull(generalFilterCoefficients);
+}
+
+Project13AudioProcessor::LinearPhaseEQSettings Project13AudioProcessor::getLinearPhaseEQSettings() const
+{
+    const auto& indices = linearPhaseEQParamIndices;
+    LinearPhaseEQSettings settings;
+    settings.lowFreq = liveParams.values[indices.lowFreq];
+    settings.lowGain = liveParams.values[indices.lowGain];
+    settings.midFreq = liveParams.values[indices.midFreq];
+    settings.midQuality = liveParams.values[indices.midQuality];
+    settings.midGain = liveParams.values[indices.midGain];
+    settings.highFreq = liveParams.values[indices.highFreq];
+    settings.highGain = liveParams.values[indices.highGain];
+    settings.fftOrder = linearPhaseEQFFTOrder.load(std::memory_order_relaxed);
+    settings.sampleRate = getSampleRate();
+    return settings;
+}
+
+LinearPhaseKernel Project13AudioProcessor::makeLinearPhaseEQKernel(const LinearPhaseEQSettings& settings)
+{
+    //runs on the CoefficientWorker.  the bands are the usual biquad shapes, but only their magnitude is used
+    using Coefficients = juce::dsp::IIR::Coefficients<double>;
+    if (settings.sampleRate <= 0.0)
+        return LinearPhaseKernel::makeDelay(settings.fftOrder);
+
+    const auto sampleRate = settings.sampleRate;
+    //the design functions need the frequency below nyquist
+    auto limit = [sampleRate](float freq) { return juce::jmin(static_cast<double>(freq), sampleRate * 0.45); };
+    auto toGain = [](float decibels) { return juce::Decibels::decibelsToGain(static_cast<double>(decibels)); };
+    constexpr double shelfQuality = 0.71;
+
+    const auto bands = std::array
+    {
+        Coefficients::makeLowShelf(sampleRate, limit(settings.lowFreq), shelfQuality, toGain(settings.lowGain)),
+        Coefficients::makePeakFilter(sampleRate, limit(settings.midFreq), static_cast<double>(settings.midQuality), toGain(settings.midGain)),
+        Coefficients::makeHighShelf(sampleRate, limit(settings.highFreq), shelfQuality, toGain(settings.highGain)),
+    };
+
+    return LinearPhaseKernel::design(settings.fftOrder, sampleRate, [&bands, sampleRate](double freq)
+    {
+        double magnitude = 1.0;
+        for (const auto& band : bands)
+            magnitude *= band->getMagnitudeForFrequency(freq, sampleRate);
+
+        return magnitude;
+    });
+}
+
+void Project13AudioProcessor::updateLinearPhaseEQKernel()
+{
+    //like the general filter's coefficients.  the channels take a new kernel in updateDSPFromParams()
+    auto settings = getLinearPhaseEQSettings();
+    if (settings != requestedLinearPhaseEQSettings)
+    {
+        requestedLinearPhaseEQSettings = settings;
+        linearPhaseEQKernelRequests.request(settings);
+    }
+
+    if (linearPhaseEQKernelRequests.pull(linearPhaseEQKernel))
+        ++linearPhaseEQKernelSerial;
+}
+
+Project13AudioProcessor::CrossoverSettings Project13AudioProcessor::getCrossoverSettings() const
+{
+    CrossoverSettings settings;
+    settings.numBands = static_cast<size_t>(getLiveChoiceIndex(multibandModeIndex)) + 1;
+    settings.sampleRate = getSampleRate();
+    //full band, the crossovers don't matter, so moving them doesn't wake the thread
+    if (settings.numBands == 1)
+        return settings;
+
+    settings.frequencies = { crossover1FreqHzSmoother.getCurrentValue(), crossover2FreqHzSmoother.getCurrentValue(), crossover3FreqHzSmoother.getCurrentValue() };
+    return settings;
+}
+
+LinkwitzRileyCoefficients Project13AudioProcessor::makeCrossoverCoefficients(const CrossoverSettings& settings)
+{
+    //runs on the CoefficientWorker
+    return LinkwitzRileyCoefficients::design(settings.numBands, settings.frequencies, settings.sampleRate);
+}
+
+void Project13AudioProcessor::updateCrossoverCoefficients()
+{
+    //like the pre/post filters.  each channel copies the coefficients into its crossover in updateDSPFromParams()
+    auto settings = getCrossoverSettings();
+    if (settings != requestedCrossoverSettings)
+    {
+        requestedCrossoverSettings = settings;
+        crossoverCoefficientRequests.request(settings);
+    }
+
+    crossoverCoefficientRequests.pull(crossoverCoefficients);
+}
+
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::updateDSPFromParams()
 {
-    phaser.dsp.setRate(p.phaserRateHzSmoother.getCurrentValue());
-    phaser.dsp.setCentreFrequency(p.phaserCenterFreqHzSmoother.getCurrentValue());
-    phaser.dsp.setDepth(p.phaserDepthPercentSmoother.getCurrentValue() * 0.01f);
-    phaser.dsp.setFeedback(p.phaserFeedbackPercentSmoother.getCurrentValue() * 0.01f);
-    phaser.dsp.setMix(p.phaserMixPercentSmoother.getCurrentValue() * 0.01f);
+    //stages that aren't prepared belong to the message thread until stageReady is set
+    if (p.isStageReady(DSP_Option::Phase))
+    {
+        phaser.dsp.setRate(p.phaserRateHzSmoother.getCurrentValue());
+        phaser.dsp.setCentreFrequency(p.phaserCenterFreqHzSmoother.getCurrentValue());
+        phaser.dsp.setDepth(p.phaserDepthPercentSmoother.getCurrentValue() * 0.01f);
+        phaser.dsp.setFeedback(p.phaserFeedbackPercentSmoother.getCurrentValue() * 0.01f);
+        phaser.dsp.setMix(p.phaserMixPercentSmoother.getCurrentValue() * 0.01f);
+    }
 
-    chorus.dsp.setRate(p.chorusRateHzSmoother.getCurrentValue());
-    chorus.dsp.setDepth(p.chorusDepthPercentSmoother.getCurrentValue() * 0.01f);
-    chorus.dsp.setCentreDelay(p.chorusCenterDelayMsSmoother.getCurrentValue());
-    chorus.dsp.setFeedback(p.chorusFeedbackPercentSmoother.getCurrentValue() * 0.01f);
-    chorus.dsp.setMix(p.chorusMixPercentSmoother.getCurrentValue() * 0.01f);
+    if (p.isStageReady(DSP_Option::Chorus))
+    {
+        chorus.dsp.setRate(p.chorusRateHzSmoother.getCurrentValue());
+        chorus.dsp.setDepth(p.chorusDepthPercentSmoother.getCurrentValue() * 0.01f);
+        chorus.dsp.setCentreDelay(p.chorusCenterDelayMsSmoother.getCurrentValue());
+        chorus.dsp.setFeedback(p.chorusFeedbackPercentSmoother.getCurrentValue() * 0.01f);
+        chorus.dsp.setMix(p.chorusMixPercentSmoother.getCurrentValue() * 0.01f);
+    }
 
-    overdrive.dsp.setDrive(p.overdriveSaturationSmoother.getCurrentValue());
+    if (p.isStageReady(DSP_Option::OverDrive))
+        overdrive.dsp.setDrive(p.overdriveSaturationSmoother.getCurrentValue());
 
-    ladderFilter.dsp.setMode(static_cast<juce::dsp::LadderFilterMode>(p.ladderFilterMode->getIndex()));
-    ladderFilter.dsp.setCutoffFrequencyHz(p.ladderFilterCutoffHzSmoother.getCurrentValue());
-    ladderFilter.dsp.setResonance(p.ladderFilterResonanceSmoother.getCurrentValue() * 0.01f);
-    ladderFilter.dsp.setDrive(p.ladderFilterDriveSmoother.getCurrentValue());
+    if (p.isStageReady(DSP_Option::LadderFilter))
+    {
+        ladderFilter.dsp.setMode(static_cast<juce::dsp::LadderFilterMode>(p.getLiveChoiceIndex(p.ladderFilterModeIndex)));
+        ladderFilter.dsp.setCutoffFrequencyHz(p.ladderFilterCutoffHzSmoother.getCurrentValue());
+        ladderFilter.dsp.setResonance(p.ladderFilterResonanceSmoother.getCurrentValue() * 0.01f);
+        ladderFilter.dsp.setDrive(p.ladderFilterDriveSmoother.getCurrentValue());
+    }
 
-    auto sampleRate = p.getSampleRate();
-    //update generalFilter coefficients
-    //choices: Peak, bandpass, notch, allpass,
-    auto genMode = p.generalFilterMode->getIndex();
-    auto genHz = p.generalFilterFreqHzSmoother.getCurrentValue();
-    auto genQ = p.generalFilterQualitySmoother.getCurrentValue();
-    auto genGain = p.generalFilterGainSmoother.getCurrentValue();
-
-    bool filterChanged = false;
-    filterChanged |= (filterFreq != genHz);
-    filterChanged |= (filterQ != genQ);
-    filterChanged |= (filterGain != genGain);
-
-    auto updatedMode = static_cast<GeneralFilterMode>(genMode);
-    filterChanged |= (filterMode != updatedMode);
-    if (filterChanged)
-    {
-        filterMode = updatedMode;
-        filterFreq = genHz;
-        filterQ = genQ;
-        filterGain = genGain;
-        juce::dsp::IIR::Coefficients<float>::Ptr coefficients;
-        switch (filterMode)
-        {
-            case GeneralFilterMode::Peak:
-            {
-                coefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, filterFreq, filterQ, juce::Decibels::decibelsToGain(filterGain));
-                break;
-            }
-            case GeneralFilterMode::Bandpass:
-            {
-                coefficients = juce::dsp::IIR::Coefficients<float>::makeBandPass(sampleRate, filterFreq, filterQ);
-                break;
-            }
-            case GeneralFilterMode::Notch:
-            {
-                coefficients = juce::dsp::IIR::Coefficients<float>::makeNotch(sampleRate, filterFreq, filterQ);
-                break;
-            }
-            case GeneralFilterMode::Allpass:
-            {
-                coefficients = juce::dsp::IIR::Coefficients<float>::makeAllPass(sampleRate, filterFreq, filterQ);
-                break;
-            }
-            case GeneralFilterMode::END_OF_LIST:
-            {
-                jassertfalse;
-                break;
-            }
+    if (p.isStageReady(DSP_Option::GeneralFilter))
+    {
+        auto usesSvf = static_cast<GeneralFilterEngine>(p.getLiveChoiceIndex(p.generalFilterEngineIndex)) == GeneralFilterEngine::SVF;
+        if (usesSvf != generalFilterUsesSvf)
+        {
+            //the engine that takes over starts from silence instead of whatever it held when it was last used
+            generalFilterUsesSvf = usesSvf;
+            getProcessor(DSP_Option::GeneralFilter)->reset();
         }
 
-        if (coefficients != nullptr)
+        if (generalFilterUsesSvf)
         {
-
-            *generalFilter.dsp.coefficients = *coefficients;
-            generalFilter.reset();
+            //the SVF is cheap to retune, so it takes the smoothed values directly and ramps between them per sample
+            generalFilterSvf.dsp.setMode(static_cast<typename TptSvf<FilterSampleType>::Mode>(p.getLiveChoiceIndex(p.generalFilterModeIndex)));
+            generalFilterSvf.dsp.setParameters(p.generalFilterFreqHzSmoother.getCurrentValue(),
+                                               p.generalFilterQualitySmoother.getCurrentValue(),
+                                               p.generalFilterGainSmoother.getCurrentValue());
+        }
+        else
+        {
+            //the coefficients were computed once for both channels, see updateGeneralFilterCoefficients()
+            generalFilter.dsp.setCoefficients(p.generalFilterCoefficients);
         }
     }
 
+    if (p.isStageReady(DSP_Option::Convolution))
+    {
+        const auto* set = p.convolutionSet;
+        convolution.dsp.setImpulseResponse(set != nullptr ? set->impulseResponse.get() : nullptr,
+                                           set != nullptr ? set->tails[static_cast<size_t>(channel)].get() : nullptr,
+                                           channel);
+        convolution.dsp.setMix(p.convolutionMixPercentSmoother.getCurrentValue() * 0.01f);
+        convolution.dsp.setGainDecibels(p.convolutionGainSmoother.getCurrentValue());
+        convolution.dsp.setWaitsForTail(p.isNonRealtime());
+    }
+
+    //a new kernel is copied in only once; the EQ crossfades to it at its next frame
+    if (p.isStageReady(DSP_Option::LinearPhaseEQ) && linearPhaseEQKernelSerial != p.linearPhaseEQKernelSerial)
+    {
+        linearPhaseEQ.dsp.setKernel(p.linearPhaseEQKernel);
+        linearPhaseEQKernelSerial = p.linearPhaseEQKernelSerial;
+    }
+
+    if (p.isStageReady(DSP_Option::Dynamics))
+    {
+        dynamics.dsp.setThresholdDecibels(p.dynamicsThresholdDbSmoother.getCurrentValue());
+        dynamics.dsp.setRatio(p.dynamicsRatioSmoother.getCurrentValue());
+        dynamics.dsp.setAttack(p.dynamicsAttackMsSmoother.getCurrentValue());
+        dynamics.dsp.setRelease(p.dynamicsReleaseMsSmoother.getCurrentValue());
+        dynamics.dsp.setMakeupDecibels(p.dynamicsMakeupDbSmoother.getCurrentValue());
+    }
+
+    if (p.isStageReady(DSP_Option::Reverb))
+    {
+        reverb.dsp.setSize(p.reverbSizePercentSmoother.getCurrentValue() * 0.01f);
+        reverb.dsp.setDecay(p.reverbDecaySecondsSmoother.getCurrentValue());
+        reverb.dsp.setDamping(p.reverbDampingPercentSmoother.getCurrentValue() * 0.01f);
+        //the delays follow the instance's LFO 1, at its rate and shape, whether or not it is routed anywhere
+        reverb.dsp.setModulation(p.modulationMatrix.getSourceValue(0), p.reverbModDepthPercentSmoother.getCurrentValue() * 0.01f);
+        reverb.dsp.setMix(p.reverbMixPercentSmoother.getCurrentValue() * 0.01f);
+    }
+
+    //a different number of bands restarts the split, and the band delays with it
+    if (p.crossoverCoefficients.numBands != crossover.getNumBands())
+        bandsWereSplit = false;
+    crossover.setCoefficients(p.crossoverCoefficients);
+}
+
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::copyStateFrom(const MonoChannelDSP& other)
+{
+    //audio thread.  both chains prepare each stage together, so a ready stage is ready in both
+    if (p.isStageReady(DSP_Option::Phase))
+        phaser.copyStateFrom(other.phaser);
+    if (p.isStageReady(DSP_Option::Chorus))
+        chorus.copyStateFrom(other.chorus);
+    //juce::dsp::LadderFilter can't copy its state without allocating, so dual mono never runs with the overdrive on, see processBlockImpl()
+    if (p.isStageReady(DSP_Option::OverDrive))
+        overdrive.reset();
+    if (p.isStageReady(DSP_Option::LadderFilter))
+        ladderFilter.copyStateFrom(other.ladderFilter);
+    if (p.isStageReady(DSP_Option::GeneralFilter))
+    {
+        generalFilter.copyStateFrom(other.generalFilter);
+        generalFilterSvf.copyStateFrom(other.generalFilterSvf);
+        generalFilterUsesSvf = other.generalFilterUsesSvf;
+    }
+    if (p.isStageReady(DSP_Option::Convolution))
+        convolution.copyStateFrom(other.convolution);
+    if (p.isStageReady(DSP_Option::LinearPhaseEQ))
+    {
+        linearPhaseEQ.copyStateFrom(other.linearPhaseEQ);
+        linearPhaseEQKernelSerial = other.linearPhaseEQKernelSerial;
+    }
+    if (p.isStageReady(DSP_Option::Dynamics))
+        dynamics.copyStateFrom(other.dynamics);
+    if (p.isStageReady(DSP_Option::Reverb))
+        reverb.copyStateFrom(other.reverb);
+
+    crossover.copyStateFrom(other.crossover);
+    bandsWereSplit = other.bandsWereSplit;
+
+    if (compensationBuffer.getNumSamples() > 0)
+    {
+        for (int line = 0; line < numCompensationLines; ++line)
+            compensationBuffer.copyFrom(line, 0, other.compensationBuffer, line, 0, compensationBuffer.getNumSamples());
+        compensationWritePositions = other.compensationWritePositions;
+    }
 }
 
-void Project13AudioProcessor::MonoChannelDSP::process(juce::dsp::AudioBlock<float> block, const DSP_Order& dspOrder)
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::process(juce::dsp::AudioBlock<SampleType> block, const DSP_Order& dspOrder)
 {
-    DSP_Pointers dspPointers;
+    //in multiband mode, the band each stage runs on; -1, the full signal, for all of them otherwise
+    const auto numBands = static_cast<int>(crossover.getNumBands());
+    StageBands stageBands;
+    stageBands.fill(-1);
+
+    DSP_Pointers<SampleType> dspPointers;
     dspPointers.fill({});
     for (size_t i = 0; i < dspPointers.size(); ++i)
     {
-        switch (dspOrder[i])
+        dspPointers[i].processor = getProcessor(dspOrder[i]);
+        if (dspPointers[i].processor == nullptr)
+            continue;
+
+        dspPointers[i].ready = p.isStageReady(dspOrder[i]);
+
+        if (numBands > 1)
+            stageBands[i] = p.getLiveStageBand(dspOrder[i]);
+
+        //a stage on a band above the ones in use has nothing to run on
+        dspPointers[i].bypassed = p.isLiveStageOff(dspOrder[i]) || !p.isStageActiveOnChannel(dspOrder[i], channel) || stageBands[i] >= numBands;
+
+        //an enabled stage that hasn't been allocated yet passes audio through until the message thread prepares it
+        if (!dspPointers[i].bypassed && !dspPointers[i].ready)
         {
-        case DSP_Option::Phase:
-            dspPointers[i].processor = &phaser;
-            dspPointers[i].bypassed = p.phaserBypass->get();
-            break;
-        case DSP_Option::Chorus:
-            dspPointers[i].processor = &chorus;
-            dspPointers[i].bypassed = p.chorusBypass->get();
-            break;
-        case DSP_Option::OverDrive:
-            dspPointers[i].processor = &overdrive;
-            dspPointers[i].bypassed = p.overdriveBypass->get();
-            break;
-        case DSP_Option::LadderFilter:
-            dspPointers[i].processor = &ladderFilter;
-            dspPointers[i].bypassed = p.ladderFilterBypass->get();
-            break;
-        case DSP_Option::GeneralFilter:
-            dspPointers[i].processor = &generalFilter;
-            dspPointers[i].bypassed = p.generalFilterBypass->get();
-            break;
-        case DSP_Option::END_OF_LIST:
-            jassertfalse;
-            break;
+            p.requestStage(dspOrder[i]);
+            dspPointers[i].bypassed = true;
         }
     }
 
-    auto context = juce::dsp::ProcessContextReplacing<float>(block);
+    /*
+     the full-signal stages before the first stage on a band run before the split, all the others after the bands are summed.
+     with no stage on a band, nothing is split, and multiband mode costs nothing.
+     */
+    const auto firstBandStage = static_cast<size_t>(std::distance(stageBands.begin(),
+                                                                  std::find_if(stageBands.begin(), stageBands.end(), [](int band) { return band >= 0; })));
+    for (size_t i = 0; i < dspPointers.size(); ++i)
+    {
+        if (i == firstBandStage)
+            processBands(block, dspOrder, stageBands, dspPointers);
+
+        if (stageBands[i] < 0)
+            runStage(dspPointers[i], block);
+    }
+
+    if (firstBandStage == dspPointers.size())
+        bandsWereSplit = false;
 
+    //full-signal stages with latency that didn't run still owe it, see getStageLatency().  the bands settled theirs in processBands()
+    int owedLatency = 0;
     for (size_t i = 0; i < dspPointers.size(); ++i)
     {
-        if (dspPointers[i].processor != nullptr)
-        {
-            juce::ScopedValueSetter<bool> svs(context.isBypassed,
-                dspPointers[i].bypassed);
+        if (dspPointers[i].processor != nullptr && dspPointers[i].bypassed && stageBands[i] < 0)
+            owedLatency += p.getStageLatency(dspOrder[i]);
+    }
+
+    delayForLatencyCompensation(block, owedLatency);
+}
+
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::runStage(ProcessState<SampleType>& state, juce::dsp::AudioBlock<SampleType> block)
+{
+    if (state.processor == nullptr || !state.ready)
+        return;
+
+    auto context = juce::dsp::ProcessContextReplacing<SampleType>(block);
+    context.isBypassed = state.bypassed;
 #if VERIFY_BYPASS_FUNCTIONALITY
-            if (context.isBypassed)
-            {
-                jassertfalse;
-            }
+    if (context.isBypassed)
+    {
+        jassertfalse;
+    }
 
-            if (dspPointers[i].processor == &bandFilter)
-            {
-                continue;
-            }
+    if (state.processor == &bandFilter)
+    {
+        return;
+    }
 #endif
 
-            dspPointers[i].processor->process(context);
+    state.processor->process(context);
+}
+
+/*
+ splits the block into the crossover's bands, runs each band's stages on it, in DSP_Order, and sums the bands back into the block.
+ every band must come out with the same delay, or the sum isn't flat any more: a band owes the latency of every stage on a band
+ that didn't run on it, whether the stage is on another band or bypassed, and is delayed by that on its own line.
+ a band without any stage of its own is only delayed.  stages on bands above the ones in use get their bypassed call on the full block.
+ */
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::processBands(juce::dsp::AudioBlock<SampleType> block, const DSP_Order& dspOrder, const StageBands& stageBands, DSP_Pointers<SampleType>& dspPointers)
+{
+    const auto numSamples = block.getNumSamples();
+    const auto numBands = static_cast<int>(crossover.getNumBands());
+    jassert(numSamples <= static_cast<size_t>(maxSubBlockSize));
+
+    //the split and the band delays hold whatever they had when the bands last ran
+    if (!bandsWereSplit)
+    {
+        crossover.reset();
+        for (int line = 1; line < numCompensationLines; ++line)
+            compensationBuffer.clear(line, 0, compensationBuffer.getNumSamples());
+        bandsWereSplit = true;
+    }
+
+    std::array<SampleType*, maxNumBands> bands;
+    for (size_t band = 0; band < maxNumBands; ++band)
+        bands[band] = bandSamples[band].data();
+
+    crossover.split(block.getChannelPointer(0), bands, numSamples);
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        juce::dsp::AudioBlock<SampleType> bandBlock(&bands[static_cast<size_t>(band)], 1, numSamples);
+        int owedLatency = 0;
+        for (size_t i = 0; i < dspPointers.size(); ++i)
+        {
+            if (stageBands[i] < 0)
+                continue;
+
+            if (stageBands[i] == band)
+                runStage(dspPointers[i], bandBlock);
+
+            if (stageBands[i] != band || dspPointers[i].bypassed)
+                owedLatency += p.getStageLatency(dspOrder[i]);
         }
+
+        delayForLatencyCompensation(bandBlock, owedLatency, 1 + band);
+    }
+
+    for (size_t i = 0; i < dspPointers.size(); ++i)
+    {
+        if (stageBands[i] >= numBands)
+            runStage(dspPointers[i], block);
+    }
+
+    crossover.sum(bands, block.getChannelPointer(0), numSamples);
+}
+
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::prepareLatencyCompensation(int maxDelaySamples)
+{
+    compensationBuffer.setSize(numCompensationLines, maxDelaySamples > 0 ? juce::nextPowerOfTwo(maxDelaySamples + maxSubBlockSize) : 0);
+    compensationBuffer.clear();
+    compensationWritePositions.fill(0);
+}
+
+template<typename SampleType, typename FilterSampleType>
+void Project13AudioProcessor::MonoChannelDSP<SampleType, FilterSampleType>::delayForLatencyCompensation(juce::dsp::AudioBlock<SampleType> block, int delaySamples, int line)
+{
+    if (compensationBuffer.getNumSamples() == 0)
+    {
+        jassert(delaySamples == 0);
+        return;
+    }
+
+    const auto numSamples = static_cast<int>(block.getNumSamples());
+    const auto mask = compensationBuffer.getNumSamples() - 1;
+    jassert(delaySamples + numSamples <= mask + 1);
+
+    auto& writePosition = compensationWritePositions[static_cast<size_t>(line)];
+    auto* delay = compensationBuffer.getWritePointer(line);
+    auto* samples = block.getChannelPointer(0);
+    for (int i = 0; i < numSamples; ++i)
+        delay[(writePosition + i) & mask] = samples[i];
+    if (delaySamples > 0)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] = delay[(writePosition + i - delaySamples) & mask];
+    }
+
+    writePosition = (writePosition + numSamples) & mask;
+}
+
+/*
+ true when both channels of the sub-block are equal to within about -140 dBFS.
+ every sample is compared: the sub-block is at most 64 samples, and a sampled check could miss a difference.
+ */
+template<typename SampleType>
+static bool channelsMatch(const juce::dsp::AudioBlock<SampleType>& block)
+{
+    const auto* left = block.getChannelPointer(0);
+    const auto* right = block.getChannelPointer(1);
+    SampleType maxDifference = 0;
+    for (size_t i = 0; i < block.getNumSamples(); ++i)
+        maxDifference = juce::jmax(maxDifference, std::abs(left[i] - right[i]));
+
+    return maxDifference <= static_cast<SampleType>(1.0e-7);
+}
+
+template<typename SampleType>
+static void encodeMidSide(juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto* left = block.getChannelPointer(0);
+    auto* right = block.getChannelPointer(1);
+    for (size_t i = 0; i < block.getNumSamples(); ++i)
+    {
+        auto l = left[i];
+        auto r = right[i];
+        left[i] = SampleType(0.5) * (l + r);
+        right[i] = SampleType(0.5) * (l - r);
+    }
+}
+
+template<typename SampleType>
+static void decodeMidSide(juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto* mid = block.getChannelPointer(0);
+    auto* side = block.getChannelPointer(1);
+    for (size_t i = 0; i < block.getNumSamples(); ++i)
+    {
+        auto m = mid[i];
+        auto s = side[i];
+        mid[i] = m + s;
+        side[i] = m - s;
     }
 }
 
-void Project13AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+void Project13AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processBlockImpl(buffer);
+}
+
+void Project13AudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    processBlockImpl(buffer);
+}
+
+template<typename SampleType>
+void Project13AudioProcessor::processBlockImpl(juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -750,32 +3177,35 @@ void Project13AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, ju
     //[DONE]: prepare all DSP
     //[DONE]: snap dropped tabs to correct position
     //[DONE]: hide dragged tab image or stop dragging the tag and constrain dragged image to X axis only. 
-    //TODO: wet/dry knob [BONUS]
+    //[DONE]: wet/dry knob [BONUS]
     //TODO: mono & stereo versions [mono is BONUS]
-    //TODO: modulators [BONUS]
-    //TODO: thread-safe filter updating [BONUS]
-    //TODO: pre/post filtering [BONUS]
+    //[DONE]: modulators [BONUS]
+    //[DONE]: thread-safe filter updating [BONUS]
+    //[DONE]: pre/post filtering [BONUS]
     //TODO: delay module [BONUS]
-    //TODO: save/load presets [BONUS]
-
-    leftChannel.updateDSPFromParams();
-    rightChannel.updateDSPFromParams();
-
-    //temp instance to pull into
-    auto newDSPOrder = DSP_Order();
+    //[DONE]: save/load presets [BONUS]
 
-    //try to pull
-    while (dspOrderFifo.pull(newDSPOrder))
+    /*
+     the host picks the precision before prepareToPlay(), which prepares the matching chain.
+     a block in the other precision would have no prepared chain to run through, so it is passed through untouched.
+     */
+    if (std::is_same_v<SampleType, double> != (activePrecision == ChainPrecision::doubleChain))
     {
-#if VERIFY_BYPASS_FUNCTIONALITY
         jassertfalse;
-#endif
+        return;
     }
 
-    //if you pulled, replace dspOrder
-    if (newDSPOrder != DSP_Order())
-        dspOrder = newDSPOrder;
+    updateGeneralFilterCoefficients();
+    updateLinearPhaseEQKernel();
+    updateCrossoverCoefficients();
+    withActiveChain([](auto& left, auto& right)
+    {
+        left.updateDSPFromParams();
+        right.updateDSPFromParams();
+    });
 
+    //program changes, reorders and morph snapshots, in the order they were made
+    applyAudioCommands();
 
         /*
          process max 64 samples at a time.
@@ -792,19 +3222,16 @@ void Project13AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, ju
         We will also need a counter to keep track of the start sample for a particular sub-block (10).
          */
 
-    if (guiNeedsLatestDspOrder.compareAndSetBool(false, true))
-    {
-        restoreDspOrderFifo.push(dspOrder);
-    }
-
     const auto numSamples = buffer.getNumSamples();
     auto samplesRemaining = numSamples;
-    auto maxSamplesToProcess = juce::jmin(numSamples, 64);
+    auto maxSamplesToProcess = juce::jmin(numSamples, maxSubBlockSize);
 
-    leftPreRMS.set(buffer.getRMSLevel(0, 0, numSamples));
-    rightPreRMS.set(buffer.getRMSLevel(1, 0, numSamples));
+    //the meters are accumulated by the global mix, in the passes it makes over each sub-block anyway
+    auto& mixer = getGlobalMix<SampleType>();
+    auto& filters = getPrePostFilters<SampleType>();
+    std::array<double, 2> preSumsOfSquares {}, postSumsOfSquares {};
 
-    auto block = juce::dsp::AudioBlock<float>(buffer);
+    auto block = juce::dsp::AudioBlock<SampleType>(buffer);
     size_t startSample = 0; // (10) 
     while (samplesRemaining > 0) // (3) 
     {
@@ -815,26 +3242,106 @@ void Project13AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, ju
          the 2nd time this loop runs, samplesToProcess will be 8, because the previous loop consumed 64 of the 72 samples.
          */
         auto samplesToProcess = juce::jmin(samplesRemaining, maxSamplesToProcess); // (4) 
+        //the envelope followers track the sub-block's input before it is processed
+        modulationMatrix.analyse(block.getSubBlock(startSample, samplesToProcess));
         //advance each smoother 'samplesToProcess' samples
         updateSmoothersFromParams(samplesToProcess, SmootherUpdateMode::liveInRealtime); // (5)
-
-        //update the DSP 
-        leftChannel.updateDSPFromParams();  // (6)
-        rightChannel.updateDSPFromParams();
+        updateGeneralFilterCoefficients();
+        updateLinearPhaseEQKernel();
+        updateCrossoverCoefficients();
+        if (updatePrePostFilterCoefficients())
+            filters.setCoefficients(prePostFilterCoefficients);
 
         //create a sub block from the buffer, and
         auto subBlock = block.getSubBlock(startSample, samplesToProcess); // (7)
+        //the linear-phase EQ adds its latency once the timer has allocated it
+        mixer.setLatency(getChainLatency());
+        mixer.pushDry(subBlock, preSumsOfSquares.data());
+        if (filters.pre.isActive())
+            filters.pre.process(subBlock);
+
+        //the encode and decode touch only this sub-block, while it is still in cache
+        const auto midSide = isLiveMidSide();
+        if (midSide)
+            encodeMidSide(subBlock);
+
+        /*
+         in mid/side mode the chains differ, so they always both run.
+         so do they while convolving: each channel has its own tail, which can't be copied from the other's.
+         and while the reverb runs, since each channel sums its lines with different signs.
+         and while the overdrive runs: juce::dsp::LadderFilter's state can't be copied across without allocating.
+         */
+        const auto inputsMatch = !midSide
+                              && isLiveStageOff(DSP_Option::Convolution)
+                              && isLiveStageOff(DSP_Option::Reverb)
+                              && isLiveStageOff(DSP_Option::OverDrive)
+                              && channelsMatch(subBlock);
+        const auto leavingDualMono = dualMono && !inputsMatch;
+        if (leavingDualMono)
+        {
+            dualMono = false;
+            dualMonoMatchedSamples = 0;
+        }
+
+        withActiveChain([this, &subBlock, leavingDualMono](auto& left, auto& right)
+        {
+            //only the chain matching SampleType is ever active here, see the check above
+            if constexpr (std::is_same_v<typename std::decay_t<decltype(left)>::IOType, SampleType>)
+            {
+                //update the DSP
+                left.updateDSPFromParams();  // (6)
+                right.updateDSPFromParams();
+
+                //the right chain hasn't run since dual mono started, so it picks up from the left
+                if (leavingDualMono)
+                    right.copyStateFrom(left);
+
+                //now process
+                left.process(subBlock.getSingleChannelBlock(0), liveParams.dspOrder); // (8)
+                if (dualMono)
+                    subBlock.getSingleChannelBlock(1).copyFrom(subBlock.getSingleChannelBlock(0));
+                else
+                    right.process(subBlock.getSingleChannelBlock(1), liveParams.dspOrder);
+            }
+        });
+
+        if (!dualMono)
+        {
+            if (inputsMatch && channelsMatch(subBlock))
+                dualMonoMatchedSamples += samplesToProcess;
+            else
+                dualMonoMatchedSamples = 0;
+
+            //the chains have produced the same output for long enough; make them bit-identical and run only one
+            if (dualMonoMatchedSamples >= juce::roundToInt(dualMonoHoldSeconds * getSampleRate()))
+            {
+                withActiveChain([](auto& left, auto& right) { right.copyStateFrom(left); });
+                dualMono = true;
+            }
+        }
+
+        if (midSide)
+            decodeMidSide(subBlock);
 
-        //now process
-        leftChannel.process(subBlock.getSingleChannelBlock(0), dspOrder); // (8)
-        rightChannel.process(subBlock.getSingleChannelBlock(1), dspOrder);
+        if (filters.post.isActive())
+            filters.post.process(subBlock);
+
+        auto currentMix = globalMixPercentSmoother.getCurrentValue() * 0.01f;
+        mixer.mix(subBlock, previousGlobalMix, currentMix, postSumsOfSquares.data());
+        previousGlobalMix = currentMix;
 
         startSample += samplesToProcess; // (9)
         samplesRemaining -= samplesToProcess;
     }
 
-    leftPostRMS.set(buffer.getRMSLevel(0, 0, numSamples));
-    rightPostRMS.set(buffer.getRMSLevel(1, 0, numSamples));
+    auto toRMS = [numSamples](double sumOfSquares)
+    {
+        return numSamples > 0 ? static_cast<float>(std::sqrt(sumOfSquares / numSamples)) : 0.f;
+    };
+    leftPreRMS.set(toRMS(preSumsOfSquares[0]));
+    rightPreRMS.set(toRMS(preSumsOfSquares[1]));
+    leftPostRMS.set(toRMS(postSumsOfSquares[0]));
+    rightPostRMS.set(toRMS(postSumsOfSquares[1]));
 }
 
 //==============================================================================
@@ -873,8 +3380,10 @@ struct juce::VariantConverter<Project13AudioProcessor::DSP_Order>
             {
                 arr.push_back(mis.readInt());
             }
-            jassert(arr.size() == dspOrder.size());
-            for (size_t i = 0; i < dspOrder.size(); ++i)
+            jassert(arr.size() <= dspOrder.size());
+            //a short blob leaves END_OF_LIST entries behind, for completeDspOrder() or isValidDspOrder() to deal with
+            dspOrder.fill(Project13AudioProcessor::DSP_Option::END_OF_LIST);
+            for (size_t i = 0; i < juce::jmin(arr.size(), dspOrder.size()); ++i)
             {
                 dspOrder[i] = static_cast<Project13AudioProcessor::DSP_Option>(arr[i]);
             }
@@ -898,28 +3407,238 @@ struct juce::VariantConverter<Project13AudioProcessor::DSP_Order>
     }
 };
 //==============================================================================
+/*
+ session state format (version 4, little-endian):
+    juce::uint32 magic                          "P13S"
+    juce::uint32 version
+    juce::uint32 numParams
+    juce::uint32 orderSize
+    { juce::uint32 paramHash; float value; }    x numParams, denormalised
+    juce::uint8  order[orderSize]
+    juce::uint8  numMorphSlots                  version 3+
+    { juce::uint8 valid; [float values[numParams]; juce::uint8 order[orderSize];] if valid }  x numMorphSlots
+    string       impulseResponsePath            version 4+, UTF-8, null-terminated; empty for none
+
+ an order shorter than DSP_Order was saved before stages were added, see completeDspOrder().
+
+ version 1 was the APVTS ValueTree written with writeToStream(), with the DSP_Order stored as a binary "dspOrder" property.
+ it has no magic number, and is migrated in readLegacyState().
+ */
 void Project13AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    apvts.state.setProperty("dspOrder", 
-        juce::VariantConverter<Project13AudioProcessor::DSP_Order>::toVar(dspOrder), nullptr);
+    auto snapshot = captureParamSnapshot();
 
     juce::MemoryOutputStream mos(destData, false);
-    apvts.state.writeToStream(mos);
+    mos.writeInt(static_cast<int>(stateMagic));
+    mos.writeInt(static_cast<int>(stateVersion));
+    mos.writeInt(static_cast<int>(allParams.size()));
+    mos.writeInt(static_cast<int>(snapshot.dspOrder.size()));
+
+    for (size_t i = 0; i < allParams.size(); ++i)
+    {
+        mos.writeInt(static_cast<int>(paramHashes[i]));
+        mos.writeFloat(snapshot.values[i]);
+    }
+
+    for (auto option : snapshot.dspOrder)
+        mos.writeByte(static_cast<char>(option));
+
+    mos.writeByte(static_cast<char>(storedMorphSnapshots.size()));
+    for (size_t slot = 0; slot < storedMorphSnapshots.size(); ++slot)
+    {
+        mos.writeBool(storedMorphSnapshotValid[slot]);
+        if (!storedMorphSnapshotValid[slot])
+            continue;
+
+        const auto& morphSnapshot = storedMorphSnapshots[slot];
+        for (size_t i = 0; i < allParams.size(); ++i)
+            mos.writeFloat(morphSnapshot.values[i]);
+
+        for (auto option : morphSnapshot.dspOrder)
+            mos.writeByte(static_cast<char>(option));
+    }
+
+    mos.writeString(getImpulseResponseFile().getFullPathName());
+}
+
+Project13AudioProcessor::ParamSnapshot Project13AudioProcessor::getDefaultParamSnapshot() const
+{
+    ParamSnapshot snapshot;
+    for (size_t i = 0; i < allParams.size(); ++i)
+    {
+        auto* param = allParams[i];
+        snapshot.values[i] = param->convertFrom0to1(param->getDefaultValue());
+    }
+
+    snapshot.dspOrder.fill(DSP_Option::END_OF_LIST);
+    return snapshot;
+}
+
+bool Project13AudioProcessor::readState(const void* data, int sizeInBytes, SessionState& state) const
+{
+    if (data == nullptr || sizeInBytes < 4)
+        return false;
+
+    juce::MemoryInputStream mis(data, static_cast<size_t>(sizeInBytes), false);
+    if (static_cast<juce::uint32>(mis.readInt()) != stateMagic)
+        return readLegacyState(data, sizeInBytes, state.params);
+
+    auto version = static_cast<juce::uint32>(mis.readInt());
+    auto numParams = static_cast<juce::uint32>(mis.readInt());
+    auto orderSize = static_cast<juce::uint32>(mis.readInt());
+
+    if (version < 2 || version > stateVersion)
+        return false;
+
+    //reject counts that claim more data than there is, before reading any of it
+    auto payloadSize = juce::uint64(numParams) * 8 + orderSize;
+    if (payloadSize > static_cast<juce::uint64>(mis.getNumBytesRemaining()))
+        return false;
+
+    //where each stored value lives in ParamSnapshot::values, or -1 for parameters that no longer exist
+    std::vector<int> paramIndexForSlot(numParams, -1);
+
+    for (juce::uint32 slot = 0; slot < numParams; ++slot)
+    {
+        auto hash = static_cast<juce::uint32>(mis.readInt());
+        auto it = std::find(paramHashes.begin(), paramHashes.end(), hash);
+        if (it != paramHashes.end())
+            paramIndexForSlot[slot] = static_cast<int>(std::distance(paramHashes.begin(), it));
+
+        setSnapshotValue(state.params, paramIndexForSlot[slot], mis.readFloat());
+    }
+
+    readDspOrder(mis, orderSize, state.params.dspOrder);
+
+    if (version < 3 || mis.isExhausted())
+        return true;
+
+    auto numMorphSlots = juce::jmin(static_cast<size_t>(static_cast<juce::uint8>(mis.readByte())), state.morphSnapshots.size());
+    for (size_t morphSlot = 0; morphSlot < numMorphSlots; ++morphSlot)
+    {
+        if (!mis.readBool())
+            continue;
+
+        if (juce::uint64(numParams) * 4 + orderSize > static_cast<juce::uint64>(mis.getNumBytesRemaining()))
+            return true;
+
+        auto& morphSnapshot = state.morphSnapshots[morphSlot];
+        for (juce::uint32 slot = 0; slot < numParams; ++slot)
+            setSnapshotValue(morphSnapshot, paramIndexForSlot[slot], mis.readFloat());
+
+        readDspOrder(mis, orderSize, morphSnapshot.dspOrder);
+        state.morphSnapshotValid[morphSlot] = isValidDspOrder(morphSnapshot.dspOrder);
+    }
+
+    if (version >= 4 && !mis.isExhausted())
+        state.impulseResponsePath = mis.readString();
+
+    return true;
+}
+
+void Project13AudioProcessor::setSnapshotValue(ParamSnapshot& snapshot, int paramIndex, float value)
+{
+    //unknown parameters are skipped, missing ones keep their default
+    if (paramIndex >= 0 && std::isfinite(value))
+        snapshot.values[static_cast<size_t>(paramIndex)] = value;
+}
+
+void Project13AudioProcessor::readDspOrder(juce::InputStream& stream, juce::uint32 orderSize, DSP_Order& order)
+{
+    //a longer order comes from a newer build, with stages this one doesn't have
+    if (orderSize > order.size())
+    {
+        stream.skipNextBytes(orderSize);
+        return;
+    }
+
+    order.fill(DSP_Option::END_OF_LIST);
+    for (juce::uint32 i = 0; i < orderSize; ++i)
+        order[i] = static_cast<DSP_Option>(static_cast<juce::uint8>(stream.readByte()));
+
+    if (orderSize < order.size())
+        completeDspOrder(order);
+}
+
+bool Project13AudioProcessor::readLegacyState(const void* data, int sizeInBytes, ParamSnapshot& snapshot) const
+{
+    auto tree = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+    if (!tree.isValid() || !tree.hasType(apvts.state.getType()))
+        return false;
+
+    //APVTS stores each parameter as a PARAM child holding its id and denormalised value
+    for (const auto& child : tree)
+    {
+        auto id = child.getProperty("id").toString();
+        auto value = child.getProperty("value");
+        if (id.isEmpty() || value.isVoid())
+            continue;
+
+        for (size_t i = 0; i < allParams.size(); ++i)
+        {
+            if (allParams[i]->getParameterID() == id)
+            {
+                setSnapshotValue(snapshot, static_cast<int>(i), static_cast<float>(value));
+                break;
+            }
+        }
+    }
+
+    if (tree.hasProperty("dspOrder"))
+    {
+        snapshot.dspOrder = juce::VariantConverter<Project13AudioProcessor::DSP_Order>::fromVar(tree.getProperty("dspOrder"));
+        completeDspOrder(snapshot.dspOrder);
+    }
+
+    return true;
+}
+
+void Project13AudioProcessor::applyParamValues(const ParamSnapshot& snapshot)
+{
+    /*
+     only parameters that actually changed are touched.
+     this replaces apvts.replaceState(), which rebuilds the ValueTree and notifies every parameter.
+     */
+    for (size_t i = 0; i < allParams.size(); ++i)
+    {
+        auto* param = allParams[i];
+        auto normalised = param->convertTo0to1(snapshot.values[i]);
+        if (param->getValue() != normalised)
+            param->setValueNotifyingHost(normalised);
+    }
 }
 
 void Project13AudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid())
+    SessionState state;
+    state.params = getDefaultParamSnapshot();
+    state.morphSnapshots.fill(state.params);
+    if (readState(data, sizeInBytes, state))
     {
-        apvts.replaceState(tree);
-        if (apvts.state.hasProperty("dspOrder"))
+        //the session replaces any program still waiting to be synced, and the audio thread reads the parameters again
         {
-            auto order = juce::VariantConverter<Project13AudioProcessor::DSP_Order>::fromVar(apvts.state.getProperty("dspOrder"));
-            dspOrderFifo.push(order);
-            restoreDspOrderFifo.push(order);
+            const juce::ScopedLock sl(programLock);
+            pendingProgramSerial = 0;
+            syncedProgramSerial.store(lastProgramSerial, std::memory_order_release);
         }
-        DBG(apvts.state.toXmlString());
+        applyParamValues(state.params);
+        if (isValidDspOrder(state.params.dspOrder))
+            setDspOrder(state.params.dspOrder);
+
+        for (size_t slot = 0; slot < state.morphSnapshots.size(); ++slot)
+        {
+            MorphSnapshotUpdate update;
+            update.slot = static_cast<MorphSlot>(slot);
+            update.snapshot = state.morphSnapshots[slot];
+            update.valid = state.morphSnapshotValid[slot];
+
+            storedMorphSnapshots[slot] = update.snapshot;
+            storedMorphSnapshotValid[slot] = update.valid;
+            pushAudioCommand(StoreMorphSnapshotCommand { update });
+        }
+
+        //a path that is no longer absolute, e.g. from another OS, is dropped
+        loadImpulseResponse(juce::File::isAbsolutePath(state.impulseResponsePath) ? juce::File(state.impulseResponsePath) : juce::File());
 
 #if VERIFY_BYPASS_FUNCTIONALITY
         juce::Timer::callAfterDelay(1000, [this]()
@@ -930,7 +3649,7 @@ void Project13AudioProcessor::setStateInformation (const void* data, int sizeInB
 
         //bypass the Chorus
         chorusBypass->setValueNotifyingHost(1.f);
-        dspOrderFifo.push(order);
+        setDspOrder(order);
             });
 #endif
 
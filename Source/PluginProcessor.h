@@ -9,7 +9,28 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include <Fifo.h>
+#include <variant>
+#include <optional>
+#include "PresetBank.h"
+#include "DSP/Arena.h"
+#include "DSP/StageProcessor.h"
+#include "DSP/ArenaPhaser.h"
+#include "DSP/ArenaChorus.h"
+#include "DSP/Biquad.h"
+#include "DSP/BiquadCascade.h"
+#include "DSP/ZdfLadder.h"
+#include "DSP/TptSvf.h"
+#include "DSP/HalfBandResampler.h"
+#include "DSP/CoefficientWorker.h"
+#include "DSP/CommandQueue.h"
+#include "DSP/TripleBuffer.h"
+#include "DSP/ModulationMatrix.h"
+#include "DSP/LatencyCompensatedMix.h"
+#include "DSP/PartitionedConvolver.h"
+#include "DSP/LinearPhaseEQ.h"
+#include "DSP/LookaheadCompressor.h"
+#include "DSP/FdnReverb.h"
+#include "DSP/LinkwitzRileyCrossover.h"
 
 
 //==============================================================================
@@ -19,6 +40,8 @@ class Project13AudioProcessor  : public juce::AudioProcessor
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
+                             , private juce::Timer
+                             , private juce::AudioProcessorParameter::Listener
 {
 public:
     //==============================================================================
@@ -34,6 +57,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -66,6 +91,10 @@ public:
         OverDrive,
         LadderFilter,
         GeneralFilter,
+        Convolution,
+        LinearPhaseEQ,
+        Dynamics,
+        Reverb,
         END_OF_LIST
     };
 
@@ -78,6 +107,13 @@ public:
         END_OF_LIST
     };
 
+    enum class GeneralFilterEngine
+    {
+        Biquad,
+        SVF,
+        END_OF_LIST
+    };
+
     //==============================================================================
     static constexpr int NEGATIVE_INFINITY = -72;
     static constexpr int MAX_DECIBELS = 12;
@@ -87,7 +123,16 @@ public:
     //==============================================================================
 
     using DSP_Order = std::array<DSP_Option, static_cast<size_t>(DSP_Option::END_OF_LIST)>;
-    SimpleMBComp::Fifo<DSP_Order> dspOrderFifo, restoreDspOrderFifo;
+    /*
+     any thread but the audio thread.
+     queues the order for the audio thread and publishes it for the editor, see readDspOrder().
+     */
+    void setDspOrder(const DSP_Order& newOrder);
+    /*
+     message thread, for the editor.  returns true, with the latest order, if it changed since the last call,
+     or always with 'evenIfUnchanged', for an editor that has just opened.
+     */
+    bool readDspOrder(DSP_Order& order, bool evenIfUnchanged);
 
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts { *this, nullptr, "Settings", createParameterLayout() };
@@ -118,11 +163,88 @@ public:
     juce::AudioParameterBool* ladderFilterBypass = nullptr;
 
     juce::AudioParameterChoice* generalFilterMode = nullptr;
+    juce::AudioParameterChoice* generalFilterEngine = nullptr;
+
+    juce::AudioParameterChoice* internalRateCap = nullptr;
     juce::AudioParameterFloat* generalFilterFreqHz = nullptr;
     juce::AudioParameterFloat* generalFilterQuality = nullptr;
     juce::AudioParameterFloat* generalFilterGain = nullptr;
     juce::AudioParameterBool* generalFilterBypass = nullptr;
 
+    juce::AudioParameterFloat* morphAmount = nullptr;
+    juce::AudioParameterFloat* morphSwitchPoint = nullptr;
+    juce::AudioParameterBool* morphEnabled = nullptr;
+
+    juce::AudioParameterBool* doublePrecisionFilters = nullptr;
+
+    juce::AudioParameterBool* midSideMode = nullptr;
+    juce::AudioParameterChoice* phaserMidSide = nullptr;
+    juce::AudioParameterChoice* chorusMidSide = nullptr;
+    juce::AudioParameterChoice* overdriveMidSide = nullptr;
+    juce::AudioParameterChoice* ladderFilterMidSide = nullptr;
+    juce::AudioParameterChoice* generalFilterMidSide = nullptr;
+
+    juce::AudioParameterFloat* globalMixPercent = nullptr;
+
+    juce::AudioParameterFloat* preHpfFreqHz = nullptr;
+    juce::AudioParameterChoice* preHpfSlope = nullptr;
+    juce::AudioParameterFloat* preLpfFreqHz = nullptr;
+    juce::AudioParameterChoice* preLpfSlope = nullptr;
+    juce::AudioParameterBool* preFilterBypass = nullptr;
+
+    juce::AudioParameterFloat* postHpfFreqHz = nullptr;
+    juce::AudioParameterChoice* postHpfSlope = nullptr;
+    juce::AudioParameterFloat* postLpfFreqHz = nullptr;
+    juce::AudioParameterChoice* postLpfSlope = nullptr;
+    juce::AudioParameterBool* postFilterBypass = nullptr;
+
+    juce::AudioParameterFloat* convolutionMixPercent = nullptr;
+    juce::AudioParameterFloat* convolutionGain = nullptr;
+    juce::AudioParameterChoice* convolutionMidSide = nullptr;
+    juce::AudioParameterBool* convolutionBypass = nullptr;
+
+    juce::AudioParameterFloat* linearPhaseEQLowFreqHz = nullptr;
+    juce::AudioParameterFloat* linearPhaseEQLowGain = nullptr;
+    juce::AudioParameterFloat* linearPhaseEQMidFreqHz = nullptr;
+    juce::AudioParameterFloat* linearPhaseEQMidQuality = nullptr;
+    juce::AudioParameterFloat* linearPhaseEQMidGain = nullptr;
+    juce::AudioParameterFloat* linearPhaseEQHighFreqHz = nullptr;
+    juce::AudioParameterFloat* linearPhaseEQHighGain = nullptr;
+    juce::AudioParameterChoice* linearPhaseEQFFTSize = nullptr;
+    juce::AudioParameterChoice* linearPhaseEQMidSide = nullptr;
+    juce::AudioParameterBool* linearPhaseEQBypass = nullptr;
+
+    juce::AudioParameterFloat* dynamicsThresholdDb = nullptr;
+    juce::AudioParameterFloat* dynamicsRatio = nullptr;
+    juce::AudioParameterFloat* dynamicsAttackMs = nullptr;
+    juce::AudioParameterFloat* dynamicsReleaseMs = nullptr;
+    juce::AudioParameterFloat* dynamicsMakeupDb = nullptr;
+    juce::AudioParameterFloat* dynamicsLookaheadMs = nullptr;
+    juce::AudioParameterChoice* dynamicsMidSide = nullptr;
+    juce::AudioParameterBool* dynamicsBypass = nullptr;
+
+    juce::AudioParameterFloat* reverbSizePercent = nullptr;
+    juce::AudioParameterFloat* reverbDecaySeconds = nullptr;
+    juce::AudioParameterFloat* reverbDampingPercent = nullptr;
+    juce::AudioParameterFloat* reverbModDepthPercent = nullptr;
+    juce::AudioParameterFloat* reverbMixPercent = nullptr;
+    juce::AudioParameterChoice* reverbMidSide = nullptr;
+    juce::AudioParameterBool* reverbBypass = nullptr;
+
+    juce::AudioParameterChoice* multibandMode = nullptr;
+    juce::AudioParameterFloat* crossover1FreqHz = nullptr;
+    juce::AudioParameterFloat* crossover2FreqHz = nullptr;
+    juce::AudioParameterFloat* crossover3FreqHz = nullptr;
+    juce::AudioParameterChoice* phaserBand = nullptr;
+    juce::AudioParameterChoice* chorusBand = nullptr;
+    juce::AudioParameterChoice* overdriveBand = nullptr;
+    juce::AudioParameterChoice* ladderFilterBand = nullptr;
+    juce::AudioParameterChoice* generalFilterBand = nullptr;
+    juce::AudioParameterChoice* convolutionBand = nullptr;
+    juce::AudioParameterChoice* linearPhaseEQBand = nullptr;
+    juce::AudioParameterChoice* dynamicsBand = nullptr;
+    juce::AudioParameterChoice* reverbBand = nullptr;
+
     juce::SmoothedValue<float>
         phaserRateHzSmoother,
         phaserCenterFreqHzSmoother,
@@ -140,12 +262,32 @@ public:
         ladderFilterDriveSmoother,
         generalFilterFreqHzSmoother,
         generalFilterQualitySmoother,
-        generalFilterGainSmoother;
+        generalFilterGainSmoother,
+        globalMixPercentSmoother,
+        preHpfFreqHzSmoother,
+        preLpfFreqHzSmoother,
+        postHpfFreqHzSmoother,
+        postLpfFreqHzSmoother,
+        convolutionMixPercentSmoother,
+        convolutionGainSmoother,
+        crossover1FreqHzSmoother,
+        crossover2FreqHzSmoother,
+        crossover3FreqHzSmoother,
+        dynamicsThresholdDbSmoother,
+        dynamicsRatioSmoother,
+        dynamicsAttackMsSmoother,
+        dynamicsReleaseMsSmoother,
+        dynamicsMakeupDbSmoother,
+        reverbSizePercentSmoother,
+        reverbDecaySecondsSmoother,
+        reverbDampingPercentSmoother,
+        reverbModDepthPercentSmoother,
+        reverbMixPercentSmoother;
 
-    juce::Atomic<bool> guiNeedsLatestDspOrder{ false };
     juce::Atomic<float> leftPreRMS, rightPreRMS, leftPostRMS, rightPostRMS;
 
     std::vector<juce::SmoothedValue<float>*> getSmoothers();
+    std::vector<juce::RangedAudioParameter*> getParamsNeedingSmoothing();
     enum class SmootherUpdateMode
     {
         initialize,
@@ -154,29 +296,628 @@ public:
     void updateSmoothersFromParams(int numSamplesToSkip, SmootherUpdateMode init);
 
     std::vector<juce::RangedAudioParameter*> getParamsForOptions(DSP_Option option);
+
+    /*
+     A ParamSnapshot holds the denormalised value of every parameter, in APVTS layout order, plus the DSP_Order.
+     It is plain data, so it can be handed to the audio thread through a mailbox or the CommandQueue without allocating.
+     The constructor refuses to run with more parameters than this.
+     */
+    static constexpr size_t maxNumParams = 160;
+    struct ParamSnapshot
+    {
+        std::array<float, maxNumParams> values {};
+        DSP_Order dspOrder {};
+    };
+    ParamSnapshot captureParamSnapshot() const;
+    static bool isValidDspOrder(const DSP_Order& order);
+
+    juce::StringArray getPresetNames() const;
+    bool savePresetToBank(const juce::String& name);
+    static juce::File getPresetBankFile();
+
+    enum class MorphSlot
+    {
+        A,
+        B
+    };
+    /*
+     captures the current parameter values as morph snapshot A or B.
+     the Morph % parameter then interpolates between them on the audio thread, without touching the parameters.
+     */
+    void storeMorphSnapshot(MorphSlot slot);
+
+    /*
+     heap and object memory held by this instance.
+     stage sizes cover both channels and are 0 for stages that are not allocated.
+     */
+    struct MemoryReport
+    {
+        size_t instanceBytes = 0;
+        size_t arenaBytes = 0;
+        std::array<size_t, static_cast<size_t>(DSP_Option::END_OF_LIST)> stageBytes {};
+        std::array<bool, static_cast<size_t>(DSP_Option::END_OF_LIST)> stageReady {};
+        size_t totalBytes = 0;
+
+        juce::String toString() const;
+    };
+    MemoryReport getMemoryReport() const;
+
+    /*
+     message thread.  loads the impulse response the convolution stage uses, on a background thread;
+     the stage picks it up once it is read and transformed.  an empty File removes the current one.
+     */
+    void loadImpulseResponse(const juce::File& file);
+    juce::File getImpulseResponseFile() const;
+
+    /*
+     message thread.  in multiband mode a full-signal stage placed between two stages on a band can't run there,
+     so it runs after the bands are summed, see MonoChannelDSP::process().  true at each such position in the order.
+     */
+    std::array<bool, static_cast<size_t>(DSP_Option::END_OF_LIST)> getStagesMovedAfterBands(const DSP_Order& order) const;
 private:
     //==============================================================================
     DSP_Order dspOrder;
 
-    template<typename DSP>
-    struct DSP_Choice : juce::dsp::ProcessorBase
+    //every parameter in APVTS layout order, and the hash of its ID, for ParamSnapshot/PresetBank
+    std::vector<juce::RangedAudioParameter*> allParams;
+    std::vector<juce::uint32> paramHashes;
+
+    /*
+     hosts may change the program from any thread, so the bank's mapping, the current program and the program
+     waiting to be synced (pendingProgram and its serials) are only touched under programLock.
+     the audio thread never takes it.
+     */
+    PresetBank presetBank;
+    int currentProgram = 0;
+    mutable juce::CriticalSection programLock;
+
+    /*
+     the chain as last requested from outside the audio thread: the order, and the last program loaded.
+     every change rewrites the whole request and publishes it, so the audio thread only ever needs the latest one:
+     nothing is dropped when requests come faster than blocks, and a reorder made after a program change
+     is not undone by it, since the request carries both.
+     the order also goes to the editor through its own mailbox.
+     the lock makes the threads that change it a single producer; the audio thread never takes it.
+     */
+    struct ChainRequest
+    {
+        DSP_Order order {};
+        ParamSnapshot program;
+        juce::uint32 programSerial = 0;
+    };
+    ChainRequest requestedChain;
+    TripleBuffer<ChainRequest> chainRequests;
+    TripleBuffer<DSP_Order> editorDspOrder;
+    mutable juce::SpinLock dspOrderRequestLock;
+    void publishDspOrder(const DSP_Order& newOrder);
+    void applyChainRequest();
+
+    size_t getParamIndex(const juce::RangedAudioParameter* param) const;
+
+    /*
+     liveParams holds the value in effect for the current sub-block, for every parameter.
+     it is refreshed from the parameters once per sub-block, then overridden by the morph.
+     the DSP reads choices, bypasses and the DSP_Order from here instead of from the parameters directly.
+     */
+    ParamSnapshot liveParams;
+    void updateLiveParams();
+
+    /*
+     every parameter's denormalised value, kept up to date by parameterValueChanged() on whichever thread changes it,
+     so updateLiveParams() doesn't ask each parameter for its value every sub-block.
+     a change stores the value, then sets its flag, then paramsChanged; the audio thread copies only flagged values.
+     */
+    std::array<std::atomic<float>, maxNumParams> latestParamValues;
+    std::array<std::atomic<bool>, maxNumParams> paramChanged;
+    std::atomic<bool> paramsChanged { false };
+    //audio thread: the values as of the last sub-block
+    std::array<float, maxNumParams> paramValues {};
+    //juce::AudioProcessorParameter::getParameterIndex() -> position in allParams
+    std::vector<size_t> paramIndexForParameter;
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+
+    /*
+     the modulation matrix adds its offsets to liveParams after the morph, before the smoothers pick the values up.
+     its own settings (LFO rates, routings, ...) are parameters too, and are read from liveParams, so they morph like everything else.
+     */
+    ModulationMatrix modulationMatrix;
+    struct ModulationParamIndices
+    {
+        std::array<size_t, ModulationMatrix::numLfos> lfoRate {}, lfoShape {};
+        std::array<size_t, ModulationMatrix::numEnvelopes> envAttack {}, envRelease {};
+        std::array<size_t, ModulationMatrix::numRoutings> routeSource {}, routeTarget {}, routeDepth {};
+    };
+    ModulationParamIndices modParamIndices;
+    //for each modulation target, the parameter it modulates and that parameter's range
+    std::array<size_t, ModulationMatrix::maxNumTargets> modTargetParamIndices {};
+    std::array<const juce::NormalisableRange<float>*, ModulationMatrix::maxNumTargets> modTargetRanges {};
+    size_t numModTargets = 0;
+    void applyModulation();
+
+    struct SmoothedParam
+    {
+        juce::SmoothedValue<float>* smoother = nullptr;
+        size_t paramIndex = 0;
+    };
+    std::vector<SmoothedParam> smoothedParams;
+
+    std::array<size_t, static_cast<size_t>(DSP_Option::END_OF_LIST)> bypassParamIndices {};
+    size_t ladderFilterModeIndex = 0;
+    size_t generalFilterModeIndex = 0;
+    size_t generalFilterEngineIndex = 0;
+
+    /*
+     general filter coefficients are computed once per instance, on the shared CoefficientWorker,
+     and both channels pick up the latest published set every sub-block.
+     */
+    struct GeneralFilterSettings
+    {
+        int mode = -1;
+        float freq = 0.f, quality = 0.f, gain = 0.f;
+        double sampleRate = 0.0;
+
+        bool operator==(const GeneralFilterSettings&) const = default;
+    };
+    static BiquadCoefficients makeGeneralFilterCoefficients(const GeneralFilterSettings& settings);
+    GeneralFilterSettings getGeneralFilterSettings() const;
+    void updateGeneralFilterCoefficients();
+
+    GeneralFilterSettings requestedGeneralFilterSettings;
+    BiquadCoefficients generalFilterCoefficients;
+    CoefficientRequests<GeneralFilterSettings, BiquadCoefficients> generalFilterCoefficientRequests { &makeGeneralFilterCoefficients };
+
+    /*
+     the pre filters run on the input before the DSP_Order chain, the post filters on its output.
+     each is a Butterworth high-pass and low-pass; a filter at the end of its frequency range is left out.
+     their coefficients come from the CoefficientWorker too, through their own requests.
+     */
+    struct FilterPairParamIndices
+    {
+        size_t hpfSlope = 0, lpfSlope = 0, bypass = 0;
+    };
+    std::array<FilterPairParamIndices, 2> prePostFilterParamIndices {};
+
+    struct FilterPairSettings
+    {
+        bool bypassed = true;
+        float hpfFreq = 0.f, lpfFreq = 0.f;
+        int hpfSlope = 0, lpfSlope = 0;
+
+        bool operator==(const FilterPairSettings&) const = default;
+    };
+    struct PrePostFilterSettings
+    {
+        FilterPairSettings pre, post;
+        double sampleRate = 0.0;
+
+        bool operator==(const PrePostFilterSettings&) const = default;
+    };
+    struct PrePostFilterCoefficients
+    {
+        BiquadCascadeCoefficients pre, post;
+    };
+    static BiquadCascadeCoefficients makeFilterPairCoefficients(const FilterPairSettings& settings, double sampleRate);
+    static PrePostFilterCoefficients makePrePostFilterCoefficients(const PrePostFilterSettings& settings);
+    PrePostFilterSettings getPrePostFilterSettings() const;
+    //returns true when new coefficients arrived
+    bool updatePrePostFilterCoefficients();
+
+    PrePostFilterSettings requestedPrePostFilterSettings;
+    PrePostFilterCoefficients prePostFilterCoefficients;
+    CoefficientRequests<PrePostFilterSettings, PrePostFilterCoefficients> prePostFilterCoefficientRequests { &makePrePostFilterCoefficients };
+
+    /*
+     the linear-phase EQ's kernel is designed once per instance, on the CoefficientWorker, like the general filter's coefficients.
+     its bands aren't smoothed: every new kernel is crossfaded in by the EQ itself, so they are read straight from liveParams.
+     */
+    struct LinearPhaseEQParamIndices
+    {
+        size_t lowFreq = 0, lowGain = 0, midFreq = 0, midQuality = 0, midGain = 0, highFreq = 0, highGain = 0;
+    };
+    LinearPhaseEQParamIndices linearPhaseEQParamIndices;
+
+    struct LinearPhaseEQSettings
+    {
+        float lowFreq = 0.f, lowGain = 0.f;
+        float midFreq = 0.f, midQuality = 0.f, midGain = 0.f;
+        float highFreq = 0.f, highGain = 0.f;
+        int fftOrder = 0;
+        double sampleRate = 0.0;
+
+        bool operator==(const LinearPhaseEQSettings&) const = default;
+    };
+    static LinearPhaseKernel makeLinearPhaseEQKernel(const LinearPhaseEQSettings& settings);
+    LinearPhaseEQSettings getLinearPhaseEQSettings() const;
+    void updateLinearPhaseEQKernel();
+
+    LinearPhaseEQSettings requestedLinearPhaseEQSettings;
+    LinearPhaseKernel linearPhaseEQKernel;
+    //counts the kernels pulled from the thread, so each channel takes every one exactly once
+    juce::uint32 linearPhaseEQKernelSerial = 0;
+    CoefficientRequests<LinearPhaseEQSettings, LinearPhaseKernel> linearPhaseEQKernelRequests { &makeLinearPhaseEQKernel };
+
+    /*
+     in multiband mode each channel's chain splits its input into bands, see MonoChannelDSP::process().
+     the crossover coefficients come from the CoefficientWorker, like the pre/post filters'.
+     the number of bands the chains use is the one in the latest coefficients, so the split and the bands it feeds always agree.
+     */
+    size_t multibandModeIndex = 0;
+    std::array<size_t, static_cast<size_t>(DSP_Option::END_OF_LIST)> bandParamIndices {};
+    //the band a stage runs on in multiband mode, or -1 for the full signal
+    int getLiveStageBand(DSP_Option option) const { return getLiveChoiceIndex(bandParamIndices[static_cast<size_t>(option)]) - 1; }
+
+    struct CrossoverSettings
+    {
+        size_t numBands = 1;
+        std::array<float, LinkwitzRileyCoefficients::maxNumCrossovers> frequencies {};
+        double sampleRate = 0.0;
+
+        bool operator==(const CrossoverSettings&) const = default;
+    };
+    static LinkwitzRileyCoefficients makeCrossoverCoefficients(const CrossoverSettings& settings);
+    CrossoverSettings getCrossoverSettings() const;
+    void updateCrossoverCoefficients();
+
+    CrossoverSettings requestedCrossoverSettings;
+    LinkwitzRileyCoefficients crossoverCoefficients;
+    CoefficientRequests<CrossoverSettings, LinkwitzRileyCoefficients> crossoverCoefficientRequests { &makeCrossoverCoefficients };
+
+    template<typename SampleType>
+    struct PrePostFilters
     {
-        void prepare(const juce::dsp::ProcessSpec& spec) override
+        BiquadCascade<SampleType> pre, post;
+
+        void reset()
         {
-            dsp.prepare(spec);
+            pre.reset();
+            post.reset();
         }
 
-        void process(const juce::dsp::ProcessContextReplacing<float>& context) override
+        void setCoefficients(const PrePostFilterCoefficients& c)
         {
-            dsp.process(context);
+            pre.setCoefficients(c.pre);
+            post.setCoefficients(c.post);
+        }
+    };
+    //one per host precision, like the global mix
+    PrePostFilters<float> prePostFilters;
+    PrePostFilters<double> prePostFiltersDouble;
+
+    template<typename SampleType>
+    PrePostFilters<SampleType>& getPrePostFilters()
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return prePostFiltersDouble;
+        else
+            return prePostFilters;
+    }
+
+    int getLiveChoiceIndex(size_t paramIndex) const { return juce::roundToInt(liveParams.values[paramIndex]); }
+    bool isLiveBypassed(DSP_Option option) const { return liveParams.values[bypassParamIndices[static_cast<size_t>(option)]] > 0.5f; }
+    //bypassed, or with nothing to process: the convolution stage isn't allocated until it has an impulse response
+    bool isLiveStageOff(DSP_Option option) const
+    {
+        return isLiveBypassed(option) || (option == DSP_Option::Convolution && convolutionSet == nullptr);
+    }
+
+    /*
+     in mid/side mode the left channel's chain runs on mid and the right channel's chain on side.
+     each stage can be limited to one of them; it is bypassed on the other.
+     */
+    enum class MidSideAssignment
+    {
+        Both,
+        Mid,
+        Side
+    };
+    std::array<size_t, static_cast<size_t>(DSP_Option::END_OF_LIST)> midSideParamIndices {};
+    size_t midSideModeIndex = 0;
+    bool isLiveMidSide() const { return liveParams.values[midSideModeIndex] > 0.5f; }
+    bool isStageActiveOnChannel(DSP_Option option, int channel) const
+    {
+        if (!isLiveMidSide())
+            return true;
+
+        switch (static_cast<MidSideAssignment>(getLiveChoiceIndex(midSideParamIndices[static_cast<size_t>(option)])))
+        {
+        case MidSideAssignment::Both:
+            return true;
+        case MidSideAssignment::Mid:
+            return channel == 0;
+        case MidSideAssignment::Side:
+            return channel == 1;
+        }
+
+        return true;
+    }
+
+    enum class MorphBehaviour
+    {
+        interpolate,
+        switchAtPoint,
+        ignore
+    };
+    std::vector<MorphBehaviour> morphBehaviours;
+
+    struct MorphSnapshotUpdate
+    {
+        MorphSlot slot = MorphSlot::A;
+        ParamSnapshot snapshot;
+        bool valid = true;
+    };
+
+    /*
+     discrete changes for the audio thread.  they are applied at the start of the next block, one by one,
+     in the order they were made.  the order and programs go through chainRequests instead.
+     */
+    struct StoreMorphSnapshotCommand
+    {
+        MorphSnapshotUpdate update;
+    };
+    struct ConvolutionSet;
+    struct SetConvolutionCommand
+    {
+        ConvolutionSet* set = nullptr;
+    };
+    //see retireStage()
+    struct RetireStageCommand
+    {
+        juce::uint32 serial = 0;
+    };
+    using AudioCommand = std::variant<StoreMorphSnapshotCommand, SetConvolutionCommand, RetireStageCommand>;
+    CommandQueue<AudioCommand, 32> audioCommands;
+    void pushAudioCommand(const AudioCommand& command);
+    void applyAudioCommands();
+
+    /*
+     commands the queue had no room for, e.g. while the audio thread isn't running.
+     timerCallback() sends them on, oldest first, and new commands queue up behind them so the order is kept.
+     while they wait, a newer command for the same morph slot, or a newer impulse response, replaces an older one.
+     */
+    std::vector<AudioCommand> unsentAudioCommands;
+    juce::CriticalSection unsentAudioCommandsLock;
+    void sendUnsentAudioCommands();
+
+    //audio thread copies
+    std::array<ParamSnapshot, 2> morphSnapshots;
+    std::array<bool, 2> morphSnapshotStored { false, false };
+    //message thread copies, for getStateInformation()
+    std::array<ParamSnapshot, 2> storedMorphSnapshots;
+    std::array<bool, 2> storedMorphSnapshotValid { false, false };
+
+    //called under programLock.  false if a stored preset can't be read, so rewriting the bank would lose it
+    bool readAllPresets(std::vector<PresetBank::Preset>& presets) const;
+    bool rewritePresetBank(const std::vector<PresetBank::Preset>& presets);
+    void applyParamSnapshot(const ParamSnapshot& snapshot, juce::uint32 serial);
+    void applyParamValues(const ParamSnapshot& snapshot);
+
+    /*
+     a program change only swaps the snapshot the DSP reads on the audio thread, see applyParamSnapshot().
+     setValueNotifyingHost() calls into the host and every listener, so the parameters are set to match
+     afterwards on the message thread, in syncParamsToProgram(), once the audio thread has acknowledged the swap.
+     until then liveParams are read from the program instead of the parameters.
+     */
+    //audio thread
+    ParamSnapshot programSnapshot;
+    juce::uint32 activeProgramSerial = 0;
+    bool programOverridesParams = false;
+    //audio thread -> message thread: the last program swapped in
+    std::atomic<juce::uint32> appliedProgramSerial { 0 };
+    //message thread -> audio thread: the last program the parameters match
+    std::atomic<juce::uint32> syncedProgramSerial { 0 };
+    //under programLock
+    ParamSnapshot pendingProgram;
+    juce::uint32 pendingProgramSerial = 0, lastProgramSerial = 0;
+    void syncParamsToProgram();
+
+    static constexpr juce::uint32 stateMagic = 0x53333150; // "P13S"
+    static constexpr juce::uint32 stateVersion = 4;
+    struct SessionState
+    {
+        ParamSnapshot params;
+        std::array<ParamSnapshot, 2> morphSnapshots;
+        std::array<bool, 2> morphSnapshotValid { false, false };
+        juce::String impulseResponsePath;
+    };
+    ParamSnapshot getDefaultParamSnapshot() const;
+    bool readState(const void* data, int sizeInBytes, SessionState& state) const;
+    static void setSnapshotValue(ParamSnapshot& snapshot, int paramIndex, float value);
+    static void readDspOrder(juce::InputStream& stream, juce::uint32 orderSize, DSP_Order& order);
+    //an order saved before stages were added gets the new ones, in DSP_Option order, in place of its END_OF_LIST entries
+    static void completeDspOrder(DSP_Order& order);
+    bool readLegacyState(const void* data, int sizeInBytes, ParamSnapshot& snapshot) const;
+
+    /*
+     wraps a processor as a stage of a chain that runs at SampleType.
+     when the processor runs at a different precision, e.g. a double filter in the float chain,
+     each block is converted into a scratch buffer carved from the arena and back.
+     */
+    template<typename DSP, typename SampleType = float>
+    struct DSP_Choice : StageProcessor<SampleType>
+    {
+        using DSPSampleType = typename ProcessorSampleType<DSP>::type;
+        static constexpr bool convertsPrecision = !std::is_same_v<DSPSampleType, SampleType>;
+
+        /*
+         with a decimation factor above 1 the DSP runs at sampleRate / decimation, between a HalfBandResampler's
+         decimate() and interpolate(), and the stage delays its output by HalfBandResampler::getLatencySamples(decimation).
+         'dspArgs' are passed on to the DSP's getArenaBytes() and prepare(), after the spec.
+         */
+        template<typename... DSPArgs>
+        void prepare(const juce::dsp::ProcessSpec& spec, Arena& arena, int decimation = 1, DSPArgs... dspArgs)
+        {
+            static_assert(sizeof...(DSPArgs) == 0 || ArenaProcessor<DSP, DSPArgs...>, "only arena processors take extra arguments");
+
+            auto dspSpec = getDSPSpec(spec, decimation);
+            if constexpr (ArenaProcessor<DSP, DSPArgs...>)
+                dsp.prepare(dspSpec, arena, dspArgs...);
+            else
+                dsp.prepare(dspSpec);
+
+            resampler = {};
+            if (decimation > 1)
+                resampler.prepare(static_cast<size_t>(spec.numChannels), static_cast<size_t>(spec.maximumBlockSize), decimation, arena);
+            wasBypassed = false;
+
+            if constexpr (convertsPrecision)
+            {
+                numChannels = static_cast<size_t>(spec.numChannels);
+                maxBlockSize = static_cast<size_t>(spec.maximumBlockSize);
+                convertedChannels = arena.allocate<DSPSampleType*>(numChannels);
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    convertedChannels[ch] = arena.allocate<DSPSampleType>(maxBlockSize);
+            }
+        }
+
+        template<typename... DSPArgs>
+        static size_t getArenaBytes(const juce::dsp::ProcessSpec& spec, int decimation = 1, DSPArgs... dspArgs)
+        {
+            size_t bytes = 0;
+            if constexpr (ArenaProcessor<DSP, DSPArgs...>)
+                bytes += DSP::getArenaBytes(getDSPSpec(spec, decimation), dspArgs...);
+
+            if (decimation > 1)
+                bytes += HalfBandResampler<DSPSampleType>::getArenaBytes(static_cast<size_t>(spec.numChannels), static_cast<size_t>(spec.maximumBlockSize), decimation);
+
+            if constexpr (convertsPrecision)
+            {
+                auto channels = static_cast<size_t>(spec.numChannels);
+                bytes += Arena::bytesFor<DSPSampleType*>(channels)
+                       + channels * Arena::bytesFor<DSPSampleType>(static_cast<size_t>(spec.maximumBlockSize));
+            }
+
+            return bytes;
+        }
+
+        void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) override
+        {
+            if constexpr (convertsPrecision)
+            {
+                auto& block = context.getOutputBlock();
+                const auto numSamples = block.getNumSamples();
+
+                if (context.isBypassed)
+                {
+                    //the output is the input either way, so nothing is converted back.  an unprepared stage has nothing to feed
+                    if constexpr (ProcessesWhileBypassed<DSP>)
+                    {
+                        if (convertedChannels == nullptr)
+                            return;
+
+                        auto converted = convertToDSPPrecision(block);
+                        juce::dsp::ProcessContextReplacing<DSPSampleType> bypassedContext(converted);
+                        bypassedContext.isBypassed = true;
+                        dsp.process(bypassedContext);
+                    }
+
+                    wasBypassed = true;
+                    return;
+                }
+
+                auto converted = convertToDSPPrecision(block);
+                processAtDSPRate(converted);
+
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                {
+                    std::transform(convertedChannels[ch], convertedChannels[ch] + numSamples, block.getChannelPointer(ch),
+                                   [](DSPSampleType x) { return static_cast<SampleType>(x); });
+                }
+            }
+            else if (resampler.isActive())
+            {
+                if (context.isBypassed)
+                {
+                    wasBypassed = true;
+                    return;
+                }
+
+                processAtDSPRate(context.getOutputBlock());
+            }
+            else
+            {
+                dsp.process(context);
+            }
         }
 
         void reset() override
         {
             dsp.reset();
+            resampler.reset();
+        }
+
+        //see MonoChannelDSP::copyStateFrom()
+        void copyStateFrom(const DSP_Choice& other)
+        {
+            dsp.copyStateFrom(other.dsp);
+            if (resampler.isActive())
+                resampler.copyStateFrom(other.resampler);
+            wasBypassed = other.wasBypassed;
+        }
+
+        /*
+         juce::dsp processors have no way to free what prepare() allocated,
+         so the processor is destroyed and default-constructed in place.
+         */
+        void release()
+        {
+            dsp.~DSP();
+            new (&dsp) DSP();
+            resampler = {};
+            convertedChannels = nullptr;
         }
 
         DSP dsp;
+    private:
+        static juce::dsp::ProcessSpec getDSPSpec(const juce::dsp::ProcessSpec& spec, int decimation)
+        {
+            if (decimation <= 1)
+                return spec;
+
+            auto maxLowRateBlockSize = HalfBandResampler<DSPSampleType>::getMaxLowRateBlockSize(static_cast<size_t>(spec.maximumBlockSize), decimation);
+            return { spec.sampleRate / decimation, static_cast<juce::uint32>(maxLowRateBlockSize), spec.numChannels };
+        }
+
+        juce::dsp::AudioBlock<DSPSampleType> convertToDSPPrecision(const juce::dsp::AudioBlock<SampleType>& block)
+        {
+            const auto numSamples = block.getNumSamples();
+            jassert(block.getNumChannels() == numChannels && numSamples <= maxBlockSize);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                const auto* samples = block.getChannelPointer(ch);
+                std::transform(samples, samples + numSamples, convertedChannels[ch],
+                               [](SampleType x) { return static_cast<DSPSampleType>(x); });
+            }
+
+            return { convertedChannels, numChannels, numSamples };
+        }
+
+        void processAtDSPRate(const juce::dsp::AudioBlock<DSPSampleType>& block)
+        {
+            if (!resampler.isActive())
+            {
+                dsp.process(juce::dsp::ProcessContextReplacing<DSPSampleType>(block));
+                return;
+            }
+
+            //the filter histories are stale after a bypass, so the stage fades in from silence like a freshly prepared one
+            if (wasBypassed)
+            {
+                resampler.reset();
+                wasBypassed = false;
+            }
+
+            auto low = resampler.decimate(block);
+            if (low.getNumSamples() > 0)
+                dsp.process(juce::dsp::ProcessContextReplacing<DSPSampleType>(low));
+            resampler.interpolate(low, block);
+        }
+
+        DSPSampleType** convertedChannels = nullptr;
+        size_t numChannels = 0, maxBlockSize = 0;
+        HalfBandResampler<DSPSampleType> resampler;
+        bool wasBypassed = false;
     };
 
     template<typename ParamType, typename Params, typename Funcs>
@@ -192,36 +933,292 @@ private:
 
     DSP_Choice<juce::dsp::DelayLine<float>> delay;
 
+    //audio is processed in sub-blocks of at most this many samples, with the smoothers and modulation updated in between
+    static constexpr int maxSubBlockSize = 64;
+
+    template<typename SampleType>
+    struct ProcessState
+    {
+        StageProcessor<SampleType>* processor = nullptr;
+        bool bypassed = false;
+        //a stage that isn't ready may be released at any moment, so it isn't called at all
+        bool ready = false;
+    };
+    template<typename SampleType>
+    using DSP_Pointers = std::array<ProcessState<SampleType>, static_cast<size_t>(DSP_Option::END_OF_LIST)>;
+
+    /*
+     FilterSampleType is the precision the recursive filters (overdrive, ladder, general filter) run at.
+     the float chain can run them in double to keep low-frequency / high-Q coefficients accurate.
+     */
+    template<typename SampleType, typename FilterSampleType = SampleType>
     struct MonoChannelDSP
     {
-        MonoChannelDSP(Project13AudioProcessor& proc) : p(proc) {}
+        using IOType = SampleType;
 
-        DSP_Choice<juce::dsp::Phaser<float>> phaser;
-        DSP_Choice<juce::dsp::Chorus<float>> chorus;
-        DSP_Choice<juce::dsp::LadderFilter<float>> overdrive, ladderFilter;
-        DSP_Choice<juce::dsp::IIR::Filter<float>> generalFilter;
+        MonoChannelDSP(Project13AudioProcessor& proc, int channelIndex) : p(proc), channel(channelIndex) {}
 
-        void prepare(const juce::dsp::ProcessSpec& spec);
+        DSP_Choice<ArenaPhaser<SampleType>, SampleType> phaser;
+        DSP_Choice<ArenaChorus<SampleType>, SampleType> chorus;
+        DSP_Choice<juce::dsp::LadderFilter<FilterSampleType>, SampleType> overdrive;
+        DSP_Choice<ZdfLadder<FilterSampleType>, SampleType> ladderFilter;
+        DSP_Choice<Biquad<FilterSampleType>, SampleType> generalFilter;
+        //the General Filter Engine choice picks which of these two runs; both are prepared with the stage
+        DSP_Choice<TptSvf<FilterSampleType>, SampleType> generalFilterSvf;
+        //FFT based, so float in every chain
+        DSP_Choice<PartitionedConvolver<float>, SampleType> convolution;
+        DSP_Choice<LinearPhaseEQ<float>, SampleType> linearPhaseEQ;
+        DSP_Choice<LookaheadCompressor<SampleType>, SampleType> dynamics;
+        DSP_Choice<FdnReverb<SampleType>, SampleType> reverb;
+
+        StageProcessor<SampleType>* getProcessor(DSP_Option option);
+        void prepareStage(DSP_Option option, const juce::dsp::ProcessSpec& spec, Arena& arena);
+        static size_t getStageArenaBytes(DSP_Option option, const juce::dsp::ProcessSpec& spec, int decimation, int fftOrder, int lookaheadSamples);
+        void releaseStage(DSP_Option option);
 
         void updateDSPFromParams();
+        //makes every prepared stage continue exactly where 'other' is, see processBlockImpl()
+        void copyStateFrom(const MonoChannelDSP& other);
+        //message thread.  sizes the delay that stands in for stages with latency that don't run
+        void prepareLatencyCompensation(int maxDelaySamples);
 
-        void process(juce::dsp::AudioBlock<float> block, const DSP_Order& dspOrder);
+        void process(juce::dsp::AudioBlock<SampleType> block, const DSP_Order& dspOrder);
     private:
         Project13AudioProcessor& p;
+        //0 = left / mid, 1 = right / side
+        int channel = 0;
+        bool generalFilterUsesSvf = false;
+        //the kernel serial the linear-phase EQ last took; none after it is prepared, so it takes the current one
+        std::optional<juce::uint32> linearPhaseEQKernelSerial;
+
+        /*
+         the multiband split, and a sub-block of each band.
+         the crossover only runs while a stage is on a band; it starts from silence whenever it starts again.
+         */
+        static constexpr size_t maxNumBands = LinkwitzRileyCoefficients::maxNumBands;
+        LinkwitzRileyCrossover<SampleType> crossover;
+        std::array<std::array<SampleType, static_cast<size_t>(maxSubBlockSize)>, maxNumBands> bandSamples {};
+        bool bandsWereSplit = false;
+        using StageBands = std::array<int, static_cast<size_t>(DSP_Option::END_OF_LIST)>;
+        void processBands(juce::dsp::AudioBlock<SampleType> block, const DSP_Order& dspOrder, const StageBands& stageBands, DSP_Pointers<SampleType>& dspPointers);
+        void runStage(ProcessState<SampleType>& state, juce::dsp::AudioBlock<SampleType> block);
 
-        GeneralFilterMode filterMode = GeneralFilterMode::END_OF_LIST;
-        float filterFreq = 0.f, filterQ = 0.f, filterGain = -100.f;
+        /*
+         line 0 delays the full signal, line 1 + b band b.  every line is written every sub-block, whatever it owes,
+         so when a stage's latency starts or stops being owed only the read offset moves, and the audio is already there.
+         */
+        static constexpr int numCompensationLines = 1 + static_cast<int>(maxNumBands);
+        juce::AudioBuffer<SampleType> compensationBuffer;
+        std::array<int, numCompensationLines> compensationWritePositions {};
+        void delayForLatencyCompensation(juce::dsp::AudioBlock<SampleType> block, int delaySamples, int line = 0);
     };
 
-    MonoChannelDSP leftChannel{ *this };
-    MonoChannelDSP rightChannel{ *this };
+    MonoChannelDSP<float> leftChannel{ *this, 0 };
+    MonoChannelDSP<float> rightChannel{ *this, 1 };
+    MonoChannelDSP<float, double> leftChannelDoubleFilters{ *this, 0 };
+    MonoChannelDSP<float, double> rightChannelDoubleFilters{ *this, 1 };
+    MonoChannelDSP<double> leftChannelDouble{ *this, 0 };
+    MonoChannelDSP<double> rightChannelDouble{ *this, 1 };
 
-    struct ProcessState
+    /*
+     which pair of channels is in use.  chosen in prepareToPlay() from the host's processing precision and the Double Precision Filters parameter.
+     only the active pair is ever prepared.
+     */
+    enum class ChainPrecision
     {
-        juce::dsp::ProcessorBase* processor = nullptr;
-        bool bypassed = false;
+        floatChain,
+        floatChainDoubleFilters,
+        doubleChain
+    };
+    ChainPrecision activePrecision = ChainPrecision::floatChain;
+
+    //calls callback(left, right) with the active pair of channels
+    template<typename Callback>
+    void withActiveChain(Callback&& callback)
+    {
+        switch (activePrecision)
+        {
+        case ChainPrecision::floatChain:
+            callback(leftChannel, rightChannel);
+            break;
+        case ChainPrecision::floatChainDoubleFilters:
+            callback(leftChannelDoubleFilters, rightChannelDoubleFilters);
+            break;
+        case ChainPrecision::doubleChain:
+            callback(leftChannelDouble, rightChannelDouble);
+            break;
+        }
+    }
+
+    size_t getStageArenaBytes(DSP_Option option, const juce::dsp::ProcessSpec& spec) const;
+
+    /*
+     at high host rates the phaser, chorus and general filter run at the rate picked by Internal Rate Cap.
+     each of them delays by the resampler's latency, and a chain in which one of them doesn't run
+     delays by the same amount in its place, so the reported latency never changes after prepareToPlay().
+     the overdrive and ladder stay at the host rate; their nonlinearities need the headroom.
+     */
+    static constexpr int numDecimatedStages = 3;
+    int decimationFactor = 1;
+    static bool isDecimatedStage(DSP_Option option)
+    {
+        return option == DSP_Option::Phase || option == DSP_Option::Chorus || option == DSP_Option::GeneralFilter;
+    }
+    int getStageDecimation(DSP_Option option) const { return isDecimatedStage(option) ? decimationFactor : 1; }
+    int getDecimatedStageLatency() const { return HalfBandResampler<float>::getLatencySamples(decimationFactor); }
+
+    /*
+     the linear-phase EQ delays by LinearPhaseEQ::getLatencySamples() for the FFT size picked by Lin EQ FFT Size.
+     that is thousands of samples, so it is only reported once the stage is allocated, and an instance that never uses the EQ
+     doesn't pay for it.  an allocated stage stays until the next prepareToPlay(), and like the decimated stages it is
+     compensated for while it doesn't run, so switching it off to compare doesn't shift anything in time.
+     changing the FFT size while playing rebuilds the stage from the timer, see timerCallback(); the audio thread reads
+     the order for the kernel it requests, so it is atomic.
+     */
+    std::atomic<int> linearPhaseEQFFTOrder { LinearPhaseKernel::minFFTOrder };
+    int getLinearPhaseEQLatency() const { return LinearPhaseEQ<float>::getLatencySamples(linearPhaseEQFFTOrder.load(std::memory_order_relaxed)); }
+    //the compensation is sized for the largest FFT size, so a rebuilt EQ never needs it to grow
+    static int getMaxLinearPhaseEQLatency() { return LinearPhaseEQ<float>::getLatencySamples(LinearPhaseKernel::maxFFTOrder); }
+    //the dynamics stage delays by its lookahead, is reported the same way as the EQ, and is rebuilt the same way when it changes
+    std::atomic<int> dynamicsLookaheadSamples { 0 };
+    //LookaheadCompressor::maxLookaheadMs at the current rate, what the compensation is sized for
+    int maxDynamicsLookaheadSamples = 0;
+    //the chain's latency right now, and the most it can reach before the next prepareToPlay()
+    int getChainLatency() const
+    {
+        auto latency = 0;
+        for (size_t i = 0; i < static_cast<size_t>(DSP_Option::END_OF_LIST); ++i)
+            latency += getStageLatency(static_cast<DSP_Option>(i));
+        return latency;
+    }
+    int getMaxChainLatency() const { return numDecimatedStages * getDecimatedStageLatency() + getMaxLinearPhaseEQLatency() + maxDynamicsLookaheadSamples; }
+    //what a stage delays by when it runs, and what the chain owes in its place when it doesn't
+    int getStageLatency(DSP_Option option) const
+    {
+        if (isDecimatedStage(option))
+            return getDecimatedStageLatency();
+        if (option == DSP_Option::LinearPhaseEQ && isStageReady(DSP_Option::LinearPhaseEQ))
+            return getLinearPhaseEQLatency();
+        if (option == DSP_Option::Dynamics && isStageReady(DSP_Option::Dynamics))
+            return dynamicsLookaheadSamples.load(std::memory_order_relaxed);
+        return 0;
+    }
+
+    template<typename SampleType>
+    void processBlockImpl(juce::AudioBuffer<SampleType>& buffer);
+
+    /*
+     dual mono: while the input channels are identical, only the left chain runs and its output is copied to the right.
+     it is entered once input and output have matched for dualMonoHoldSeconds, so the two chains' states have converged,
+     and left as soon as the inputs differ, with the right chain's state copied from the left before it runs again.
+     */
+    static constexpr double dualMonoHoldSeconds = 0.25;
+    bool dualMono = false;
+    int dualMonoMatchedSamples = 0;
+
+    //one per host precision; only the one matching isUsingDoublePrecision() is prepared
+    LatencyCompensatedMix<float> globalMix;
+    LatencyCompensatedMix<double> globalMixDouble;
+    //the wet amount the previous sub-block ended on, so the mix ramps instead of stepping
+    float previousGlobalMix = 1.f;
+
+    template<typename SampleType>
+    LatencyCompensatedMix<SampleType>& getGlobalMix()
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return globalMixDouble;
+        else
+            return globalMix;
+    }
+
+    /*
+     the convolution stage's impulse response and the tail of each channel, made on the message thread.
+     the audio thread is handed a set with SetConvolutionCommand and hands back the one it replaced through
+     retiredConvolutionSets, so a set is only ever destroyed once the audio thread can no longer be using it.
+     */
+    struct ConvolutionSet
+    {
+        ConvolutionSet(ImpulseResponse::Ptr ir);
+        ~ConvolutionSet();
+
+        ImpulseResponse::Ptr impulseResponse;
+        //nullptr when the response is too short to have a tail
+        std::array<std::unique_ptr<ConvolutionTail>, 2> tails;
+
+        JUCE_DECLARE_NON_COPYABLE(ConvolutionSet)
+    };
+    //message thread
+    std::vector<std::unique_ptr<ConvolutionSet>> convolutionSets;
+    //audio thread
+    ConvolutionSet* convolutionSet = nullptr;
+    //replaced while retiredConvolutionSets was full; no more commands are applied until it is handed back
+    ConvolutionSet* unretiredConvolutionSet = nullptr;
+    //one set is retired per SetConvolutionCommand, so this holds everything a full audioCommands can retire
+    CommandQueue<ConvolutionSet*, 32> retiredConvolutionSets;
+
+    /*
+     impulse responses are read and transformed on the shared impulseResponseLoader, one request at a time.
+     the result is left in loadedImpulseResponse, and installed by the timer if nothing was requested after it.
+     prepareToPlay() asks again when the sample rate or the tail lead changes, so the lock guards everything here.
+     */
+    mutable juce::CriticalSection impulseResponseLock;
+    juce::File impulseResponseFile;
+    double impulseResponseSampleRate = 0.0;
+    int impulseResponseTailLead = ImpulseResponse::getTailLead(0);
+    int impulseResponseRequest = 0, loadedImpulseResponseRequest = 0, installedImpulseResponseRequest = 0;
+    ImpulseResponse::Ptr loadedImpulseResponse;
+    juce::SharedResourcePointer<ImpulseResponseLoader> impulseResponseLoader;
+    //this instance's jobs on impulseResponseLoader, so an offline prepareToPlay() doesn't wait for other instances'
+    std::atomic<int> numImpulseResponseJobs { 0 };
+    void requestImpulseResponse(double sampleRate, int tailLead);
+    void installLoadedImpulseResponse();
+    void freeRetiredConvolutionSets();
+    //read by the host from any thread
+    std::atomic<double> impulseResponseSeconds { 0.0 };
+    std::atomic<size_t> convolutionTailBytes { 0 };
+
+    /*
+     lazy stage preparation.
+     stageReady[i] means both channels' stage i is allocated and owned by the audio thread.
+     stageRequested[i] is set by the audio thread when it needs a stage that isn't ready.
+     */
+    mutable juce::CriticalSection stagePreparationLock;
+    juce::dsp::ProcessSpec stageSpec {};
+    bool hasStageSpec = false;
+    std::array<std::atomic<bool>, static_cast<size_t>(DSP_Option::END_OF_LIST)> stageReady {};
+    std::array<std::atomic<bool>, static_cast<size_t>(DSP_Option::END_OF_LIST)> stageRequested {};
+
+    /*
+     stages prepared in prepareToPlay() carve from dspArena: the left chain, then the right chain, each in processing order.
+     a stage enabled later gets its own arena from the timer, since dspArena can't grow while the audio thread is using it.
+     */
+    Arena dspArena;
+    std::array<Arena, static_cast<size_t>(DSP_Option::END_OF_LIST)> lateStageArenas;
+    void releaseAllStages();
+
+    bool isStageReady(DSP_Option option) const { return stageReady[static_cast<size_t>(option)].load(std::memory_order_acquire); }
+    void requestStage(DSP_Option option);
+
+    /*
+     a prepared stage whose size depends on a parameter, like the linear-phase EQ's FFT size, is rebuilt from the timer.
+     retireStage() clears stageReady and sends the audio thread a RetireStageCommand.  the audio thread acknowledges it
+     at the start of a block, after which no block can still be using the stage, and a later call releases it.
+     nothing waits: until then the stage is neither ready nor prepared again.
+     */
+    enum class StageRetirement
+    {
+        notReady,
+        waiting,
+        released
     };
-    using DSP_Pointers = std::array<ProcessState, static_cast<size_t>(DSP_Option::END_OF_LIST)>;
+    StageRetirement retireStage(DSP_Option option);
+    //message thread: the command each stage waits for, or 0
+    std::array<juce::uint32, static_cast<size_t>(DSP_Option::END_OF_LIST)> stageRetirementSerials {};
+    juce::uint32 lastRetirementSerial = 0;
+    //audio thread -> message thread: the last RetireStageCommand applied
+    std::atomic<juce::uint32> acknowledgedRetirementSerial { 0 };
+    void timerCallback() override;
+    size_t estimateStageBufferBytes(DSP_Option option, const juce::dsp::ProcessSpec& spec) const;
 
     #define VERIFY_BYPASS_FUNCTIONALITY false
 
@@ -0,0 +1,214 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Compact, versioned binary storage for presets.
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+static juce::uint32 readU32(const juce::uint8* ptr)
+{
+    return juce::ByteOrder::littleEndianInt(ptr);
+}
+
+static float readFloat(const juce::uint8* ptr)
+{
+    auto bits = readU32(ptr);
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static juce::uint32 alignTo4(size_t size)
+{
+    return static_cast<juce::uint32>((size + 3) & ~size_t(3));
+}
+
+juce::uint32 PresetBank::hashParamID(const juce::String& paramID)
+{
+    //FNV-1a.  juce::String::hashCode() isn't guaranteed to be stable between JUCE versions, and this ends up on disk.
+    juce::uint32 hash = 2166136261u;
+    for (auto* c = paramID.toRawUTF8(); *c != 0; ++c)
+    {
+        hash ^= static_cast<juce::uint8>(*c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool PresetBank::open(const juce::File& file, const std::vector<juce::uint32>& currentParamHashes)
+{
+    close();
+
+    if (!file.existsAsFile())
+        return false;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    if (mapped->getData() == nullptr || mapped->getSize() < headerSize)
+        return false;
+
+    auto* ptr = static_cast<const juce::uint8*>(mapped->getData());
+    auto size = mapped->getSize();
+
+    Header h;
+    h.magic = readU32(ptr);
+    h.version = readU32(ptr + 4);
+    h.numParams = readU32(ptr + 8);
+    h.orderSize = readU32(ptr + 12);
+    h.numPresets = readU32(ptr + 16);
+    h.recordSize = readU32(ptr + 20);
+    h.hashesOffset = readU32(ptr + 24);
+    h.indexOffset = readU32(ptr + 28);
+    h.namesOffset = readU32(ptr + 32);
+    h.recordsOffset = readU32(ptr + 36);
+
+    if (h.magic != magic || h.version == 0 || h.version > currentVersion)
+        return false;
+
+    /*
+     every section must fit inside the file, otherwise a truncated or corrupt bank could make readPreset() run off the end of the mapping.
+     the math is done in 64 bits so that huge counts can't wrap around.
+     */
+    auto fits = [size](juce::uint64 offset, juce::uint64 length)
+    {
+        return offset <= size && length <= size - offset;
+    };
+
+    if (h.recordSize < juce::uint64(h.numParams) * sizeof(float) + h.orderSize
+        || !fits(h.hashesOffset, juce::uint64(h.numParams) * sizeof(juce::uint32))
+        || !fits(h.indexOffset, juce::uint64(h.numPresets) * indexEntrySize)
+        || !fits(h.recordsOffset, juce::uint64(h.numPresets) * h.recordSize)
+        || h.namesOffset > h.recordsOffset)
+        return false;
+
+    storedSlotForParam.assign(currentParamHashes.size(), -1);
+    for (juce::uint32 slot = 0; slot < h.numParams; ++slot)
+    {
+        auto storedHash = readU32(ptr + h.hashesOffset + slot * sizeof(juce::uint32));
+        for (size_t i = 0; i < currentParamHashes.size(); ++i)
+        {
+            if (currentParamHashes[i] == storedHash)
+            {
+                storedSlotForParam[i] = static_cast<int>(slot);
+                break;
+            }
+        }
+    }
+
+    mappedFile = std::move(mapped);
+    data = ptr;
+    header = h;
+    return true;
+}
+
+void PresetBank::close()
+{
+    mappedFile.reset();
+    data = nullptr;
+    header = {};
+    storedSlotForParam.clear();
+}
+
+juce::String PresetBank::getPresetName(int index) const
+{
+    if (!isOpen() || !juce::isPositiveAndBelow(index, getNumPresets()))
+        return {};
+
+    auto* entry = data + header.indexOffset + static_cast<size_t>(index) * indexEntrySize;
+    auto nameOffset = juce::uint64(header.namesOffset) + readU32(entry);
+    auto nameLength = readU32(entry + 4);
+
+    if (nameOffset + nameLength > header.recordsOffset)
+        return {};
+
+    return juce::String::fromUTF8(reinterpret_cast<const char*>(data + nameOffset), static_cast<int>(nameLength));
+}
+
+bool PresetBank::readPreset(int index, float* values, juce::uint8* order, size_t orderSize) const
+{
+    //a bank written before stages were added has a shorter order; the caller completes it
+    if (!isOpen() || !juce::isPositiveAndBelow(index, getNumPresets()) || orderSize < header.orderSize)
+        return false;
+
+    auto* record = data + header.recordsOffset + static_cast<size_t>(index) * header.recordSize;
+
+    for (size_t i = 0; i < storedSlotForParam.size(); ++i)
+    {
+        if (auto slot = storedSlotForParam[i]; slot >= 0)
+            values[i] = readFloat(record + static_cast<size_t>(slot) * sizeof(float));
+    }
+
+    std::memcpy(order, record + header.numParams * sizeof(float), header.orderSize);
+    std::fill(order + header.orderSize, order + orderSize, juce::uint8(0xff));
+    return true;
+}
+
+bool PresetBank::write(const juce::File& file,
+                       const std::vector<juce::uint32>& paramHashes,
+                       size_t orderSize,
+                       const std::vector<Preset>& presets)
+{
+    juce::MemoryBlock names;
+    std::vector<std::pair<juce::uint32, juce::uint32>> index;
+    index.reserve(presets.size());
+
+    for (const auto& preset : presets)
+    {
+        auto utf8 = preset.name.toUTF8();
+        auto length = utf8.sizeInBytes() - 1;
+        index.emplace_back(static_cast<juce::uint32>(names.getSize()), static_cast<juce::uint32>(length));
+        names.append(utf8.getAddress(), length);
+    }
+
+    Header h;
+    h.magic = magic;
+    h.version = currentVersion;
+    h.numParams = static_cast<juce::uint32>(paramHashes.size());
+    h.orderSize = static_cast<juce::uint32>(orderSize);
+    h.numPresets = static_cast<juce::uint32>(presets.size());
+    h.recordSize = alignTo4(paramHashes.size() * sizeof(float) + orderSize);
+    h.hashesOffset = static_cast<juce::uint32>(headerSize);
+    h.indexOffset = h.hashesOffset + h.numParams * static_cast<juce::uint32>(sizeof(juce::uint32));
+    h.namesOffset = h.indexOffset + h.numPresets * static_cast<juce::uint32>(indexEntrySize);
+    h.recordsOffset = alignTo4(h.namesOffset + names.getSize());
+
+    juce::MemoryBlock mb;
+    //juce MOS uses scoping to complete writing to the memory block correctly.
+    {
+        juce::MemoryOutputStream mos(mb, false);
+
+        for (auto v : { h.magic, h.version, h.numParams, h.orderSize, h.numPresets,
+                        h.recordSize, h.hashesOffset, h.indexOffset, h.namesOffset, h.recordsOffset })
+            mos.writeInt(static_cast<int>(v));
+
+        for (auto hash : paramHashes)
+            mos.writeInt(static_cast<int>(hash));
+
+        for (auto [nameOffset, nameLength] : index)
+        {
+            mos.writeInt(static_cast<int>(nameOffset));
+            mos.writeInt(static_cast<int>(nameLength));
+        }
+
+        mos.write(names.getData(), names.getSize());
+        mos.writeRepeatedByte(0, h.recordsOffset - mos.getPosition());
+
+        for (const auto& preset : presets)
+        {
+            auto recordStart = mos.getPosition();
+            for (size_t i = 0; i < paramHashes.size(); ++i)
+                mos.writeFloat(i < preset.values.size() ? preset.values[i] : 0.f);
+
+            for (size_t i = 0; i < orderSize; ++i)
+                mos.writeByte(static_cast<char>(i < preset.order.size() ? preset.order[i] : 0));
+
+            mos.writeRepeatedByte(0, recordStart + h.recordSize - mos.getPosition());
+        }
+    }
+
+    return file.getParentDirectory().createDirectory()
+        && file.replaceWithData(mb.getData(), mb.getSize());
+}
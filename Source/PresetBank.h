@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Compact, versioned binary storage for presets.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ PresetBank is a read-only view of a binary preset file.
+ the file is memory-mapped, so listing names and reading a preset never parses the whole file.
+
+ file layout (all values little-endian):
+    Header                                  magic, version, counts and section offsets
+    juce::uint32 paramHashes[numParams]     identifies which parameter each stored value belongs to
+    IndexEntry   index[numPresets]          { nameOffset, nameLength } into the name table
+    char         names[]                    utf8, not null-terminated
+    Record       records[numPresets]        { float values[numParams]; juce::uint8 order[orderSize]; } padded to 4 bytes
+
+ values are stored denormalised and matched to the current parameter layout via paramHashes,
+ so presets saved before a parameter was added or removed still load.
+ */
+struct PresetBank
+{
+    static constexpr juce::uint32 magic = 0x42333150; // "P13B"
+    static constexpr juce::uint32 currentVersion = 1;
+
+    struct Preset
+    {
+        juce::String name;
+        std::vector<float> values;
+        std::vector<juce::uint8> order;
+    };
+
+    static juce::uint32 hashParamID(const juce::String& paramID);
+
+    /*
+     currentParamHashes is the parameter layout the caller will read presets into.
+     */
+    bool open(const juce::File& file, const std::vector<juce::uint32>& currentParamHashes);
+    void close();
+    bool isOpen() const { return mappedFile != nullptr; }
+
+    int getNumPresets() const { return static_cast<int>(header.numPresets); }
+    juce::String getPresetName(int index) const;
+
+    /*
+     values must hold one entry per hash passed to open().
+     entries for parameters the bank doesn't know about are left untouched, so fill them with defaults first.
+     an order stored shorter than orderSize is padded with 0xff.
+     */
+    bool readPreset(int index, float* values, juce::uint8* order, size_t orderSize) const;
+
+    static bool write(const juce::File& file,
+                      const std::vector<juce::uint32>& paramHashes,
+                      size_t orderSize,
+                      const std::vector<Preset>& presets);
+private:
+    struct Header
+    {
+        juce::uint32 magic = 0;
+        juce::uint32 version = 0;
+        juce::uint32 numParams = 0;
+        juce::uint32 orderSize = 0;
+        juce::uint32 numPresets = 0;
+        juce::uint32 recordSize = 0;
+        juce::uint32 hashesOffset = 0;
+        juce::uint32 indexOffset = 0;
+        juce::uint32 namesOffset = 0;
+        juce::uint32 recordsOffset = 0;
+    };
+
+    static constexpr size_t headerSize = 10 * sizeof(juce::uint32);
+    static constexpr size_t indexEntrySize = 2 * sizeof(juce::uint32);
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    const juce::uint8* data = nullptr;
+    Header header;
+    //for each current parameter, the slot it occupies in a stored record, or -1 if the bank doesn't have it
+    std::vector<int> storedSlotForParam;
+};